@@ -9,6 +9,7 @@ typedef struct process process;
 typedef struct process * processPtr;
 
 typedef struct diskRequest diskRequest;
+typedef struct diskRequest * diskRequestPtr;
 
 typedef struct termLine termLine;
 typedef struct termInputBuffer termInputBuffer;
@@ -25,6 +26,12 @@ struct diskRequest
     int startTrack;
     int unit;
     int resultStatus;
+    int ioClass;                      // The I/O priority class of this request
+    int queueTime;                    // The time at which this request was queued
+    int startTime;                    // The time at which the driver started this request
+    int epoch;                        // The barrier epoch of the unit when this request was queued
+    processPtr proc;                  // The process that issued this request
+    diskRequestPtr nextDiskQueueRequest; // The next request in the disk queue
 };
 
 struct process
@@ -38,8 +45,14 @@ struct process
     int sleepTime;                    // The amount of time this process should sleep for
 
     // Disk fields
-    processPtr nextDiskQueueProc;     // The next proc in the disk queue
-    diskRequest diskRequest;          // Holds information on the request to the disk
+    int diskCompletionMboxID;         // Mailbox the disk drivers send to when a request finishes
+    int diskIOClass;                  // The I/O priority class set with DiskSetIOClass
+    int diskIOClassPid;               // The pid that set diskIOClass, so it isn't inherited on reuse
+    int numDiskRequests;              // The number of requests in use in diskRequests
+    int diskAdmissionSem;             // Semaphore this process waits on for room in a disk queue
+    int diskQueued[USLOSS_DISK_UNITS]; // Requests of this process admitted to each disk queue
+    processPtr nextDiskAdmission;     // The next process waiting for room in the same disk queue
+    diskRequest diskRequests[MAXDISKBATCH]; // Requests to the disk; a single DiskRead/Write uses the first
 };
 
 struct termLine
@@ -0,0 +1,27 @@
+/*
+ * Definitions for the disk request trace. When tracing is on, the disk drivers
+ * append one record per completed request to the trace file. The records are
+ * read back on the host by tools/diskreplay.
+ */
+
+#ifndef _DISKTRACE_H
+#define _DISKTRACE_H
+
+/*
+ * One completed disk request. Times are in microseconds from the USLOSS clock.
+ */
+typedef struct diskTraceRecord
+{
+    int   queueTime;          // When the request was put in the queue
+    int   waitTime;           // How long it waited in the queue
+    int   serviceTime;        // How long the driver spent performing it
+    short pid;                // The process that issued it
+    char  op;                 // USLOSS_DISK_READ or USLOSS_DISK_WRITE
+    char  unit;
+    short track;
+    short sector;
+    short numSectors;
+    short ioClass;
+} diskTraceRecord;
+
+#endif /* _DISKTRACE_H */
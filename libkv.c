@@ -0,0 +1,790 @@
+/*
+ *  File: libkv.c
+ *  Purpose: This file defines a key-value store for user processes, kept as
+ *  a log of records on one disk unit. KvPut and KvDelete append a record at
+ *  the head of the log, and an index in memory maps each key to its newest
+ *  record, so KvGet reads one record with one DiskRead. A compactor process
+ *  copies the records still in use out of the oldest track of the log and
+ *  frees it. KvOpen rebuilds the index by scanning the log.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase4.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libuser.h"
+#include "devices.h"
+#include "libkv.h"
+
+extern int debugflag4;
+
+// The unit of the open store, or EMPTY, and the number of tracks in its log,
+// which starts at track 1
+static int KvUnit = EMPTY;
+static int KvTracks;
+
+// Mutex for everything below, and semaphores to wake the compactor, to wait
+// for space, and to wait for the compactor to quit
+static int KvMutex;
+static int KvWakeSem;
+static int KvSpaceSem;
+static int KvDoneSem;
+static int KvSpaceWaiters;
+static int KvCompactorWoken;
+static int KvStopping;
+
+// The index
+static kvIndexEntry KvIndex[KV_MAX_KEYS];
+static int KvBuckets[KV_HASH_BUCKETS];
+static int KvFreeEntries;
+static int KvKeys;
+
+// The log runs from the start of track KvTail to sector KvHeadSector of track
+// KvHead. KvTrackFirstSeq is the seq of the first record written to a track.
+static int KvTail;
+static int KvHead;
+static int KvHeadSector;
+static int KvNextSeq;
+static int KvMinSeq;
+static int KvTrackFirstSeq[KV_MAX_TRACKS];
+
+// Sectors taken by the newest records of the keys, and the most they can take
+// so that compaction can always free space
+static int KvLiveSectors;
+static int KvUsableSectors;
+
+static char KvRecord[KV_RECORD_SECTORS * USLOSS_DISK_SECTOR_SIZE];
+static char KvTrack[USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+static char KvSuperBuffer[USLOSS_DISK_SECTOR_SIZE];
+
+static int kvCompactor(char *);
+static int kvCompactTail();
+static int kvRecover();
+static int kvReadTrack(int);
+static kvRecordHeader *kvRecordAt(char *, int, int);
+static int kvAppend(char *, void *, int, int, kvIndexEntry *);
+static int kvWriteSuperblock();
+static int kvWaitForSpace(int);
+static void kvWakeCompactor();
+static int kvFreeSectors();
+static int kvRecordSectors(int);
+static int kvKeyValid(char *);
+static unsigned int kvChecksum(char *, int);
+static int kvHash(char *);
+static int kvFind(char *);
+static int kvInsert(char *);
+static void kvRemove(char *);
+
+/*
+ *  Opens the store on a unit, making an empty one if the unit doesn't hold
+ *  one, and starts the compactor. The compactor is a child of the calling
+ *  process, which must call KvClose before it terminates.
+ *  Return values:
+ *    -1: a store is already open, or the unit can't hold one
+ *     0: the store is open
+ */
+int KvOpen(int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("KvOpen(): called.\n");
+    }
+
+    int sectorSize, trackSize, tracks;
+    if (KvUnit != EMPTY || DiskSize(unit, &sectorSize, &trackSize, &tracks) == -1)
+    {
+        return -1;
+    }
+    KvTracks = tracks - 1 < KV_MAX_TRACKS ? tracks - 1 : KV_MAX_TRACKS;
+
+    // Every track may waste the end of itself on a record that didn't fit
+    KvUsableSectors = KvTracks * (USLOSS_DISK_TRACK_SIZE - KV_RECORD_SECTORS + 1) -
+                      KV_RESERVE_SECTORS - USLOSS_DISK_TRACK_SIZE;
+    if (KvUsableSectors <= 0)
+    {
+        return -1;
+    }
+    KvUnit = unit;
+
+    SemCreate(1, &KvMutex);
+    SemCreate(0, &KvWakeSem);
+    SemCreate(0, &KvSpaceSem);
+    SemCreate(0, &KvDoneSem);
+    KvSpaceWaiters = 0;
+    KvCompactorWoken = FALSE;
+    KvStopping = FALSE;
+
+    // Empty the index
+    memset(KvIndex, 0, sizeof(KvIndex));
+    for (int i = 0; i < KV_HASH_BUCKETS; i++)
+    {
+        KvBuckets[i] = EMPTY;
+    }
+    for (int i = 0; i < KV_MAX_KEYS; i++)
+    {
+        KvIndex[i].next = i + 1 < KV_MAX_KEYS ? i + 1 : EMPTY;
+    }
+    KvFreeEntries = 0;
+    KvKeys = 0;
+    KvLiveSectors = 0;
+
+    // Read the log, or start a new one
+    int status;
+    kvSuperblock *superblock = (kvSuperblock *) KvSuperBuffer;
+    if (DiskRead(KvSuperBuffer, unit, 0, 0, 1, &status) == -1 || status != 0 ||
+        superblock->magic != KV_MAGIC)
+    {
+        KvMinSeq = 0;
+        KvNextSeq = 0;
+        KvTail = 0;
+        KvHead = 0;
+        KvHeadSector = 0;
+        KvTrackFirstSeq[0] = EMPTY;
+        status = kvWriteSuperblock();
+    }
+    else
+    {
+        KvMinSeq = superblock->minSeq;
+        status = kvRecover();
+    }
+    if (status != 0)
+    {
+        KvUnit = EMPTY;
+        return -1;
+    }
+
+    int pid;
+    Spawn("KV compactor", kvCompactor, NULL, 2 * USLOSS_MIN_STACK, 5, &pid);
+    return 0;
+}
+
+/*
+ *  Stops the compactor and closes the store.
+ *  Return values:
+ *    -1: no store is open
+ *     0: the store is closed
+ */
+int KvClose(void)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("KvClose(): called.\n");
+    }
+
+    if (KvUnit == EMPTY)
+    {
+        return -1;
+    }
+
+    SemP(KvMutex);
+    KvStopping = TRUE;
+    SemV(KvWakeSem);
+    SemV(KvMutex);
+    SemP(KvDoneSem);
+
+    SemFree(KvMutex);
+    SemFree(KvWakeSem);
+    SemFree(KvSpaceSem);
+    SemFree(KvDoneSem);
+    KvUnit = EMPTY;
+    return 0;
+}
+
+/*
+ *  Stores length bytes of value under key, replacing any value it had.
+ *  Return values:
+ *    -1: invalid parameters, the store is full, or the disk failed
+ *     0: the value is stored
+ */
+int KvPut(char *key, void *value, int length)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("KvPut(): called.\n");
+    }
+
+    if (KvUnit == EMPTY || !kvKeyValid(key) || length < 0 || length > KV_MAX_VALUE ||
+        (value == NULL && length > 0))
+    {
+        return -1;
+    }
+    int sectors = kvRecordSectors(length);
+
+    if (kvWaitForSpace(sectors) == -1)
+    {
+        return -1;
+    }
+
+    // Room is left for the record, and nothing else can change the key until
+    // the mutex is given back
+    int entry = kvFind(key);
+    int old = entry == EMPTY ? 0 : KvIndex[entry].sectors;
+    if ((entry == EMPTY && KvKeys == KV_MAX_KEYS) ||
+        KvLiveSectors - old + sectors > KvUsableSectors)
+    {
+        SemV(KvMutex);
+        return -1;
+    }
+
+    kvIndexEntry location;
+    if (kvAppend(key, value, length, 0, &location) != 0)
+    {
+        SemV(KvMutex);
+        return -1;
+    }
+    if (entry == EMPTY)
+    {
+        entry = kvInsert(key);
+    }
+    location.next = KvIndex[entry].next;
+    KvIndex[entry] = location;
+    KvLiveSectors += sectors - old;
+
+    if (kvFreeSectors() < KV_COMPACT_SECTORS)
+    {
+        kvWakeCompactor();
+    }
+    SemV(KvMutex);
+    return 0;
+}
+
+/*
+ *  Copies the value stored under key into value, up to size bytes, and sets
+ *  *length to the length of the whole value, or to -1 if the key has none.
+ *  Return values:
+ *    -1: invalid parameters or the disk failed
+ *     0: otherwise
+ */
+int KvGet(char *key, void *value, int size, int *length)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("KvGet(): called.\n");
+    }
+
+    if (KvUnit == EMPTY || !kvKeyValid(key) || size < 0 || (value == NULL && size > 0) ||
+        length == NULL)
+    {
+        return -1;
+    }
+
+    SemP(KvMutex);
+    int entry = kvFind(key);
+    if (entry == EMPTY)
+    {
+        SemV(KvMutex);
+        *length = -1;
+        return 0;
+    }
+
+    // The index says where the record is, so one read is enough
+    kvIndexEntry *location = &KvIndex[entry];
+    int status;
+    int result = DiskRead(KvRecord, KvUnit, location->track + 1, location->sector,
+                          location->sectors, &status);
+    kvRecordHeader *header = (kvRecordHeader *) KvRecord;
+    if (result == -1 || status != 0 || header->seq != location->seq)
+    {
+        SemV(KvMutex);
+        return -1;
+    }
+
+    *length = header->length;
+    if (value != NULL)
+    {
+        memcpy(value, KvRecord + sizeof(kvRecordHeader),
+               size < header->length ? size : header->length);
+    }
+    SemV(KvMutex);
+    return 0;
+}
+
+/*
+ *  Removes key and its value from the store. Removing a key that has no value
+ *  does nothing.
+ *  Return values:
+ *    -1: invalid parameters or the disk failed
+ *     0: the key has no value
+ */
+int KvDelete(char *key)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("KvDelete(): called.\n");
+    }
+
+    if (KvUnit == EMPTY || !kvKeyValid(key))
+    {
+        return -1;
+    }
+
+    if (kvWaitForSpace(1) == -1)
+    {
+        return -1;
+    }
+    int entry = kvFind(key);
+    if (entry == EMPTY)
+    {
+        SemV(KvMutex);
+        return 0;
+    }
+
+    // The tombstone keeps older records of the key from coming back when the
+    // log is read again
+    kvIndexEntry location;
+    if (kvAppend(key, NULL, 0, KV_TOMBSTONE, &location) != 0)
+    {
+        SemV(KvMutex);
+        return -1;
+    }
+    KvLiveSectors -= KvIndex[entry].sectors;
+    kvRemove(key);
+
+    if (kvFreeSectors() < KV_COMPACT_SECTORS)
+    {
+        kvWakeCompactor();
+    }
+    SemV(KvMutex);
+    return 0;
+}
+
+/*
+ *  The compactor. Waits to be woken, then frees tracks from the tail of the
+ *  log until there is enough free space or the log is one track long.
+ */
+static int kvCompactor(char *arg)
+{
+    while (1)
+    {
+        SemP(KvWakeSem);
+        SemP(KvMutex);
+        KvCompactorWoken = FALSE;
+        if (KvStopping)
+        {
+            while (KvSpaceWaiters > 0)
+            {
+                KvSpaceWaiters--;
+                SemV(KvSpaceSem);
+            }
+            SemV(KvMutex);
+            break;
+        }
+
+        while (kvFreeSectors() < KV_COMPACT_SECTORS && KvTail != KvHead)
+        {
+            if (kvCompactTail() != 0)
+            {
+                USLOSS_Console("kvCompactor(): Could not compact disk %d.\n", KvUnit);
+                break;
+            }
+        }
+
+        // Let anyone waiting for space look again
+        while (KvSpaceWaiters > 0)
+        {
+            KvSpaceWaiters--;
+            SemV(KvSpaceSem);
+        }
+        SemV(KvMutex);
+    }
+
+    SemV(KvDoneSem);
+    Terminate(0);
+    return 0;
+}
+
+/*
+ *  Copies the records still in use on the tail track to the head of the log
+ *  and frees the track. Tombstones are dropped, since any older record of
+ *  their key is on the same track. Called with KvMutex held. Returns 0, or
+ *  the first non-zero disk status.
+ */
+static int kvCompactTail()
+{
+    int status = kvReadTrack(KvTail);
+    if (status != 0)
+    {
+        return status;
+    }
+
+    int sector = 0;
+    while (sector < USLOSS_DISK_TRACK_SIZE)
+    {
+        kvRecordHeader *header = kvRecordAt(KvTrack, sector, KvMinSeq);
+        if (header == NULL)
+        {
+            sector++;
+            continue;
+        }
+
+        int entry = kvFind(header->key);
+        if (!(header->flags & KV_TOMBSTONE) && entry != EMPTY &&
+            KvIndex[entry].seq == header->seq)
+        {
+            kvIndexEntry location;
+            status = kvAppend(header->key, (char *) header + sizeof(kvRecordHeader),
+                              header->length, 0, &location);
+            if (status != 0)
+            {
+                return status;
+            }
+            location.next = KvIndex[entry].next;
+            KvIndex[entry] = location;
+        }
+        sector += kvRecordSectors(header->length);
+    }
+
+    // Everything older than the new tail is dead
+    KvTail = (KvTail + 1) % KvTracks;
+    KvMinSeq = KvTrackFirstSeq[KvTail] != EMPTY ? KvTrackFirstSeq[KvTail] : KvNextSeq;
+    return kvWriteSuperblock();
+}
+
+/*
+ *  Rebuilds the index and the ends of the log by reading every record in it.
+ *  The newest record of a key wins. Returns 0, or the first non-zero disk
+ *  status.
+ */
+static int kvRecover()
+{
+    int newest = EMPTY;
+    int oldest = EMPTY;
+    KvTail = 0;
+    KvHead = 0;
+    KvHeadSector = 0;
+    for (int track = 0; track < KvTracks; track++)
+    {
+        KvTrackFirstSeq[track] = EMPTY;
+        int status = kvReadTrack(track);
+        if (status != 0)
+        {
+            return status;
+        }
+
+        int sector = 0;
+        while (sector < USLOSS_DISK_TRACK_SIZE)
+        {
+            kvRecordHeader *header = kvRecordAt(KvTrack, sector, KvMinSeq);
+            if (header == NULL)
+            {
+                sector++;
+                continue;
+            }
+            int sectors = kvRecordSectors(header->length);
+
+            if (KvTrackFirstSeq[track] == EMPTY || header->seq < KvTrackFirstSeq[track])
+            {
+                KvTrackFirstSeq[track] = header->seq;
+            }
+            if (oldest == EMPTY || header->seq < oldest)
+            {
+                oldest = header->seq;
+                KvTail = track;
+            }
+            if (newest == EMPTY || header->seq > newest)
+            {
+                newest = header->seq;
+                KvHead = track;
+                KvHeadSector = sector + sectors;
+            }
+
+            int entry = kvFind(header->key);
+            if (entry == EMPTY)
+            {
+                entry = kvInsert(header->key);
+            }
+            if (entry == EMPTY)
+            {
+                USLOSS_Console("kvRecover(): Too many keys on disk %d.\n", KvUnit);
+            }
+            else if (KvIndex[entry].seq == EMPTY || header->seq > KvIndex[entry].seq)
+            {
+                KvIndex[entry].seq = header->seq;
+                KvIndex[entry].track = track;
+                KvIndex[entry].sector = sector;
+                KvIndex[entry].sectors = sectors;
+                KvIndex[entry].length = header->length;
+                KvIndex[entry].tombstone = header->flags & KV_TOMBSTONE;
+            }
+            sector += sectors;
+        }
+    }
+    KvNextSeq = newest == EMPTY ? KvMinSeq : newest + 1;
+
+    // Deleted keys only had to outvote their older records
+    for (int i = 0; i < KV_MAX_KEYS; i++)
+    {
+        kvIndexEntry *entry = &KvIndex[i];
+        if (entry->seq != EMPTY && entry->key[0] != '\0')
+        {
+            if (entry->tombstone)
+            {
+                kvRemove(entry->key);
+            }
+            else
+            {
+                KvLiveSectors += entry->sectors;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ *  Reads a track of the log into KvTrack. Returns the disk status.
+ */
+static int kvReadTrack(int track)
+{
+    int half = USLOSS_DISK_TRACK_SIZE / 2;
+    int status;
+    if (DiskRead(KvTrack, KvUnit, track + 1, 0, half, &status) == -1)
+    {
+        return USLOSS_DEV_ERROR;
+    }
+    if (status == 0 && DiskRead(KvTrack + half * USLOSS_DISK_SECTOR_SIZE, KvUnit, track + 1,
+                                half, USLOSS_DISK_TRACK_SIZE - half, &status) == -1)
+    {
+        return USLOSS_DEV_ERROR;
+    }
+    return status;
+}
+
+/*
+ *  Returns the record starting at a sector of a track that was read, or NULL
+ *  if there is none there that is newer than minSeq.
+ */
+static kvRecordHeader *kvRecordAt(char *track, int sector, int minSeq)
+{
+    kvRecordHeader *header = (kvRecordHeader *) (track + sector * USLOSS_DISK_SECTOR_SIZE);
+    if (header->magic != KV_MAGIC || header->seq < minSeq || header->length < 0 ||
+        header->length > KV_MAX_VALUE ||
+        sector + kvRecordSectors(header->length) > USLOSS_DISK_TRACK_SIZE ||
+        header->key[KV_KEY_LENGTH - 1] != '\0')
+    {
+        return NULL;
+    }
+
+    unsigned int checksum = header->checksum;
+    header->checksum = 0;
+    unsigned int actual = kvChecksum((char *) header, sizeof(kvRecordHeader) + header->length);
+    header->checksum = checksum;
+    return checksum == actual ? header : NULL;
+}
+
+/*
+ *  Writes a record at the head of the log, moving to the next track if it
+ *  doesn't fit on this one, and fills in location with where it went. The
+ *  caller holds KvMutex and has made sure there is room. Returns 0, or the
+ *  disk status.
+ */
+static int kvAppend(char *key, void *value, int length, int flags, kvIndexEntry *location)
+{
+    int sectors = kvRecordSectors(length);
+    memset(KvRecord, 0, sectors * USLOSS_DISK_SECTOR_SIZE);
+    kvRecordHeader *header = (kvRecordHeader *) KvRecord;
+    header->magic = KV_MAGIC;
+    header->seq = KvNextSeq;
+    header->length = length;
+    header->flags = flags;
+    strcpy(header->key, key);
+    if (length > 0)
+    {
+        memmove(KvRecord + sizeof(kvRecordHeader), value, length);
+    }
+    header->checksum = kvChecksum(KvRecord, sizeof(kvRecordHeader) + length);
+
+    if (KvHeadSector + sectors > USLOSS_DISK_TRACK_SIZE)
+    {
+        // The head must never catch up with the tail
+        if ((KvHead + 1) % KvTracks == KvTail)
+        {
+            return USLOSS_DEV_ERROR;
+        }
+        KvHead = (KvHead + 1) % KvTracks;
+        KvHeadSector = 0;
+        KvTrackFirstSeq[KvHead] = EMPTY;
+    }
+
+    int status;
+    if (DiskWrite(KvRecord, KvUnit, KvHead + 1, KvHeadSector, sectors, &status) == -1)
+    {
+        return USLOSS_DEV_ERROR;
+    }
+    if (status != 0)
+    {
+        return status;
+    }
+
+    if (KvTrackFirstSeq[KvHead] == EMPTY)
+    {
+        KvTrackFirstSeq[KvHead] = KvNextSeq;
+    }
+    strcpy(location->key, key);
+    location->seq = KvNextSeq;
+    location->track = KvHead;
+    location->sector = KvHeadSector;
+    location->sectors = sectors;
+    location->length = length;
+    location->tombstone = FALSE;
+    KvNextSeq++;
+    KvHeadSector += sectors;
+    return 0;
+}
+
+/*
+ *  Writes the superblock. Returns the disk status.
+ */
+static int kvWriteSuperblock()
+{
+    memset(KvSuperBuffer, 0, sizeof(KvSuperBuffer));
+    kvSuperblock *superblock = (kvSuperblock *) KvSuperBuffer;
+    superblock->magic = KV_MAGIC;
+    superblock->minSeq = KvMinSeq;
+
+    int status;
+    if (DiskWrite(KvSuperBuffer, KvUnit, 0, 0, 1, &status) == -1)
+    {
+        return USLOSS_DEV_ERROR;
+    }
+    return status;
+}
+
+/*
+ *  Takes KvMutex once the log has room for a record of the given number of
+ *  sectors, besides the compactor's reserve, waking the compactor while
+ *  there isn't. Returns -1 if the store was closed.
+ */
+static int kvWaitForSpace(int sectors)
+{
+    SemP(KvMutex);
+    while (kvFreeSectors() < sectors + KV_RESERVE_SECTORS)
+    {
+        if (KvStopping)
+        {
+            SemV(KvMutex);
+            return -1;
+        }
+        kvWakeCompactor();
+        KvSpaceWaiters++;
+        SemV(KvMutex);
+        SemP(KvSpaceSem);
+        SemP(KvMutex);
+    }
+    return 0;
+}
+
+/*
+ *  Wakes the compactor, unless it has been woken already. Called with KvMutex
+ *  held.
+ */
+static void kvWakeCompactor()
+{
+    if (!KvCompactorWoken)
+    {
+        KvCompactorWoken = TRUE;
+        SemV(KvWakeSem);
+    }
+}
+
+/*
+ *  Returns the number of sectors not between the tail and the head of the log
+ */
+static int kvFreeSectors()
+{
+    int used = ((KvHead - KvTail + KvTracks) % KvTracks) * USLOSS_DISK_TRACK_SIZE + KvHeadSector;
+    return KvTracks * USLOSS_DISK_TRACK_SIZE - used;
+}
+
+/*
+ *  Returns the number of sectors a record with a value of the given length
+ *  takes
+ */
+static int kvRecordSectors(int length)
+{
+    return (sizeof(kvRecordHeader) + length + USLOSS_DISK_SECTOR_SIZE - 1) /
+           USLOSS_DISK_SECTOR_SIZE;
+}
+
+static int kvKeyValid(char *key)
+{
+    return key != NULL && key[0] != '\0' && strlen(key) < KV_KEY_LENGTH;
+}
+
+static unsigned int kvChecksum(char *data, int bytes)
+{
+    unsigned int checksum = 2166136261u;
+    for (int i = 0; i < bytes; i++)
+    {
+        checksum = (checksum ^ (unsigned char) data[i]) * 16777619u;
+    }
+    return checksum;
+}
+
+static int kvHash(char *key)
+{
+    return kvChecksum(key, strlen(key)) % KV_HASH_BUCKETS;
+}
+
+/*
+ *  Returns the index entry for key, or EMPTY if it has none
+ */
+static int kvFind(char *key)
+{
+    for (int i = KvBuckets[kvHash(key)]; i != EMPTY; i = KvIndex[i].next)
+    {
+        if (strcmp(KvIndex[i].key, key) == 0)
+        {
+            return i;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Adds an entry for key to the index, or returns EMPTY if the index is full
+ */
+static int kvInsert(char *key)
+{
+    int entry = KvFreeEntries;
+    if (entry == EMPTY)
+    {
+        return EMPTY;
+    }
+    KvFreeEntries = KvIndex[entry].next;
+
+    memset(&KvIndex[entry], 0, sizeof(kvIndexEntry));
+    strcpy(KvIndex[entry].key, key);
+    KvIndex[entry].seq = EMPTY;
+    KvIndex[entry].next = KvBuckets[kvHash(key)];
+    KvBuckets[kvHash(key)] = entry;
+    KvKeys++;
+    return entry;
+}
+
+/*
+ *  Takes the entry for key out of the index
+ */
+static void kvRemove(char *key)
+{
+    int *link = &KvBuckets[kvHash(key)];
+    while (*link != EMPTY && strcmp(KvIndex[*link].key, key) != 0)
+    {
+        link = &KvIndex[*link].next;
+    }
+    if (*link == EMPTY)
+    {
+        return;
+    }
+
+    int entry = *link;
+    *link = KvIndex[entry].next;
+    KvIndex[entry].key[0] = '\0';
+    KvIndex[entry].next = KvFreeEntries;
+    KvFreeEntries = entry;
+    KvKeys--;
+}
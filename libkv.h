@@ -0,0 +1,56 @@
+#ifndef _LIBKV_H
+#define _LIBKV_H
+
+#include "devices.h"
+
+// Largest log, in tracks, and most keys the store holds
+#define KV_MAX_TRACKS           256
+#define KV_MAX_KEYS             256
+#define KV_HASH_BUCKETS         64
+
+// Most sectors one record takes, header included
+#define KV_RECORD_SECTORS       ((int) (sizeof(kvRecordHeader) + KV_MAX_VALUE + \
+                                 USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE)
+
+// Sectors kept free for the compactor to copy records into, and the free
+// space below which it is woken
+#define KV_RESERVE_SECTORS      (2 * USLOSS_DISK_TRACK_SIZE)
+#define KV_COMPACT_SECTORS      (4 * USLOSS_DISK_TRACK_SIZE)
+
+#define KV_MAGIC                0x4b564c21
+#define KV_TOMBSTONE            1
+
+// The start of every record. The key and value follow it, and the record is
+// padded out to whole sectors. checksum covers the record with checksum 0.
+typedef struct kvRecordHeader
+{
+    int magic;
+    int seq;
+    int length;
+    int flags;
+    unsigned int checksum;
+    char key[KV_KEY_LENGTH];
+} kvRecordHeader;
+
+// Where the newest record for a key is. track is counted from the first log
+// track. next links entries in the same hash bucket, or free entries.
+typedef struct kvIndexEntry
+{
+    char key[KV_KEY_LENGTH];
+    int seq;
+    int track;
+    int sector;
+    int sectors;
+    int length;
+    int tombstone;
+    int next;
+} kvIndexEntry;
+
+// Track 0 sector 0 of the unit. Records with a lower seq than minSeq are dead.
+typedef struct kvSuperblock
+{
+    int magic;
+    int minSeq;
+} kvSuperblock;
+
+#endif
@@ -151,6 +151,489 @@ int DiskSize(int unit, int *sector, int *track, int *disk)
     return returnStatus;
 }
 
+/*
+ *  Submits several disk reads and writes at once (diskSubmitBatch).
+ *  Input:
+ *    arg1: the array of requests
+ *    arg2: the number of requests in the array
+ *  Output:
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ *  The status field of each request is filled in by the kernel.
+ */
+int DiskSubmitBatch(DiskBatchRequest *requests, int n)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskSubmitBatch(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKBATCH;
+    sysArg.arg1 = (void *) requests;
+    sysArg.arg2 = (void *) ((long) n);
+
+    USLOSS_Syscall(&sysArg);
+
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Sets the I/O priority class of the calling process's disk requests (diskSetIOClass).
+ *  Input:
+ *    arg1: the I/O priority class
+ *  Output:
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskSetIOClass(int ioClass)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskSetIOClass(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKIOCLASS;
+    sysArg.arg1 = (void *) ((long) ioClass);
+
+    USLOSS_Syscall(&sysArg);
+
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Returns the statistics gathered for a disk (diskStats).
+ *  Input:
+ *    arg1: the unit number of the disk
+ *    arg2: the address of the DiskStatistics struct to fill in
+ *  Output:
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskStats(int unit, DiskStatistics *stats)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskStats(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKSTATS;
+    sysArg.arg1 = (void *) ((long) unit);
+    sysArg.arg2 = (void *) stats;
+
+    USLOSS_Syscall(&sysArg);
+
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Copies sectors from one place on the disks to another inside the kernel (diskCopy).
+ *  Input:
+ *    arg1: the unit number of the source disk
+ *    arg2: the first source sector, counted from track 0 sector 0
+ *    arg3: the unit number of the destination disk
+ *    arg4: the first destination sector, counted from track 0 sector 0
+ *    arg5: number of sectors to copy
+ *  Output:
+ *    arg1: 0 if the copy was successful; the disk status register otherwise.
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskCopy(int srcUnit, int srcTrack, int srcFirst, int dstUnit, int dstTrack,
+             int dstFirst, int sectors, int *status)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskCopy(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKCOPY;
+    sysArg.arg1 = (void *) ((long) srcUnit);
+    sysArg.arg2 = (void *) ((long) (srcTrack * USLOSS_DISK_TRACK_SIZE + srcFirst));
+    sysArg.arg3 = (void *) ((long) dstUnit);
+    sysArg.arg4 = (void *) ((long) (dstTrack * USLOSS_DISK_TRACK_SIZE + dstFirst));
+    sysArg.arg5 = (void *) ((long) sectors);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg1 in status
+    *status = (int) ((long) sysArg.arg1);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Fills sectors of a disk with one byte value inside the kernel (diskFill).
+ *  Input:
+ *    arg1: the unit number of the disk
+ *    arg2: the first sector, counted from track 0 sector 0
+ *    arg3: number of sectors to fill
+ *    arg4: the byte to fill them with
+ *  Output:
+ *    arg1: 0 if the fill was successful; the disk status register otherwise.
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskFill(int unit, int track, int first, int sectors, int pattern, int *status)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskFill(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKFILL;
+    sysArg.arg1 = (void *) ((long) unit);
+    sysArg.arg2 = (void *) ((long) (track * USLOSS_DISK_TRACK_SIZE + first));
+    sysArg.arg3 = (void *) ((long) sectors);
+    sysArg.arg4 = (void *) ((long) pattern);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg1 in status
+    *status = (int) ((long) sysArg.arg1);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Reports how full the queue of a disk is (diskQueueDepth).
+ *  Input:
+ *    arg1: the unit number of the disk
+ *  Output:
+ *    arg1: number of requests admitted to the queue
+ *    arg2: most requests the queue admits, or 0 if there is no limit
+ *    arg3: number of processes waiting for room in the queue
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskQueueDepth(int unit, int *depth, int *limit, int *waiting)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskQueueDepth(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKQUEUEDEPTH;
+    sysArg.arg1 = (void *) ((long) unit);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg1, arg2 and arg3 in depth, limit and waiting
+    *depth = (int) ((long) sysArg.arg1);
+    *limit = (int) ((long) sysArg.arg2);
+    *waiting = (int) ((long) sysArg.arg3);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Maps sectors of a track into memory through the buffer cache (diskMap).
+ *  Input:
+ *    arg1: the unit number of the disk
+ *    arg2: the first sector, counted from track 0 sector 0
+ *    arg3: number of sectors to map, all on one track
+ *  Output:
+ *    arg1: address of the mapped sectors, which are only to be read
+ *    arg2: 0 if the track was loaded; the disk status register otherwise.
+ *    arg4: -1 if illegal values are given as input or the cache is full;
+ *          0 otherwise.
+ */
+int DiskMap(int unit, int track, int first, int sectors, void **region, int *status)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskMap(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKMAP;
+    sysArg.arg1 = (void *) ((long) unit);
+    sysArg.arg2 = (void *) ((long) (track * USLOSS_DISK_TRACK_SIZE + first));
+    sysArg.arg3 = (void *) ((long) sectors);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4, put arg1 in region and arg2 in status
+    *region = sysArg.arg1;
+    *status = (int) ((long) sysArg.arg2);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Releases sectors mapped by DiskMap (diskUnmap).
+ *  Input:
+ *    arg1: the address DiskMap returned
+ *  Output:
+ *    arg4: -1 if the address isn't mapped; 0 otherwise.
+ */
+int DiskUnmap(void *region)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskUnmap(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKUNMAP;
+    sysArg.arg1 = region;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (int) ((long) sysArg.arg4);
+}
+
+/*
+ *  Reads bytes from a disk, starting at any byte (diskPread).
+ *  Input:
+ *    arg1: the memory address to read into
+ *    arg2: the unit number of the disk
+ *    arg3: the first byte, counted from track 0 sector 0
+ *    arg4: number of bytes to read
+ *  Output:
+ *    arg1: 0 if the read was successful; the disk status register otherwise.
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskPread(void *buffer, int unit, int offset, int length, int *status)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskPread(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKPREAD;
+    sysArg.arg1 = buffer;
+    sysArg.arg2 = (void *) ((long) unit);
+    sysArg.arg3 = (void *) ((long) offset);
+    sysArg.arg4 = (void *) ((long) length);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg1 in status
+    *status = (int) ((long) sysArg.arg1);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Writes bytes to a disk, starting at any byte (diskPwrite). The parts of
+ *  sectors that aren't written keep what they held.
+ *  Input:
+ *    arg1: the memory address to write from
+ *    arg2: the unit number of the disk
+ *    arg3: the first byte, counted from track 0 sector 0
+ *    arg4: number of bytes to write
+ *  Output:
+ *    arg1: 0 if the write was successful; the disk status register otherwise.
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskPwrite(void *buffer, int unit, int offset, int length, int *status)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskPwrite(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKPWRITE;
+    sysArg.arg1 = buffer;
+    sysArg.arg2 = (void *) ((long) unit);
+    sysArg.arg3 = (void *) ((long) offset);
+    sysArg.arg4 = (void *) ((long) length);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg1 in status
+    *status = (int) ((long) sysArg.arg1);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Tells the buffer cache how a range of tracks will be read (diskAdvise).
+ *  Input:
+ *    arg1: the unit number of the disk
+ *    arg2: the first track of the range
+ *    arg3: number of tracks in the range
+ *    arg4: one of the DISK_ADVISE hints
+ *  Output:
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskAdvise(int unit, int track, int tracks, int hint)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskAdvise(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKADVISE;
+    sysArg.arg1 = (void *) ((long) unit);
+    sysArg.arg2 = (void *) ((long) track);
+    sysArg.arg3 = (void *) ((long) tracks);
+    sysArg.arg4 = (void *) ((long) hint);
+
+    USLOSS_Syscall(&sysArg);
+
+    return (int) ((long) sysArg.arg4);
+}
+
+/*
+ *  Orders the requests to a disk (diskBarrier): everything queued for the unit
+ *  before the call is done before anything queued after it. Doesn't wait.
+ *  Input:
+ *    arg1: the unit number of the disk
+ *  Output:
+ *    arg4: -1 if illegal values are given as input; 0 otherwise.
+ */
+int DiskBarrier(int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskBarrier(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_DISKBARRIER;
+    sysArg.arg1 = (void *) ((long) unit);
+
+    USLOSS_Syscall(&sysArg);
+
+    return (int) ((long) sysArg.arg4);
+}
+
+/*
+ *  Opens a file in the file store (fileOpen).
+ *  Input:
+ *    arg1: the name of the file
+ *    arg2: DISK_FILE_CREATE, DISK_FILE_TRUNCATE and DISK_FILE_APPEND flags
+ *  Output:
+ *    arg1: the file descriptor
+ *    arg4: -1 if illegal values are given as input or the file can't be
+ *          opened; 0 otherwise.
+ */
+int FileOpen(char *name, int flags, int *fd)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("FileOpen(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_FILEOPEN;
+    sysArg.arg1 = (void *) name;
+    sysArg.arg2 = (void *) ((long) flags);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg1 in fd
+    *fd = (int) ((long) sysArg.arg1);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Reads from the file position of an open file (fileRead).
+ *  Input:
+ *    arg1: the file descriptor
+ *    arg2: address of the user's buffer
+ *    arg3: the most bytes to read
+ *  Output:
+ *    arg2: number of bytes read, 0 at the end of the file.
+ *    arg4: -1 if illegal values are given as input or the disk fails;
+ *          0 otherwise.
+ */
+int FileRead(int fd, void *buffer, int bytes, int *bytesRead)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("FileRead(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_FILEREAD;
+    sysArg.arg1 = (void *) ((long) fd);
+    sysArg.arg2 = buffer;
+    sysArg.arg3 = (void *) ((long) bytes);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg2 in bytesRead
+    *bytesRead = (int) ((long) sysArg.arg2);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Writes at the file position of an open file (fileWrite).
+ *  Input:
+ *    arg1: the file descriptor
+ *    arg2: address of the user's buffer
+ *    arg3: number of bytes to write
+ *  Output:
+ *    arg2: number of bytes written, fewer than asked if the disk is full.
+ *    arg4: -1 if illegal values are given as input or the disk fails;
+ *          0 otherwise.
+ */
+int FileWrite(int fd, void *buffer, int bytes, int *bytesWritten)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("FileWrite(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_FILEWRITE;
+    sysArg.arg1 = (void *) ((long) fd);
+    sysArg.arg2 = buffer;
+    sysArg.arg3 = (void *) ((long) bytes);
+
+    USLOSS_Syscall(&sysArg);
+
+    // Return arg4 and put arg2 in bytesWritten
+    *bytesWritten = (int) ((long) sysArg.arg2);
+    int returnStatus = (int) ((long) sysArg.arg4);
+
+    return returnStatus;
+}
+
+/*
+ *  Closes an open file (fileClose).
+ *  Input:
+ *    arg1: the file descriptor
+ *  Output:
+ *    arg4: -1 if the descriptor isn't open; 0 otherwise.
+ */
+int FileClose(int fd)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("FileClose(): called.\n");
+    }
+    USLOSS_Sysargs sysArg;
+    CHECKMODE;
+    sysArg.number = SYS_FILECLOSE;
+    sysArg.arg1 = (void *) ((long) fd);
+
+    USLOSS_Syscall(&sysArg);
+
+    return (int) ((long) sysArg.arg4);
+}
+
 /*
  *  Read a line from a terminal (termRead).
  *  Input:
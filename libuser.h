@@ -5,6 +5,8 @@
 #ifndef _LIBUSER_H
 #define _LIBUSER_H
 
+#include "phase4.h"
+
 // Phase 3 -- User Function Prototypes
 extern int  Spawn(char *name, int (*func)(char *), char *arg, int stack_size,
                   int priority, int *pid);
@@ -25,6 +27,32 @@ extern int  DiskRead(void *dbuff, int unit, int track, int first,
 extern int  DiskWrite(void *dbuff, int unit, int track, int first,
                       int sectors,int *status);
 extern int  DiskSize(int unit, int *sector, int *track, int *disk);
+extern int  DiskSubmitBatch(DiskBatchRequest *requests, int n);
+extern int  DiskSetIOClass(int ioClass);
+extern int  DiskStats(int unit, DiskStatistics *stats);
+extern int  DiskCopy(int srcUnit, int srcTrack, int srcFirst, int dstUnit,
+                     int dstTrack, int dstFirst, int sectors, int *status);
+extern int  DiskFill(int unit, int track, int first, int sectors, int pattern,
+                     int *status);
+extern int  DiskQueueDepth(int unit, int *depth, int *limit, int *waiting);
+extern int  DiskMap(int unit, int track, int first, int sectors,
+                    void **region, int *status);
+extern int  DiskUnmap(void *region);
+extern int  DiskPread(void *buffer, int unit, int offset, int length,
+                      int *status);
+extern int  DiskPwrite(void *buffer, int unit, int offset, int length,
+                       int *status);
+extern int  DiskAdvise(int unit, int track, int tracks, int hint);
+extern int  DiskBarrier(int unit);
+extern int  FileOpen(char *name, int flags, int *fd);
+extern int  FileRead(int fd, void *buffer, int bytes, int *bytesRead);
+extern int  FileWrite(int fd, void *buffer, int bytes, int *bytesWritten);
+extern int  FileClose(int fd);
+extern int  KvOpen(int unit);
+extern int  KvClose(void);
+extern int  KvPut(char *key, void *value, int length);
+extern int  KvGet(char *key, void *value, int size, int *length);
+extern int  KvDelete(char *key);
 extern int  TermRead(char *buff, int bsize, int unit_id, int *nread);
 extern int  TermWrite(char *buff, int bsize, int unit_id, int *nwrite);
 
@@ -1,6 +1,7 @@
 #include <usloss.h>
 
 extern int debugflag4;
+extern void forgetDiskProcess(int);
 
 void
 p1_fork(int pid)
@@ -21,4 +22,5 @@ p1_quit(int pid)
 {
     //if (DEBUG4 && debugflag4)
 //        USLOSS_Console("p1_quit() called: pid = %d\n", pid);
+    forgetDiskProcess(pid);
 } /* p1_quit */
@@ -22,6 +22,12 @@
 #include "phase4clock.h"
 #include "phase4disk.h"
 #include "phase4term.h"
+#include "phase4log.h"
+#include "phase4sparse.h"
+#include "phase4compress.h"
+#include "phase4relocate.h"
+#include "phase4file.h"
+#include "phase4cache.h"
 
 // Debugging flag
 int debugflag4 = 0;
@@ -36,12 +42,21 @@ semaphore diskSem[USLOSS_DISK_UNITS];
 int diskMutex[USLOSS_DISK_UNITS];
 
 // Disk Queue stuff
-extern processPtr DiskDriverQueue[USLOSS_DISK_UNITS];
-extern processPtr NextDiskRequest[USLOSS_DISK_UNITS];
+extern diskRequestPtr DiskDriverQueue[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern diskRequestPtr NextDiskRequest[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskActivePid[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskBudgetLeft[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskHeadTrack[USLOSS_DISK_UNITS];
+
+// Log-structured units
+extern semaphore logCleanSem[USLOSS_DISK_UNITS];
 
 // Driver process functions
 static int ClockDriver(char *);
 static int DiskDriver(char *);
+static int LogCleaner(char *);
+static int DiskUnplugger(char *);
+static int DiskRelocator(char *);
 static int TermDriver(char *);
 static int TermReader(char *);
 static int TermWriter(char *);
@@ -49,6 +64,9 @@ static int TermWriter(char *);
 // Phase 4 proc table
 process ProcTable[MAXPROC];
 int diskPIDs[USLOSS_DISK_UNITS];
+int logCleanerPIDs[USLOSS_DISK_UNITS];
+int diskUnpluggerPID = EMPTY;
+int relocatorPIDs[USLOSS_DISK_UNITS];
 int termPIDs[USLOSS_TERM_UNITS];
 int termReaderPIDs[USLOSS_TERM_UNITS];
 int termWriterPIDs[USLOSS_TERM_UNITS];
@@ -75,7 +93,9 @@ int start3(char *args)
     char name[128];
     int clockPID;
     int	status;
-    char buf[10];
+    char diskArgs[USLOSS_DISK_UNITS][10];
+    char termArgs[USLOSS_TERM_UNITS][10];
+    int numDrivers = 0;
 
     // Check kernel mode
     checkMode("start3");
@@ -89,6 +109,22 @@ int start3(char *args)
     systemCallVec[SYS_DISKREAD] = diskRead;
     systemCallVec[SYS_DISKWRITE] = diskWrite;
     systemCallVec[SYS_DISKSIZE] = diskSize;
+    systemCallVec[SYS_DISKBATCH] = diskSubmitBatch;
+    systemCallVec[SYS_DISKIOCLASS] = diskSetIOClass;
+    systemCallVec[SYS_DISKSTATS] = diskStats;
+    systemCallVec[SYS_DISKCOPY] = diskCopy;
+    systemCallVec[SYS_DISKFILL] = diskFill;
+    systemCallVec[SYS_FILEOPEN] = fileOpen;
+    systemCallVec[SYS_FILEREAD] = fileRead;
+    systemCallVec[SYS_FILEWRITE] = fileWrite;
+    systemCallVec[SYS_FILECLOSE] = fileClose;
+    systemCallVec[SYS_DISKMAP] = diskMap;
+    systemCallVec[SYS_DISKUNMAP] = diskUnmap;
+    systemCallVec[SYS_DISKQUEUEDEPTH] = diskQueueDepth;
+    systemCallVec[SYS_DISKPREAD] = diskPread;
+    systemCallVec[SYS_DISKPWRITE] = diskPwrite;
+    systemCallVec[SYS_DISKADVISE] = diskAdvise;
+    systemCallVec[SYS_DISKBARRIER] = diskBarrier;
     systemCallVec[SYS_TERMREAD] = termRead;
     systemCallVec[SYS_TERMWRITE] = termWrite;
 
@@ -102,11 +138,40 @@ int start3(char *args)
         processPtr proc = &ProcTable[i % MAXPROC];
         clearProc(proc);
         proc->privateMboxID = MboxCreate(0, MAX_MESSAGE);
+        proc->diskCompletionMboxID = MboxCreate(MAXDISKBATCH, 0);
+        proc->diskIOClass = DISK_IOCLASS_BE;
+        proc->diskIOClassPid = EMPTY;
+        proc->diskAdmissionSem = semcreateReal(0);
+        proc->nextDiskAdmission = NULL;
+        for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+        {
+            proc->diskQueued[unit] = 0;
+        }
     }
 
     // Create the running semaphore
     running = semcreateReal(0);
 
+    // Start tracing disk requests, if asked to
+    openDiskTrace();
+
+    // Create the mutexes DiskPwrite patches sectors under
+    initDiskPwrite();
+
+    // Set up the file store, which is read in by the first FileOpen
+    initFileStore();
+
+    // Empty the buffer cache, which the disk drivers write through
+    initDiskCache();
+
+    // The disk drivers wake the unplugger when they plug their queues
+    diskUnplugSem = semcreateReal(0);
+
+    // Fork every driver before waiting for any of them, so that the disk
+    // drivers probe their disks at the same time. Each driver Vs running once
+    // it is ready, and each gets its own argument string since they start
+    // before the loops move on.
+
     // Create clock device driver
     if (DEBUG4 && debugflag4)
     {
@@ -118,9 +183,7 @@ int start3(char *args)
         USLOSS_Console("start3(): Can't create clock driver\n");
         USLOSS_Halt(1);
     }
-
-    // Wait for the clock driver to start. ClockDriver will V running once it starts.
-    sempReal(running);
+    numDrivers++;
 
     // Create the disk device drivers
     for (int i = 0; i < USLOSS_DISK_UNITS; i++)
@@ -129,18 +192,16 @@ int start3(char *args)
         {
             USLOSS_Console("start3(): Creating disk device driver %d.\n", i);
         }
-        sprintf(buf, "%d", i);
+        sprintf(diskArgs[i], "%d", i);
         sprintf(name, "DiskDriver %d", i);
-        int pid = fork1(name, DiskDriver, buf, USLOSS_MIN_STACK, 2);
+        int pid = fork1(name, DiskDriver, diskArgs[i], USLOSS_MIN_STACK, 2);
         diskPIDs[i] = pid;
         if (pid < 0)
         {
             USLOSS_Console("start3(): Can't create disk driver %d\n", i);
             USLOSS_Halt(1);
         }
-
-        // Wait for the driver to start
-        sempReal(running);
+        numDrivers++;
     }
 
     // Create terminal device processes
@@ -151,18 +212,16 @@ int start3(char *args)
         {
             USLOSS_Console("start3(): Creating terminal device driver %d.\n", i);
         }
-        sprintf(buf, "%d", i);
+        sprintf(termArgs[i], "%d", i);
         sprintf(name, "TermDriver %d", i);
-        int pid = fork1(name, TermDriver, buf, USLOSS_MIN_STACK, 2);
+        int pid = fork1(name, TermDriver, termArgs[i], USLOSS_MIN_STACK, 2);
         termPIDs[i] = pid;
         if (pid < 0)
         {
             USLOSS_Console("start3(): Can't create term driver %d.\n", i);
             USLOSS_Halt(1);
         }
-
-        // Wait for the driver to start
-        sempReal(running);
+        numDrivers++;
 
         // Create the reader
         if (DEBUG4 && debugflag4)
@@ -170,16 +229,14 @@ int start3(char *args)
             USLOSS_Console("start3(): Creating terminal reader %d.\n", i);
         }
         sprintf(name, "TermReader %d", i);
-        pid = fork1(name, TermReader, buf, USLOSS_MIN_STACK, 2);
+        pid = fork1(name, TermReader, termArgs[i], USLOSS_MIN_STACK, 2);
         termReaderPIDs[i] = pid;
         if (pid < 0)
         {
             USLOSS_Console("start3(): Can't create term reader %d.\n", i);
             USLOSS_Halt(1);
         }
-
-        // Wait for the reader to start
-        sempReal(running);
+        numDrivers++;
 
         // Create the writer
         if (DEBUG4 && debugflag4)
@@ -187,18 +244,84 @@ int start3(char *args)
             USLOSS_Console("start3(); Creating terminal writer %d.\n", i);
         }
         sprintf(name, "TermWriter %d", i);
-        pid = fork1(name, TermWriter, buf, USLOSS_MIN_STACK, 2);
+        pid = fork1(name, TermWriter, termArgs[i], USLOSS_MIN_STACK, 2);
         termWriterPIDs[i] = pid;
         if (pid < 0)
         {
             USLOSS_Console("start3(): Can't create term writer %d.\n", i);
             USLOSS_Halt(1);
         }
+        numDrivers++;
+    }
 
-        // Wait for the writer to start
+    // Wait for all of the drivers to start
+    for (int i = 0; i < numDrivers; i++)
+    {
         sempReal(running);
     }
 
+    // Create a cleaner for each log-structured disk. This waits for the disk
+    // drivers, which set up the logs and can turn log-structured mode off.
+    for (int i = 0; i < USLOSS_DISK_UNITS; i++)
+    {
+        logCleanerPIDs[i] = EMPTY;
+        if (!diskLogStructured[i])
+        {
+            continue;
+        }
+        if (DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("start3(): Creating log cleaner %d.\n", i);
+        }
+        sprintf(name, "LogCleaner %d", i);
+        int pid = fork1(name, LogCleaner, diskArgs[i], USLOSS_MIN_STACK, 4);
+        logCleanerPIDs[i] = pid;
+        if (pid < 0)
+        {
+            USLOSS_Console("start3(): Can't create log cleaner %d\n", i);
+            USLOSS_Halt(1);
+        }
+    }
+
+    // Create a relocator for each disk whose tracks can be relocated. Like the
+    // cleaners, these wait for the drivers to load their maps.
+    for (int i = 0; i < USLOSS_DISK_UNITS; i++)
+    {
+        relocatorPIDs[i] = EMPTY;
+        if (!diskRelocate[i])
+        {
+            continue;
+        }
+        if (DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("start3(): Creating relocator %d.\n", i);
+        }
+        sprintf(name, "DiskRelocator %d", i);
+        int pid = fork1(name, DiskRelocator, diskArgs[i], USLOSS_MIN_STACK, 5);
+        relocatorPIDs[i] = pid;
+        if (pid < 0)
+        {
+            USLOSS_Console("start3(): Can't create relocator %d\n", i);
+            USLOSS_Halt(1);
+        }
+    }
+
+    // Create the unplugger for plugged disk queues. It runs at the lowest
+    // priority, so that it only unplugs a queue when nothing else can run.
+    if (diskPlug)
+    {
+        if (DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("start3(): Creating disk unplugger.\n");
+        }
+        diskUnpluggerPID = fork1("DiskUnplugger", DiskUnplugger, NULL, USLOSS_MIN_STACK, 5);
+        if (diskUnpluggerPID < 0)
+        {
+            USLOSS_Console("start3(): Can't create disk unplugger\n");
+            USLOSS_Halt(1);
+        }
+    }
+
     // Create first user-level process and wait for it to finish.
     if (DEBUG4 && debugflag4)
     {
@@ -212,17 +335,55 @@ int start3(char *args)
     }
     pid = waitReal(&status);
 
+    // Report what the disks did
+    if (diskStatsAtShutdown)
+    {
+        for (int i = 0; i < USLOSS_DISK_UNITS; i++)
+        {
+            printDiskStats(i);
+        }
+    }
+
+    // Write back the file store while the disk drivers still run
+    flushFileStore();
+
+    // Remember the hottest cached tracks for the next boot
+    saveDiskCache();
+
     // Zap the device drivers
     if (DEBUG4 && debugflag4)
     {
         USLOSS_Console("start3(): Zapping device drivers.\n");
     }
     zap(clockPID);
+    if (diskUnpluggerPID != EMPTY)
+    {
+        semvReal(diskUnplugSem);
+        zap(diskUnpluggerPID);
+    }
     for (int i = 0; i < USLOSS_DISK_UNITS; i++)
     {
+        // Stop the cleaner or relocator and save the sector or block map while
+        // the driver still runs. The relocator saves its map as it goes.
+        if (relocatorPIDs[i] != EMPTY)
+        {
+            semvReal(relocateSem[i]);
+            zap(relocatorPIDs[i]);
+        }
+        if (logCleanerPIDs[i] != EMPTY)
+        {
+            semvReal(logCleanSem[i]);
+            zap(logCleanerPIDs[i]);
+            checkpointLog(i);
+        }
+        else if (diskCompressed[i])
+        {
+            checkpointCompress(i);
+        }
         semvReal(diskSem[i]);
         zap(diskPIDs[i]);
     }
+    closeDiskTrace();
     for (int i = 0; i < USLOSS_TERM_UNITS; i++)
     {
         if (DEBUG4 && debugflag4)
@@ -297,6 +458,9 @@ static int ClockDriver(char *arg)
 
         // Check the queue and unblock procs
         checkClockQueue(status);
+
+        // Unplug the disk queues that have waited long enough
+        expireDiskPlugs();
     }
     return 0;
 }
@@ -350,9 +514,60 @@ static int DiskDriver(char *arg)
     }
     returnMutex(diskMutex[unit]);
 
+    // The head starts at track 0
+    DiskHeadTrack[unit] = 0;
+
     // Initialize the disk queue stuff
-    DiskDriverQueue[unit] = NULL;
-    NextDiskRequest[unit] = NULL;
+    for (int i = 0; i < DISK_IOCLASSES; i++)
+    {
+        DiskDriverQueue[unit][i] = NULL;
+        NextDiskRequest[unit][i] = NULL;
+        DiskActivePid[unit][i] = EMPTY;
+        DiskBudgetLeft[unit][i] = 0;
+    }
+    DiskAnticipatePid[unit] = EMPTY;
+    diskPlugSem[unit] = semcreateReal(0);
+    DiskPlugged[unit] = FALSE;
+    DiskPlugDrained[unit] = TRUE;
+
+    // Time seeks of different lengths, if asked to
+    DiskSeekCalibrated[unit] = FALSE;
+    if (diskSeekCalibrate)
+    {
+        calibrateSeeks(unit);
+    }
+
+    // Find the sectors that hold only zeros, if asked to
+    if (diskSparseSectors && diskZeroScan)
+    {
+        scanZeroSectors(unit);
+    }
+
+    // Load the sector map of a log-structured disk, the block map of a
+    // compressed one, or the track map of a relocating one. A disk can only
+    // have one.
+    if (diskLogStructured[unit] && diskCompressed[unit])
+    {
+        USLOSS_Console("DiskDriver(%d): A disk can't be both log structured and compressed.\n", unit);
+        diskCompressed[unit] = FALSE;
+    }
+    if ((diskLogStructured[unit] || diskCompressed[unit]) && diskRelocate[unit])
+    {
+        USLOSS_Console("DiskDriver(%d): A disk with a sector or block map can't relocate tracks.\n", unit);
+        diskRelocate[unit] = FALSE;
+    }
+    if (diskLogStructured[unit])
+    {
+        initLog(unit);
+    }
+    else if (diskCompressed[unit])
+    {
+        initCompress(unit);
+    }
+    else if (diskRelocate[unit])
+    {
+        initRelocate(unit);
+    }
 
     // Enable interrupts and tell parent that we're running
     semvReal(running);
@@ -365,6 +580,13 @@ static int DiskDriver(char *arg)
             USLOSS_Console("DiskDriver(%d): Now looking for another request to fulfill.\n", unit);
         }
 
+        // Read the tracks asked for by DiskAdvise, or ahead of sequential
+        // reads, and those that were hot at the last shutdown into the cache,
+        // one at a time while nothing is queued
+        while (!isZapped() && prefetchCacheTrack(unit))
+        {
+        }
+
         // Make sure there is something on the queue
         if (DEBUG4 && debugflag4)
         {
@@ -377,28 +599,153 @@ static int DiskDriver(char *arg)
             break;
         }
 
+        // Tracks to prefetch were queued while we waited
+        if (takePrefetchWakeup(unit))
+        {
+            continue;
+        }
+
+        // If the queue is plugged, let the rest of a burst of requests come in
+        if (waitForPluggedRequests(unit))
+        {
+            sempReal(diskPlugSem[unit]);
+        }
+
+        // In anticipatory mode, give the process whose read just finished a
+        // moment to ask for the next one. Seeking to the track the head is
+        // on blocks the driver briefly, letting the process run, before it
+        // checks the clock again.
+        while (waitForAnticipatedRequest(unit))
+        {
+            seekTrack(unit, DiskHeadTrack[unit]);
+        }
+
         // Dequeue a disk request
         if (DEBUG4 && debugflag4)
         {
             USLOSS_Console("DiskDriver(%d): Now dequeueing a request\n", unit);
         }
-        processPtr requestProc = dequeueDiskRequest(unit);
-        if (requestProc == NULL)
+        diskRequestPtr request = dequeueDiskRequest(unit);
+        if (request == NULL)
         {
             USLOSS_Console("DiskDriver(%d): Awoken without a request.\n", unit);
             USLOSS_Halt(1);
         }
 
+        // Its place in the queue can go to a waiting process
+        releaseDiskAdmission(request);
+
         if(DEBUG4 && debugflag4)
         {
             USLOSS_Console("DiskDriver(%d): Performing disk operation.\n", unit);
         }
 
         // Perform the request
-        performDiskOp(requestProc);
+        performDiskOp(request);
+        anticipateNextRequest(request);
 
         // Unblock the process that requested the disk operation
-        unblockByMbox(requestProc);
+        finishDiskRequest(request);
+    }
+    return 0;
+}
+
+/*
+ * Entry function for the cleaner of a log-structured disk. It sleeps until a
+ * writer wakes it, then cleans segments until there is enough free space.
+ */
+static int LogCleaner(char *arg)
+{
+    if (DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("LogCleaner(): called.\n");
+    }
+
+    // Ensure that we are in kernel mode
+    checkMode("LogCleaner");
+
+    int unit = atoi(arg);
+
+    // start3 doesn't wait for the cleaner, which has nothing to set up
+    enableInterrupts();
+
+    while (!isZapped())
+    {
+        sempReal(logCleanSem[unit]);
+        if (isZapped())
+        {
+            break;
+        }
+
+        initProc();
+        while (!isZapped() && logNeedsCleaning(unit))
+        {
+            if (cleanLogSegment(unit) == -1)
+            {
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Entry function for the relocator of a disk. It sleeps until enough tracks
+ * have been accessed, then moves a hot track closer to the others.
+ */
+static int DiskRelocator(char *arg)
+{
+    if (DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskRelocator(): called.\n");
+    }
+
+    // Ensure that we are in kernel mode
+    checkMode("DiskRelocator");
+
+    int unit = atoi(arg);
+
+    enableInterrupts();
+
+    while (!isZapped())
+    {
+        sempReal(relocateSem[unit]);
+        if (isZapped())
+        {
+            break;
+        }
+
+        initProc();
+        relocateHotTrack(unit);
+    }
+    return 0;
+}
+
+/*
+ * Entry function for the disk unplugger. It sleeps until a disk driver plugs
+ * its queue. Since it has the lowest priority, it then runs only once every
+ * process that could add to the queue is blocked, and unplugs it.
+ */
+static int DiskUnplugger(char *arg)
+{
+    if (DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("DiskUnplugger(): called.\n");
+    }
+
+    // Ensure that we are in kernel mode
+    checkMode("DiskUnplugger");
+
+    enableInterrupts();
+
+    while (!isZapped())
+    {
+        sempReal(diskUnplugSem);
+        if (isZapped())
+        {
+            break;
+        }
+        unplugDiskQueues();
     }
     return 0;
 }
@@ -11,6 +11,132 @@
 
 #define MAXLINE         80
 
+/*
+ * Maximum number of requests in a single DiskSubmitBatch call
+ */
+
+#define MAXDISKBATCH    32
+
+/*
+ * Virtual disk units, numbered after the physical ones. DISK_RAID0_UNIT stripes
+ * its sectors across all of the physical units. DISK_RAID1_UNIT keeps a copy
+ * of every sector on each physical unit.
+ */
+
+#define DISK_RAID0_UNIT         (USLOSS_DISK_UNITS)
+#define DISK_RAID1_UNIT         (USLOSS_DISK_UNITS + 1)
+#define DISK_VIRTUAL_UNITS      2
+
+/*
+ * System call numbers for the phase 4 extensions
+ */
+
+#define SYS_DISKBATCH           34
+#define SYS_DISKIOCLASS         35
+#define SYS_DISKSTATS           36
+#define SYS_DISKCOPY            37
+#define SYS_DISKFILL            38
+#define SYS_FILEOPEN            39
+#define SYS_FILEREAD            40
+#define SYS_FILEWRITE           41
+#define SYS_FILECLOSE           42
+#define SYS_DISKMAP             43
+#define SYS_DISKUNMAP           44
+#define SYS_DISKQUEUEDEPTH      45
+#define SYS_DISKPREAD           46
+#define SYS_DISKPWRITE          47
+#define SYS_DISKADVISE          48
+#define SYS_DISKBARRIER         49
+
+/*
+ * I/O priority classes for disk requests. Realtime requests are always served
+ * before best-effort ones, and idle requests are only served when nothing else
+ * is queued for the unit. DISK_IOCLASS_DEFAULT uses the class of the process.
+ */
+
+#define DISK_IOCLASS_DEFAULT    -1
+#define DISK_IOCLASS_RT         0
+#define DISK_IOCLASS_BE         1
+#define DISK_IOCLASS_IDLE       2
+#define DISK_IOCLASSES          3
+
+/*
+ * One entry of a DiskSubmitBatch call. op is USLOSS_DISK_READ,
+ * USLOSS_DISK_WRITE or DISK_BATCH_BARRIER. A barrier entry only uses unit, and
+ * acts as a DiskBarrier on it between the entries before and after it.
+ * ioClass is one of the DISK_IOCLASS values. status is filled in when the
+ * batch completes: -1 for invalid parameters, 0 for success, or the disk's
+ * status register.
+ */
+
+#define DISK_BATCH_BARRIER      16
+
+typedef struct DiskBatchRequest
+{
+    int   op;
+    void *buffer;
+    int   unit;
+    int   track;
+    int   first;
+    int   sectors;
+    int   ioClass;
+    int   status;
+} DiskBatchRequest;
+
+/*
+ * Counters for one disk unit, returned by DiskStats. Bucket 0 of each
+ * histogram counts requests that took under 1 ms; bucket i > 0 counts those
+ * that took [2^(i-1), 2^i) ms, and the last bucket also holds anything longer.
+ * waitHistogram measures time spent queued, serviceHistogram time at the disk.
+ */
+
+#define DISK_STATS_BUCKETS      12
+
+typedef struct DiskStatistics
+{
+    int   requests;               // requests completed
+    int   sectors;                // sectors transferred
+    int   seeks;                  // seeks that moved the head
+    int   seekDistance;           // total tracks moved by those seeks
+    int   queueDepth;             // requests queued right now
+    int   maxQueueDepth;          // high-water mark of queueDepth
+    int   waitHistogram[DISK_STATS_BUCKETS];
+    int   serviceHistogram[DISK_STATS_BUCKETS];
+} DiskStatistics;
+
+/*
+ * Hints for DiskAdvise about how a range of tracks will be read.
+ * DISK_ADVISE_SEQUENTIAL reads tracks ahead of the reads into the cache,
+ * DISK_ADVISE_RANDOM never does, and DISK_ADVISE_NORMAL goes back to the
+ * default. DISK_ADVISE_WILLNEED reads the tracks into the cache while the disk
+ * is idle, and DISK_ADVISE_DONTNEED drops them from it.
+ */
+
+#define DISK_ADVISE_NORMAL      0
+#define DISK_ADVISE_SEQUENTIAL  1
+#define DISK_ADVISE_RANDOM      2
+#define DISK_ADVISE_WILLNEED    3
+#define DISK_ADVISE_DONTNEED    4
+
+/*
+ * Flags for FileOpen. DISK_FILE_CREATE makes the file if it doesn't exist,
+ * DISK_FILE_TRUNCATE empties it, and DISK_FILE_APPEND starts the file position
+ * at its end. File names are shorter than DISK_FILE_NAME_LENGTH.
+ */
+
+#define DISK_FILE_CREATE        1
+#define DISK_FILE_TRUNCATE      2
+#define DISK_FILE_APPEND        4
+#define DISK_FILE_NAME_LENGTH   16
+
+/*
+ * Limits of the key-value store kept by KvOpen. Keys are shorter than
+ * KV_KEY_LENGTH, and values hold at most KV_MAX_VALUE bytes.
+ */
+
+#define KV_KEY_LENGTH           16
+#define KV_MAX_VALUE            2000
+
 /*
  * Function prototypes for this phase.
  */
@@ -22,6 +148,32 @@ extern  int  DiskRead (void *diskBuffer, int unit, int track, int first,
 extern  int  DiskWrite(void *diskBuffer, int unit, int track, int first,
                        int sectors, int *status);
 extern  int  DiskSize (int unit, int *sector, int *track, int *disk);
+extern  int  DiskSubmitBatch(DiskBatchRequest *requests, int n);
+extern  int  DiskSetIOClass(int ioClass);
+extern  int  DiskStats(int unit, DiskStatistics *stats);
+extern  int  DiskCopy (int srcUnit, int srcTrack, int srcFirst, int dstUnit,
+                       int dstTrack, int dstFirst, int sectors, int *status);
+extern  int  DiskFill (int unit, int track, int first, int sectors, int pattern,
+                       int *status);
+extern  int  DiskQueueDepth(int unit, int *depth, int *limit, int *waiting);
+extern  int  DiskMap  (int unit, int track, int first, int sectors,
+                       void **region, int *status);
+extern  int  DiskUnmap(void *region);
+extern  int  DiskPread(void *buffer, int unit, int offset, int length,
+                       int *status);
+extern  int  DiskPwrite(void *buffer, int unit, int offset, int length,
+                        int *status);
+extern  int  DiskAdvise(int unit, int track, int tracks, int hint);
+extern  int  DiskBarrier(int unit);
+extern  int  FileOpen (char *name, int flags, int *fd);
+extern  int  FileRead (int fd, void *buffer, int bytes, int *bytesRead);
+extern  int  FileWrite(int fd, void *buffer, int bytes, int *bytesWritten);
+extern  int  FileClose(int fd);
+extern  int  KvOpen   (int unit);
+extern  int  KvClose  (void);
+extern  int  KvPut    (char *key, void *value, int length);
+extern  int  KvGet    (char *key, void *value, int size, int *length);
+extern  int  KvDelete (char *key);
 extern  int  TermRead (char *buffer, int bufferSize, int unitID,
                        int *numCharsRead);
 extern  int  TermWrite(char *buffer, int bufferSize, int unitID,
@@ -0,0 +1,823 @@
+/*
+ *  File: phase4cache.c
+ *  Purpose: This file holds functions and global variables for the disk
+ *  buffer cache, which keeps whole tracks of the physical units in memory.
+ *  DiskMap loads a track into the cache and returns a pointer to sectors of
+ *  it, which stay in place until DiskUnmap releases them. DiskRead is served
+ *  from the cache when every sector it asks for is there, and the disk
+ *  drivers copy each sector they write into the cache, so cached tracks
+ *  always match the disk.
+ *
+ *  For a warm start, the tracks that served the most hits are listed in a
+ *  host file at shutdown, and the disk drivers read them back into the cache
+ *  at the next boot whenever they have nothing else to do.
+ *
+ *  DiskAdvise steers the cache for a range of tracks: the tracks a process
+ *  will need are read in the same way while the disk is idle, tracks it won't
+ *  are dropped, and reads through a range advised as sequential are followed
+ *  by reading the next tracks ahead of them.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4cache.h"
+
+extern int debugflag4;
+extern int DiskSizes[USLOSS_DISK_UNITS];
+extern int diskMutex[USLOSS_DISK_UNITS];
+extern DiskStatistics DiskUnitStats[USLOSS_DISK_UNITS];
+extern semaphore diskSem[USLOSS_DISK_UNITS];
+
+// Mutex for the cache entries, and a semaphore that processes waiting for a
+// track to finish loading block on
+int diskCacheMutex;
+int diskCacheLoadSem;
+
+// Cache warm start. When diskCacheWarmFile names a host file, start3 saves
+// the hottest cached tracks to it, one "unit track hits" line each, and
+// initDiskCache reads it back into a list of tracks to prefetch for each unit,
+// in track order.
+char *diskCacheWarmFile = NULL;
+static int DiskCacheWarm[USLOSS_DISK_UNITS][DISK_CACHE_WARM_PER_UNIT];
+static int DiskCacheWarmCount[USLOSS_DISK_UNITS];
+static int DiskCacheWarmNext[USLOSS_DISK_UNITS];
+
+// Read-ahead. DiskCacheAdvice holds the DiskAdvise hint for each track, and
+// DiskCachePrefetch the tracks asked for by DISK_ADVISE_WILLNEED or read
+// ahead, which the driver of each unit reads before its warm start list.
+// Without advice, a read that starts on or just after the last track read is
+// followed by reading one track ahead if diskReadAhead is set.
+// DiskCacheWakeups counts the times diskSem was signalled to have a driver
+// prefetch rather than serve a request.
+int diskReadAhead = FALSE;
+static char DiskCacheAdvice[USLOSS_DISK_UNITS][DISK_ADVISE_MAX_TRACKS];
+static int DiskCacheLastRead[USLOSS_DISK_UNITS];
+static int DiskCachePrefetch[USLOSS_DISK_UNITS][DISK_CACHE_TRACKS];
+static int DiskCachePrefetchCount[USLOSS_DISK_UNITS];
+static int DiskCacheWakeups[USLOSS_DISK_UNITS];
+
+static cacheEntry DiskCache[DISK_CACHE_TRACKS];
+static cachePin DiskCachePins[DISK_CACHE_PINS];
+static char DiskCacheData[DISK_CACHE_TRACKS][DISK_CACHE_TRACK_BYTES];
+static int DiskCacheLoadWaiters;
+static int DiskCacheClock;
+
+static int findCacheEntry(int, int);
+static int cacheableUnit(int);
+static int addCachePin(int, int);
+static void loadCacheWarmList();
+static int queuePrefetch(int, int);
+static void wakeForPrefetch(int);
+
+/*
+ *  Empties the cache and reads the list of tracks to warm it with. Called by
+ *  start3 before the disk drivers start.
+ */
+void initDiskCache()
+{
+    diskCacheMutex = MboxCreate(1, 0);
+    returnMutex(diskCacheMutex);
+    diskCacheLoadSem = semcreateReal(0);
+    DiskCacheLoadWaiters = 0;
+    DiskCacheClock = 0;
+    for (int i = 0; i < DISK_CACHE_TRACKS; i++)
+    {
+        DiskCache[i].unit = EMPTY;
+        DiskCache[i].track = EMPTY;
+        DiskCache[i].valid = FALSE;
+        DiskCache[i].loading = FALSE;
+        DiskCache[i].pins = 0;
+        DiskCache[i].lastUse = 0;
+        DiskCache[i].hits = 0;
+    }
+    for (int i = 0; i < DISK_CACHE_PINS; i++)
+    {
+        DiskCachePins[i].pid = EMPTY;
+    }
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        memset(DiskCacheAdvice[unit], DISK_ADVISE_NORMAL, DISK_ADVISE_MAX_TRACKS);
+        DiskCacheLastRead[unit] = EMPTY;
+        DiskCachePrefetchCount[unit] = 0;
+        DiskCacheWakeups[unit] = 0;
+    }
+    loadCacheWarmList();
+}
+
+/*
+ *  Copies sectors into buffer from the cache if all of them are cached.
+ *  Returns TRUE if it did.
+ */
+int cacheRead(int unit, void *buffer, int sectors, int track, int first)
+{
+    if (!cacheableUnit(unit))
+    {
+        return FALSE;
+    }
+
+    getMutex(diskCacheMutex);
+    int hit = TRUE;
+    for (int i = 0; i < sectors && hit; i++)
+    {
+        int entry = findCacheEntry(unit, track + (first + i) / USLOSS_DISK_TRACK_SIZE);
+        hit = entry != EMPTY && DiskCache[entry].valid;
+    }
+    for (int i = 0; i < sectors && hit; i++)
+    {
+        int entry = findCacheEntry(unit, track + (first + i) / USLOSS_DISK_TRACK_SIZE);
+        int sector = (first + i) % USLOSS_DISK_TRACK_SIZE;
+        memcpy(buffer + i * USLOSS_DISK_SECTOR_SIZE,
+               DiskCacheData[entry] + sector * USLOSS_DISK_SECTOR_SIZE, USLOSS_DISK_SECTOR_SIZE);
+        DiskCache[entry].lastUse = ++DiskCacheClock;
+        DiskCache[entry].hits++;
+    }
+    returnMutex(diskCacheMutex);
+    return hit;
+}
+
+/*
+ *  Queues the tracks after a read for the driver to prefetch, if the read is
+ *  in a range advised as sequential, or if diskReadAhead is set and the read
+ *  follows on from the last one. Tracks advised as random are never read
+ *  ahead. Called by diskReadReal once the sectors have been read.
+ */
+void cacheReadAhead(int unit, int track, int first, int sectors)
+{
+    if (!cacheableUnit(unit))
+    {
+        return;
+    }
+
+    int last = track + (first + sectors - 1) / USLOSS_DISK_TRACK_SIZE;
+    int advice = last < DISK_ADVISE_MAX_TRACKS ? DiskCacheAdvice[unit][last] : DISK_ADVISE_NORMAL;
+    int window = 0;
+    getMutex(diskCacheMutex);
+    if (advice == DISK_ADVISE_SEQUENTIAL)
+    {
+        window = DISK_ADVISE_READAHEAD;
+    }
+    else if (advice == DISK_ADVISE_NORMAL && diskReadAhead && DiskCacheLastRead[unit] != EMPTY &&
+             (track == DiskCacheLastRead[unit] || track == DiskCacheLastRead[unit] + 1))
+    {
+        window = 1;
+    }
+    DiskCacheLastRead[unit] = last;
+
+    int queued = FALSE;
+    for (int next = last + 1; next <= last + window && next < DiskSizes[unit]; next++)
+    {
+        if (next >= DISK_ADVISE_MAX_TRACKS || DiskCacheAdvice[unit][next] != DISK_ADVISE_RANDOM)
+        {
+            queued |= queuePrefetch(unit, next);
+        }
+    }
+    returnMutex(diskCacheMutex);
+
+    if (queued)
+    {
+        wakeForPrefetch(unit);
+    }
+}
+
+/*
+ *  Copies a sector the driver just wrote into the cache, if its track is
+ *  cached or being loaded. Called by the disk drivers.
+ */
+void cacheNoteWrite(int unit, int track, int sector, void *data)
+{
+    getMutex(diskCacheMutex);
+    int entry = findCacheEntry(unit, track);
+    if (entry != EMPTY)
+    {
+        memcpy(DiskCacheData[entry] + sector * USLOSS_DISK_SECTOR_SIZE, data,
+               USLOSS_DISK_SECTOR_SIZE);
+    }
+    returnMutex(diskCacheMutex);
+}
+
+/*
+ *  System call for user function DiskMap. Serves as a bridge between DiskMap
+ *  and diskMapReal
+ */
+void diskMap(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskMap(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKMAP)
+    {
+        USLOSS_Console("diskMap(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int unit = (int) ((long) args->arg1);
+    int start = (int) ((long) args->arg2);
+    int sectors = (int) ((long) args->arg3);
+
+    void *region = NULL;
+    int result = diskMapReal(unit, start / USLOSS_DISK_TRACK_SIZE,
+                             start % USLOSS_DISK_TRACK_SIZE, sectors, &region);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg1 = NULL;
+        args->arg2 = (void*) -1;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = region;
+        args->arg2 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Pins sectors sectors of a track of a physical unit in the cache, starting
+ *  at sector first, loading the track from the disk if it isn't cached, and
+ *  sets *region to where they are. The sectors must all be on the one track.
+ *  The region is only to be read, and stays valid until the process that
+ *  mapped it passes it to diskUnmapReal.
+ *  Return values:
+ *    -1: invalid parameters, or every track in the cache or every pin record
+ *        is in use
+ *     0: the sectors are mapped
+ *    >0: the disk's status register from loading the track
+ */
+int diskMapReal(int unit, int track, int first, int sectors, void **region)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskMapReal(): called.\n");
+    }
+
+    int sectorSize, trackSize, tracks;
+    if (!cacheableUnit(unit) || diskSizeReal(unit, &sectorSize, &trackSize, &tracks) == -1 ||
+        track < 0 || track >= tracks || first < 0 || sectors < 1 ||
+        first + sectors > USLOSS_DISK_TRACK_SIZE || region == NULL)
+    {
+        return -1;
+    }
+
+    getMutex(diskCacheMutex);
+    int entry = findCacheEntry(unit, track);
+    while (entry != EMPTY && DiskCache[entry].loading)
+    {
+        // Someone else is loading the track
+        DiskCacheLoadWaiters++;
+        returnMutex(diskCacheMutex);
+        sempReal(diskCacheLoadSem);
+        getMutex(diskCacheMutex);
+        entry = findCacheEntry(unit, track);
+    }
+
+    if (entry != EMPTY)
+    {
+        if (addCachePin(entry, first) == EMPTY)
+        {
+            returnMutex(diskCacheMutex);
+            return -1;
+        }
+        DiskCache[entry].pins++;
+        DiskCache[entry].lastUse = ++DiskCacheClock;
+        DiskCache[entry].hits++;
+        *region = DiskCacheData[entry] + first * USLOSS_DISK_SECTOR_SIZE;
+        returnMutex(diskCacheMutex);
+        return 0;
+    }
+
+    // Reuse the least recently used track that isn't pinned
+    for (int i = 0; i < DISK_CACHE_TRACKS; i++)
+    {
+        if (DiskCache[i].pins == 0 && !DiskCache[i].loading &&
+            (entry == EMPTY || DiskCache[i].lastUse < DiskCache[entry].lastUse))
+        {
+            entry = i;
+        }
+    }
+    int pin = entry == EMPTY ? EMPTY : addCachePin(entry, first);
+    if (pin == EMPTY)
+    {
+        returnMutex(diskCacheMutex);
+        return -1;
+    }
+    cacheEntry *cached = &DiskCache[entry];
+    cached->unit = unit;
+    cached->track = track;
+    cached->valid = FALSE;
+    cached->loading = TRUE;
+    cached->pins = 1;
+    cached->lastUse = ++DiskCacheClock;
+    cached->hits = 0;
+    returnMutex(diskCacheMutex);
+
+    // Load the whole track, half at a time since a request must be shorter
+    // than a track
+    int half = USLOSS_DISK_TRACK_SIZE / 2;
+    int status = diskReadReal(DiskCacheData[entry], half, track, 0, unit);
+    if (status == 0)
+    {
+        status = diskReadReal(DiskCacheData[entry] + half * USLOSS_DISK_SECTOR_SIZE,
+                              USLOSS_DISK_TRACK_SIZE - half, track, half, unit);
+    }
+
+    getMutex(diskCacheMutex);
+    cached->loading = FALSE;
+    if (status == 0)
+    {
+        cached->valid = TRUE;
+        *region = DiskCacheData[entry] + first * USLOSS_DISK_SECTOR_SIZE;
+    }
+    else
+    {
+        cached->unit = EMPTY;
+        cached->track = EMPTY;
+        cached->pins = 0;
+        DiskCachePins[pin].pid = EMPTY;
+    }
+    for (; DiskCacheLoadWaiters > 0; DiskCacheLoadWaiters--)
+    {
+        semvReal(diskCacheLoadSem);
+    }
+    returnMutex(diskCacheMutex);
+    return status;
+}
+
+/*
+ *  System call for user function DiskUnmap. Serves as a bridge between
+ *  DiskUnmap and diskUnmapReal
+ */
+void diskUnmap(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskUnmap(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKUNMAP)
+    {
+        USLOSS_Console("diskUnmap(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int result = diskUnmapReal(args->arg1);
+    args->arg4 = (void *) ((long) result);
+
+    setToUserMode();
+}
+
+/*
+ *  Releases a region returned by diskMapReal to the calling process. Once
+ *  nothing in its track is mapped, the track may be dropped from the cache.
+ *  Return values:
+ *    -1: region is not a region the calling process mapped
+ *     0: the region was released
+ */
+int diskUnmapReal(void *region)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskUnmapReal(): called.\n");
+    }
+
+    int pid = getpid();
+    int result = -1;
+    getMutex(diskCacheMutex);
+    for (int i = 0; i < DISK_CACHE_PINS && result == -1; i++)
+    {
+        if (DiskCachePins[i].pid == pid && DiskCachePins[i].base == region)
+        {
+            DiskCache[DiskCachePins[i].entry].pins--;
+            DiskCachePins[i].pid = EMPTY;
+            result = 0;
+        }
+    }
+    returnMutex(diskCacheMutex);
+    return result;
+}
+
+/*
+ *  System call for user function DiskAdvise. Serves as a bridge between
+ *  DiskAdvise and diskAdviseReal
+ */
+void diskAdvise(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskAdvise(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKADVISE)
+    {
+        USLOSS_Console("diskAdvise(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int unit = (int) ((long) args->arg1);
+    int track = (int) ((long) args->arg2);
+    int tracks = (int) ((long) args->arg3);
+    int hint = (int) ((long) args->arg4);
+
+    int result = diskAdviseReal(unit, track, tracks, hint);
+    args->arg4 = (void *) ((long) result);
+
+    setToUserMode();
+}
+
+/*
+ *  Applies a DISK_ADVISE hint to tracks tracks of unit, starting at track.
+ *  Advice about a unit whose sectors aren't cached, such as a virtual unit,
+ *  is accepted and has no effect.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: the advice was taken
+ */
+int diskAdviseReal(int unit, int track, int tracks, int hint)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskAdviseReal(): called.\n");
+    }
+
+    int sectorSize, trackSize, numTracks;
+    if (diskSizeReal(unit, &sectorSize, &trackSize, &numTracks) == -1 || track < 0 ||
+        tracks < 1 || track > numTracks - tracks || hint < DISK_ADVISE_NORMAL ||
+        hint > DISK_ADVISE_DONTNEED)
+    {
+        return -1;
+    }
+    if (!cacheableUnit(unit))
+    {
+        return 0;
+    }
+
+    int queued = FALSE;
+    getMutex(diskCacheMutex);
+    for (int t = track; t < track + tracks; t++)
+    {
+        if (hint == DISK_ADVISE_WILLNEED)
+        {
+            queued |= queuePrefetch(unit, t);
+        }
+        else if (hint == DISK_ADVISE_DONTNEED)
+        {
+            // Forget any prefetch of the track, and drop it unless it is
+            // mapped or being loaded; the cache is written through, so the
+            // disk already holds what it held
+            int count = 0;
+            for (int i = 0; i < DiskCachePrefetchCount[unit]; i++)
+            {
+                if (DiskCachePrefetch[unit][i] != t)
+                {
+                    DiskCachePrefetch[unit][count++] = DiskCachePrefetch[unit][i];
+                }
+            }
+            DiskCachePrefetchCount[unit] = count;
+
+            int entry = findCacheEntry(unit, t);
+            if (entry != EMPTY && DiskCache[entry].pins == 0 && !DiskCache[entry].loading)
+            {
+                DiskCache[entry].unit = EMPTY;
+                DiskCache[entry].track = EMPTY;
+                DiskCache[entry].valid = FALSE;
+                DiskCache[entry].lastUse = 0;
+                DiskCache[entry].hits = 0;
+            }
+        }
+        else if (t < DISK_ADVISE_MAX_TRACKS)
+        {
+            DiskCacheAdvice[unit][t] = hint;
+        }
+    }
+    returnMutex(diskCacheMutex);
+
+    if (queued)
+    {
+        wakeForPrefetch(unit);
+    }
+    return 0;
+}
+
+/*
+ *  Writes the DISK_CACHE_WARM_PER_UNIT cached tracks of each unit with the
+ *  most hits to diskCacheWarmFile, hottest first. Tracks that served no hits
+ *  are left out. Called by start3 at shutdown.
+ */
+void saveDiskCache()
+{
+    if (diskCacheWarmFile == NULL)
+    {
+        return;
+    }
+
+    FILE *file = fopen(diskCacheWarmFile, "w");
+    if (file == NULL)
+    {
+        USLOSS_Console("saveDiskCache(): Could not open %s.\n", diskCacheWarmFile);
+        return;
+    }
+
+    getMutex(diskCacheMutex);
+    int saved[DISK_CACHE_TRACKS] = {0};
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        for (int i = 0; i < DISK_CACHE_WARM_PER_UNIT; i++)
+        {
+            int hottest = EMPTY;
+            for (int j = 0; j < DISK_CACHE_TRACKS; j++)
+            {
+                if (!saved[j] && DiskCache[j].unit == unit && DiskCache[j].valid &&
+                    DiskCache[j].hits > 0 &&
+                    (hottest == EMPTY || DiskCache[j].hits > DiskCache[hottest].hits))
+                {
+                    hottest = j;
+                }
+            }
+            if (hottest == EMPTY)
+            {
+                break;
+            }
+            saved[hottest] = TRUE;
+            fprintf(file, "%d %d %d\n", unit, DiskCache[hottest].track, DiskCache[hottest].hits);
+        }
+    }
+    returnMutex(diskCacheMutex);
+    fclose(file);
+}
+
+/*
+ *  Reads the next track to prefetch for a unit into the cache, if nothing is
+ *  queued for the unit: first the tracks asked for by DiskAdvise or read
+ *  ahead, then those on the warm start list. Tracks that are already cached,
+ *  or that don't fit on the disk, are skipped. Called by the driver of the
+ *  unit before it waits for a request. Returns TRUE if there may be more to
+ *  prefetch.
+ */
+int prefetchCacheTrack(int unit)
+{
+    if (!cacheableUnit(unit))
+    {
+        return FALSE;
+    }
+
+    getMutex(diskMutex[unit]);
+    int idle = DiskUnitStats[unit].queueDepth == 0;
+    returnMutex(diskMutex[unit]);
+    if (!idle)
+    {
+        return FALSE;
+    }
+
+    getMutex(diskCacheMutex);
+    int track;
+    if (DiskCachePrefetchCount[unit] > 0)
+    {
+        track = DiskCachePrefetch[unit][0];
+        DiskCachePrefetchCount[unit]--;
+        memmove(DiskCachePrefetch[unit], DiskCachePrefetch[unit] + 1,
+                DiskCachePrefetchCount[unit] * sizeof(int));
+    }
+    else if (DiskCacheWarmNext[unit] < DiskCacheWarmCount[unit])
+    {
+        track = DiskCacheWarm[unit][DiskCacheWarmNext[unit]++];
+    }
+    else
+    {
+        returnMutex(diskCacheMutex);
+        return FALSE;
+    }
+    if (track >= DiskSizes[unit] || findCacheEntry(unit, track) != EMPTY)
+    {
+        returnMutex(diskCacheMutex);
+        return TRUE;
+    }
+
+    // Take the least recently used track that isn't pinned
+    int entry = EMPTY;
+    for (int i = 0; i < DISK_CACHE_TRACKS; i++)
+    {
+        if (DiskCache[i].pins == 0 && !DiskCache[i].loading &&
+            (entry == EMPTY || DiskCache[i].lastUse < DiskCache[entry].lastUse))
+        {
+            entry = i;
+        }
+    }
+    if (entry == EMPTY)
+    {
+        returnMutex(diskCacheMutex);
+        return FALSE;
+    }
+    cacheEntry *cached = &DiskCache[entry];
+    cached->unit = unit;
+    cached->track = track;
+    cached->valid = FALSE;
+    cached->loading = TRUE;
+    cached->lastUse = ++DiskCacheClock;
+    cached->hits = 0;
+    returnMutex(diskCacheMutex);
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("prefetchCacheTrack(%d): reading track %d.\n", unit, track);
+    }
+
+    // The driver reads the track itself, as it does when it scans for zeros
+    diskRequest request;
+    clearRequest(&request);
+    request.op = DISK_READ;
+    request.memAddress = DiskCacheData[entry];
+    request.numSectors = USLOSS_DISK_TRACK_SIZE;
+    request.startTrack = track;
+    request.startSector = 0;
+    request.unit = unit;
+    int result = performDiskOp(&request);
+
+    getMutex(diskCacheMutex);
+    cached->loading = FALSE;
+    if (result == 0 && request.resultStatus == 0)
+    {
+        cached->valid = TRUE;
+    }
+    else
+    {
+        cached->unit = EMPTY;
+        cached->track = EMPTY;
+    }
+    for (; DiskCacheLoadWaiters > 0; DiskCacheLoadWaiters--)
+    {
+        semvReal(diskCacheLoadSem);
+    }
+    returnMutex(diskCacheMutex);
+    return result == 0;
+}
+
+/*
+ *  Returns TRUE, and uses it up, if diskSem of a unit was signalled by
+ *  wakeForPrefetch rather than for a request. Called by the driver of the
+ *  unit each time it is woken.
+ */
+int takePrefetchWakeup(int unit)
+{
+    getMutex(diskCacheMutex);
+    int wakeup = DiskCacheWakeups[unit] > 0;
+    if (wakeup)
+    {
+        DiskCacheWakeups[unit]--;
+    }
+    returnMutex(diskCacheMutex);
+    return wakeup;
+}
+
+/*
+ *  Reads diskCacheWarmFile, if there is one, into the warm start lists of the
+ *  units, each sorted by track so that the prefetches sweep the disk once
+ */
+static void loadCacheWarmList()
+{
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        DiskCacheWarmCount[unit] = 0;
+        DiskCacheWarmNext[unit] = 0;
+    }
+    if (diskCacheWarmFile == NULL)
+    {
+        return;
+    }
+
+    FILE *file = fopen(diskCacheWarmFile, "r");
+    if (file == NULL)
+    {
+        // Nothing was saved yet
+        return;
+    }
+
+    int unit, track, hits;
+    while (fscanf(file, "%d %d %d", &unit, &track, &hits) == 3)
+    {
+        if (unit < 0 || unit >= USLOSS_DISK_UNITS || track < 0 ||
+            DiskCacheWarmCount[unit] == DISK_CACHE_WARM_PER_UNIT)
+        {
+            continue;
+        }
+
+        // Insert the track in order
+        int *list = DiskCacheWarm[unit];
+        int i = DiskCacheWarmCount[unit]++;
+        for (; i > 0 && list[i - 1] > track; i--)
+        {
+            list[i] = list[i - 1];
+        }
+        list[i] = track;
+    }
+    fclose(file);
+}
+
+/*
+ *  Returns the cache entry holding a track, or EMPTY if it isn't cached.
+ *  Called with diskCacheMutex held.
+ */
+static int findCacheEntry(int unit, int track)
+{
+    for (int i = 0; i < DISK_CACHE_TRACKS; i++)
+    {
+        if (DiskCache[i].unit == unit && DiskCache[i].track == track)
+        {
+            return i;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Records that the calling process has mapped sectors of a cache entry
+ *  starting at sector first. Returns the pin record, or EMPTY if they are all
+ *  in use. The caller must hold diskCacheMutex.
+ */
+static int addCachePin(int entry, int first)
+{
+    for (int i = 0; i < DISK_CACHE_PINS; i++)
+    {
+        if (DiskCachePins[i].pid == EMPTY)
+        {
+            DiskCachePins[i].entry = entry;
+            DiskCachePins[i].pid = getpid();
+            DiskCachePins[i].base = DiskCacheData[entry] + first * USLOSS_DISK_SECTOR_SIZE;
+            return i;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Adds a track to the tracks the driver of a unit is to prefetch, unless it
+ *  is cached, already there, or there is no room. Returns TRUE if it was
+ *  added. Called with diskCacheMutex held.
+ */
+static int queuePrefetch(int unit, int track)
+{
+    if (findCacheEntry(unit, track) != EMPTY || DiskCachePrefetchCount[unit] == DISK_CACHE_TRACKS)
+    {
+        return FALSE;
+    }
+    for (int i = 0; i < DiskCachePrefetchCount[unit]; i++)
+    {
+        if (DiskCachePrefetch[unit][i] == track)
+        {
+            return FALSE;
+        }
+    }
+    DiskCachePrefetch[unit][DiskCachePrefetchCount[unit]++] = track;
+    return TRUE;
+}
+
+/*
+ *  Wakes the driver of a unit, if it isn't already being woken, so that it
+ *  prefetches the tracks queued for it. The driver tells the wakeup from a
+ *  request with takePrefetchWakeup.
+ */
+static void wakeForPrefetch(int unit)
+{
+    getMutex(diskCacheMutex);
+    int wake = DiskCacheWakeups[unit] == 0;
+    if (wake)
+    {
+        DiskCacheWakeups[unit]++;
+    }
+    returnMutex(diskCacheMutex);
+    if (wake)
+    {
+        semvReal(diskSem[unit]);
+    }
+}
+
+/*
+ *  Returns TRUE if the sectors of a unit are the sectors on its disk, which
+ *  isn't so for the virtual, log-structured, compressed and relocating units
+ */
+static int cacheableUnit(int unit)
+{
+    return unit >= 0 && unit < USLOSS_DISK_UNITS && !mappedDiskUnit(unit);
+}
@@ -0,0 +1,69 @@
+#ifndef _PHASE4CACHE_H
+#define _PHASE4CACHE_H
+
+#include "devices.h"
+
+// Number of tracks the buffer cache holds
+#define DISK_CACHE_TRACKS       32
+#define DISK_CACHE_TRACK_BYTES  (USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE)
+
+// Most tracks saved for a warm start, leaving the rest of the cache for the
+// tracks used after the boot. Each unit gets an equal share, so that a busy
+// unit can't leave the others cold.
+#define DISK_CACHE_WARM_TRACKS  (DISK_CACHE_TRACKS / 2)
+#define DISK_CACHE_WARM_PER_UNIT (DISK_CACHE_WARM_TRACKS / USLOSS_DISK_UNITS)
+
+// DiskAdvise keeps a hint for each of the first DISK_ADVISE_MAX_TRACKS tracks
+// of a unit. Sequential reads are followed by reading DISK_ADVISE_READAHEAD
+// tracks ahead when advised, and one track when only diskReadAhead is set.
+#define DISK_ADVISE_MAX_TRACKS  256
+#define DISK_ADVISE_READAHEAD   2
+
+// Most DiskMap regions that can be mapped at once
+#define DISK_CACHE_PINS         (4 * DISK_CACHE_TRACKS)
+
+// A track in the buffer cache. unit is EMPTY if the entry is free. pins
+// counts the DiskMap regions in the track that have not been unmapped; a
+// pinned entry is never reused. hits counts the reads and maps served from
+// the track since it was loaded.
+typedef struct cacheEntry
+{
+    int unit;
+    int track;
+    int valid;
+    int loading;
+    int pins;
+    int lastUse;
+    int hits;
+} cacheEntry;
+
+// A region mapped by DiskMap: the cache entry it pins, the process that
+// mapped it, and the address returned for it. pid is EMPTY if the record is
+// free.
+typedef struct cachePin
+{
+    int entry;
+    int pid;
+    char *base;
+} cachePin;
+
+extern char *diskCacheWarmFile;
+extern int diskReadAhead;
+
+extern void initDiskCache();
+extern int cacheRead(int, void *, int, int, int);
+extern void cacheNoteWrite(int, int, int, void *);
+extern void saveDiskCache();
+extern int prefetchCacheTrack(int);
+extern int takePrefetchWakeup(int);
+extern void cacheReadAhead(int, int, int, int);
+
+extern void diskMap(systemArgs *);
+extern void diskUnmap(systemArgs *);
+extern void diskAdvise(systemArgs *);
+
+extern int diskMapReal(int, int, int, int, void **);
+extern int diskUnmapReal(void *);
+extern int diskAdviseReal(int, int, int, int);
+
+#endif
@@ -0,0 +1,790 @@
+/*
+ *  File: phase4compress.c
+ *  Purpose: This file holds functions and global variables for the optional
+ *  compression layer of a disk unit. DiskRead and DiskWrite on a compressed unit
+ *  work in blocks of DISK_COMPRESS_BLOCK sectors. Each block is compressed with
+ *  a small LZ77 codec and stored in as few sectors as it needs, found through a
+ *  block map. The sectors of a block are allocated as close as possible to where
+ *  the block would sit on an uncompressed disk, so nearby blocks stay close.
+ *
+ *  The logical disk is as large as the physical one less the checkpoint tracks,
+ *  so there is always room for every block: compression saves transfer time,
+ *  not space. The map is checkpointed when start3 shuts down and loaded again
+ *  when the driver starts, which then marks the checkpoint stale on the disk.
+ *  Blocks are rewritten in place as they change, so after a stop without a
+ *  clean shutdown the old map would point at sectors other blocks now use; the
+ *  next boot finds the stale mark and starts over. Without a checkpoint the
+ *  unit starts out holding only zeros. DiskCopy, DiskFill, DiskSubmitBatch and
+ *  the RAID units name physical sectors, so they refuse a compressed unit.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4raid.h"
+#include "phase4sparse.h"
+#include "phase4compress.h"
+
+// The codec: matches are at least LZ_MIN_MATCH bytes, found through a hash
+// table of LZ_HASH_SIZE recent positions
+#define LZ_MIN_MATCH            4
+#define LZ_HASH_BITS            10
+#define LZ_HASH_SIZE            (1 << LZ_HASH_BITS)
+#define LZ_MAX_OFFSET           65535
+
+extern int debugflag4;
+extern int DiskSizes[USLOSS_DISK_UNITS];
+
+// Header of the checkpointed map
+typedef struct compressCheckpointHeader
+{
+    int magic;
+    int logicalTracks;
+} compressCheckpointHeader;
+
+// Set before start3 runs to compress a unit
+int diskCompressed[USLOSS_DISK_UNITS];
+
+// Mutex for the block map of each unit, and a semaphore processes wait on for
+// a locked block
+int compressMutex[USLOSS_DISK_UNITS];
+semaphore compressLockSem[USLOSS_DISK_UNITS];
+
+static int CompressTracks[USLOSS_DISK_UNITS];
+static int CompressBlocks[USLOSS_DISK_UNITS];
+
+// The block map, which physical sectors are in use, and which blocks are
+// locked by a read or write in progress
+static compressMapEntry CompressMap[USLOSS_DISK_UNITS][DISK_COMPRESS_MAX_BLOCKS];
+static char CompressSectorUsed[USLOSS_DISK_UNITS][DISK_COMPRESS_MAX_SECTORS];
+static char CompressBlockLocked[USLOSS_DISK_UNITS][DISK_COMPRESS_MAX_BLOCKS];
+static int CompressLockWaiters[USLOSS_DISK_UNITS];
+
+// Kernel buffers for each process: blocks as the caller sees them, and as
+// they are stored
+static unsigned char CompressPlain[MAXPROC][DISK_COMPRESS_SPAN][DISK_COMPRESS_BYTES];
+static unsigned char CompressPacked[MAXPROC][DISK_COMPRESS_SPAN][DISK_COMPRESS_BYTES];
+
+static char CompressCheckpointBuffer[USLOSS_DISK_UNITS][(1 + DISK_COMPRESS_MAP_SECTORS) * USLOSS_DISK_SECTOR_SIZE];
+
+static int rebuildCompress(int);
+static int loadCompressCheckpoint(int);
+static void markCompressCheckpointStale(int);
+static int compressMapSectors(int);
+static void lockCompressBlocks(int, int, int);
+static void unlockCompressBlocks(int, int, int);
+static void freeCompressBlock(int, int);
+static int allocCompressSector(int, int);
+static int compressedSectors(int);
+static int blockOverlap(int, int, int, int *, int *);
+static void addBlockRequests(processPtr, int, int, compressMapEntry *, unsigned char *);
+static int packBlock(unsigned char *, unsigned char *);
+static int unpackBlock(compressMapEntry *, unsigned char *, unsigned char *);
+
+/*
+ *  Sets up the compression layer of a unit. Called by the unit's driver once
+ *  the size of the disk is known, before the driver starts taking requests.
+ */
+void initCompress(int unit)
+{
+    compressMutex[unit] = MboxCreate(1, 0);
+    returnMutex(compressMutex[unit]);
+    compressLockSem[unit] = semcreateReal(0);
+
+    int tracks = DiskSizes[unit] - DISK_COMPRESS_CHECKPOINT_TRACKS;
+    if (DiskSizes[unit] > DISK_COMPRESS_MAX_TRACKS || tracks <= 0)
+    {
+        USLOSS_Console("initCompress(%d): A disk of %d tracks can't be compressed.\n",
+                       unit, DiskSizes[unit]);
+        diskCompressed[unit] = FALSE;
+        return;
+    }
+    CompressTracks[unit] = tracks;
+    CompressBlocks[unit] = tracks * USLOSS_DISK_TRACK_SIZE / DISK_COMPRESS_BLOCK;
+    CompressLockWaiters[unit] = 0;
+    memset(CompressBlockLocked[unit], 0, sizeof(CompressBlockLocked[unit]));
+
+    // Pick up the map from the last run, or start with every block empty
+    if (loadCompressCheckpoint(unit) == -1 || rebuildCompress(unit) == -1)
+    {
+        memset(CompressMap[unit], 0, sizeof(CompressMap[unit]));
+        rebuildCompress(unit);
+    }
+    markCompressCheckpointStale(unit);
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("initCompress(%d): %d blocks.\n", unit, CompressBlocks[unit]);
+    }
+}
+
+/*
+ *  Works out which sectors are in use from the block map. Returns -1 if the map
+ *  is not valid and 0 otherwise.
+ */
+static int rebuildCompress(int unit)
+{
+    int physicalSectors = CompressTracks[unit] * USLOSS_DISK_TRACK_SIZE;
+    memset(CompressSectorUsed[unit], 0, sizeof(CompressSectorUsed[unit]));
+    for (int block = 0; block < CompressBlocks[unit]; block++)
+    {
+        compressMapEntry *entry = &CompressMap[unit][block];
+        if (entry->length < 0 || entry->length > DISK_COMPRESS_BYTES)
+        {
+            return -1;
+        }
+        for (int i = 0; i < compressedSectors(entry->length); i++)
+        {
+            int p = entry->sectors[i];
+            if (p < 0 || p >= physicalSectors || CompressSectorUsed[unit][p])
+            {
+                return -1;
+            }
+            CompressSectorUsed[unit][p] = TRUE;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  Reads the checkpointed block map of a unit. A stale checkpoint means the map
+ *  of the last run was lost. This runs in the driver before it takes requests,
+ *  so it does the disk operation itself. Returns -1 if there is no usable
+ *  checkpoint and 0 otherwise.
+ */
+static int loadCompressCheckpoint(int unit)
+{
+    diskRequest request;
+    clearRequest(&request);
+    request.op = DISK_READ;
+    request.memAddress = CompressCheckpointBuffer[unit];
+    request.numSectors = 1 + compressMapSectors(unit);
+    request.startTrack = CompressTracks[unit];
+    request.startSector = 0;
+    request.unit = unit;
+    performDiskOp(&request);
+    if (request.resultStatus != 0)
+    {
+        return -1;
+    }
+
+    compressCheckpointHeader *header = (compressCheckpointHeader *) CompressCheckpointBuffer[unit];
+    if (header->magic == DISK_COMPRESS_STALE_MAGIC && header->logicalTracks == CompressTracks[unit])
+    {
+        USLOSS_Console("initCompress(%d): The unit was not shut down cleanly; its blocks are lost.\n",
+                       unit);
+        return -1;
+    }
+    if (header->magic != DISK_COMPRESS_MAGIC || header->logicalTracks != CompressTracks[unit])
+    {
+        return -1;
+    }
+    memcpy(CompressMap[unit], CompressCheckpointBuffer[unit] + USLOSS_DISK_SECTOR_SIZE,
+           CompressBlocks[unit] * sizeof(compressMapEntry));
+    return 0;
+}
+
+/*
+ *  Marks the checkpoint of a unit stale, so that until checkpointCompress
+ *  writes a new one the next boot won't load a map the writes from now on
+ *  leave behind. Runs in the driver before it takes requests.
+ */
+static void markCompressCheckpointStale(int unit)
+{
+    memset(CompressCheckpointBuffer[unit], 0, USLOSS_DISK_SECTOR_SIZE);
+    compressCheckpointHeader *header = (compressCheckpointHeader *) CompressCheckpointBuffer[unit];
+    header->magic = DISK_COMPRESS_STALE_MAGIC;
+    header->logicalTracks = CompressTracks[unit];
+
+    diskRequest request;
+    clearRequest(&request);
+    request.op = DISK_WRITE;
+    request.memAddress = CompressCheckpointBuffer[unit];
+    request.numSectors = 1;
+    request.startTrack = CompressTracks[unit];
+    request.startSector = 0;
+    request.unit = unit;
+    performDiskOp(&request);
+    if (request.resultStatus != 0)
+    {
+        USLOSS_Console("initCompress(%d): Could not mark the checkpoint stale.\n", unit);
+    }
+}
+
+/*
+ *  Writes the block map of a unit to its checkpoint tracks. Called by start3 at
+ *  shutdown.
+ */
+void checkpointCompress(int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("checkpointCompress(%d): called.\n", unit);
+    }
+
+    initProc();
+    processPtr proc = getCurrentProc();
+
+    getMutex(compressMutex[unit]);
+    memset(CompressCheckpointBuffer[unit], 0, sizeof(CompressCheckpointBuffer[unit]));
+    compressCheckpointHeader *header = (compressCheckpointHeader *) CompressCheckpointBuffer[unit];
+    header->magic = DISK_COMPRESS_MAGIC;
+    header->logicalTracks = CompressTracks[unit];
+    memcpy(CompressCheckpointBuffer[unit] + USLOSS_DISK_SECTOR_SIZE, CompressMap[unit],
+           CompressBlocks[unit] * sizeof(compressMapEntry));
+    returnMutex(compressMutex[unit]);
+
+    initDiskRequest(&proc->diskRequests[0], DISK_WRITE, CompressCheckpointBuffer[unit],
+                    1 + compressMapSectors(unit), CompressTracks[unit], 0, unit);
+    proc->numDiskRequests = 1;
+    if (runDiskRequests(proc) != 0)
+    {
+        USLOSS_Console("checkpointCompress(%d): Could not write the checkpoint.\n", unit);
+    }
+    clearProc(proc);
+}
+
+/*
+ *  Returns the number of sectors the checkpointed map of a unit takes up
+ */
+static int compressMapSectors(int unit)
+{
+    int bytes = CompressBlocks[unit] * (int) sizeof(compressMapEntry);
+    return (bytes + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+}
+
+/*
+ *  Returns the number of logical tracks of a compressed unit
+ */
+int compressTracks(int unit)
+{
+    return CompressTracks[unit];
+}
+
+/*
+ *  Reads sectors of a compressed unit. Every block the range touches is read
+ *  and decompressed, and the sectors asked for are copied out.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were read successfully >0: disk's status register
+ */
+int compressReadReal(int unit, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("compressReadReal(): called.\n");
+    }
+
+    if (checkRaidArgs("compressReadReal", numSectors, startTrack, startSector, CompressTracks[unit],
+                      DISK_REQUEST_SECTORS) == -1)
+    {
+        return -1;
+    }
+    if (numSectors == 0)
+    {
+        return 0;
+    }
+
+    int first = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    int firstBlock = first / DISK_COMPRESS_BLOCK;
+    int lastBlock = (first + numSectors - 1) / DISK_COMPRESS_BLOCK;
+    int slot = getpid() % MAXPROC;
+    processPtr proc = getCurrentProc();
+
+    // The blocks can't change while they are locked, so the map can be read
+    // without the mutex
+    lockCompressBlocks(unit, firstBlock, lastBlock);
+    for (int block = firstBlock; block <= lastBlock; block++)
+    {
+        addBlockRequests(proc, DISK_READ, unit, &CompressMap[unit][block],
+                         CompressPacked[slot][block - firstBlock]);
+    }
+    int status = runDiskRequests(proc);
+
+    for (int block = firstBlock; block <= lastBlock && status == 0; block++)
+    {
+        int i = block - firstBlock;
+        if (unpackBlock(&CompressMap[unit][block], CompressPacked[slot][i], CompressPlain[slot][i]) == -1)
+        {
+            USLOSS_Console("compressReadReal(): Block %d of disk %d is corrupt.\n", block, unit);
+            status = USLOSS_DEV_ERROR;
+            break;
+        }
+
+        // Copy out the part of the block that was asked for
+        int from, to;
+        int covered = blockOverlap(block, first, numSectors, &from, &to);
+        memcpy(memAddress + (from - first) * USLOSS_DISK_SECTOR_SIZE,
+               CompressPlain[slot][i] + from % DISK_COMPRESS_BLOCK * USLOSS_DISK_SECTOR_SIZE,
+               covered * USLOSS_DISK_SECTOR_SIZE);
+    }
+    unlockCompressBlocks(unit, firstBlock, lastBlock);
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Writes sectors of a compressed unit. Blocks the range only partly covers
+ *  are read first so the rest of their contents is kept. Each block is then
+ *  compressed and written to newly allocated sectors.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were written successfully >0: disk's status register
+ */
+int compressWriteReal(int unit, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("compressWriteReal(): called.\n");
+    }
+
+    if (checkRaidArgs("compressWriteReal", numSectors, startTrack, startSector, CompressTracks[unit],
+                      DISK_REQUEST_SECTORS) == -1)
+    {
+        return -1;
+    }
+    if (numSectors == 0)
+    {
+        return 0;
+    }
+
+    int first = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    int firstBlock = first / DISK_COMPRESS_BLOCK;
+    int lastBlock = (first + numSectors - 1) / DISK_COMPRESS_BLOCK;
+    int slot = getpid() % MAXPROC;
+    processPtr proc = getCurrentProc();
+
+    lockCompressBlocks(unit, firstBlock, lastBlock);
+
+    // Read the blocks the range only partly covers
+    int from, to;
+    for (int block = firstBlock; block <= lastBlock; block++)
+    {
+        if (blockOverlap(block, first, numSectors, &from, &to) < DISK_COMPRESS_BLOCK)
+        {
+            addBlockRequests(proc, DISK_READ, unit, &CompressMap[unit][block],
+                             CompressPacked[slot][block - firstBlock]);
+        }
+    }
+    int status = runDiskRequests(proc);
+    clearProcRequest(proc);
+
+    // Put the new sectors into the blocks and compress them
+    int lengths[DISK_COMPRESS_SPAN];
+    for (int block = firstBlock; block <= lastBlock && status == 0; block++)
+    {
+        int i = block - firstBlock;
+        int covered = blockOverlap(block, first, numSectors, &from, &to);
+        if (covered < DISK_COMPRESS_BLOCK &&
+            unpackBlock(&CompressMap[unit][block], CompressPacked[slot][i], CompressPlain[slot][i]) == -1)
+        {
+            USLOSS_Console("compressWriteReal(): Block %d of disk %d is corrupt.\n", block, unit);
+            memset(CompressPlain[slot][i], 0, DISK_COMPRESS_BYTES);
+        }
+
+        memcpy(CompressPlain[slot][i] + from % DISK_COMPRESS_BLOCK * USLOSS_DISK_SECTOR_SIZE,
+               memAddress + (from - first) * USLOSS_DISK_SECTOR_SIZE,
+               covered * USLOSS_DISK_SECTOR_SIZE);
+        lengths[i] = packBlock(CompressPlain[slot][i], CompressPacked[slot][i]);
+    }
+    if (status != 0)
+    {
+        unlockCompressBlocks(unit, firstBlock, lastBlock);
+        clearProc(proc);
+        return status;
+    }
+
+    // Give each block new sectors. Its old ones are freed first, so a block
+    // that still needs as many sectors usually goes back where it was.
+    getMutex(compressMutex[unit]);
+    for (int block = firstBlock; block <= lastBlock; block++)
+    {
+        compressMapEntry *entry = &CompressMap[unit][block];
+        freeCompressBlock(unit, block);
+        entry->length = lengths[block - firstBlock];
+        for (int i = 0; i < compressedSectors(entry->length); i++)
+        {
+            entry->sectors[i] = allocCompressSector(unit, block * DISK_COMPRESS_BLOCK + i);
+        }
+    }
+    returnMutex(compressMutex[unit]);
+
+    for (int block = firstBlock; block <= lastBlock; block++)
+    {
+        addBlockRequests(proc, DISK_WRITE, unit, &CompressMap[unit][block],
+                         CompressPacked[slot][block - firstBlock]);
+    }
+    status = runDiskRequests(proc);
+    unlockCompressBlocks(unit, firstBlock, lastBlock);
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Locks blocks first through last of a unit, waiting for any that another
+ *  process holds. Blocks are always locked in increasing order.
+ */
+static void lockCompressBlocks(int unit, int first, int last)
+{
+    getMutex(compressMutex[unit]);
+    for (int block = first; block <= last; block++)
+    {
+        while (CompressBlockLocked[unit][block])
+        {
+            CompressLockWaiters[unit]++;
+            returnMutex(compressMutex[unit]);
+            sempReal(compressLockSem[unit]);
+            getMutex(compressMutex[unit]);
+        }
+        CompressBlockLocked[unit][block] = TRUE;
+    }
+    returnMutex(compressMutex[unit]);
+}
+
+/*
+ *  Unlocks blocks first through last of a unit and lets every waiting process
+ *  check again
+ */
+static void unlockCompressBlocks(int unit, int first, int last)
+{
+    getMutex(compressMutex[unit]);
+    for (int block = first; block <= last; block++)
+    {
+        CompressBlockLocked[unit][block] = FALSE;
+    }
+    for (; CompressLockWaiters[unit] > 0; CompressLockWaiters[unit]--)
+    {
+        semvReal(compressLockSem[unit]);
+    }
+    returnMutex(compressMutex[unit]);
+}
+
+/*
+ *  Frees the sectors of a block
+ */
+static void freeCompressBlock(int unit, int block)
+{
+    compressMapEntry *entry = &CompressMap[unit][block];
+    for (int i = 0; i < compressedSectors(entry->length); i++)
+    {
+        CompressSectorUsed[unit][entry->sectors[i]] = FALSE;
+    }
+    entry->length = 0;
+}
+
+/*
+ *  Takes the first free sector at or after home, wrapping around the disk.
+ *  There is always one, since the blocks never need more sectors than the
+ *  disk has.
+ */
+static int allocCompressSector(int unit, int home)
+{
+    int physicalSectors = CompressTracks[unit] * USLOSS_DISK_TRACK_SIZE;
+    for (int i = 0; i < physicalSectors; i++)
+    {
+        int p = (home + i) % physicalSectors;
+        if (!CompressSectorUsed[unit][p])
+        {
+            CompressSectorUsed[unit][p] = TRUE;
+            return p;
+        }
+    }
+    USLOSS_Console("allocCompressSector(%d): Out of sectors.\n", unit);
+    USLOSS_Halt(1);
+    return EMPTY;
+}
+
+/*
+ *  Finds the part of a block that numSectors sectors starting at first cover.
+ *  Sets *from and *to to the first sector covered and the one after the last,
+ *  and returns the number of sectors covered.
+ */
+static int blockOverlap(int block, int first, int numSectors, int *from, int *to)
+{
+    int blockStart = block * DISK_COMPRESS_BLOCK;
+    int blockEnd = blockStart + DISK_COMPRESS_BLOCK;
+    *from = first > blockStart ? first : blockStart;
+    *to = first + numSectors < blockEnd ? first + numSectors : blockEnd;
+    return *to - *from;
+}
+
+/*
+ *  Returns the number of sectors needed to store length bytes
+ */
+static int compressedSectors(int length)
+{
+    return (length + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+}
+
+/*
+ *  Adds requests to read or write the sectors of a block to or from buffer,
+ *  with one request for each run of adjacent sectors
+ */
+static void addBlockRequests(processPtr proc, int op, int unit, compressMapEntry *entry,
+                             unsigned char *buffer)
+{
+    for (int i = 0; i < compressedSectors(entry->length); i++)
+    {
+        addSectorRequest(proc, op, unit, buffer + i * USLOSS_DISK_SECTOR_SIZE, entry->sectors[i],
+                         i > 0 && entry->sectors[i] == entry->sectors[i - 1] + 1);
+    }
+}
+
+/*
+ *  Compresses a block from plain into packed and returns the number of bytes
+ *  to store. A block of zeros needs none. A block that would not save at least
+ *  one sector is stored as it is.
+ */
+static int packBlock(unsigned char *plain, unsigned char *packed)
+{
+    if (bufferIsZero(plain, DISK_COMPRESS_BYTES))
+    {
+        return 0;
+    }
+    int length = lzCompress(plain, DISK_COMPRESS_BYTES, packed,
+                            DISK_COMPRESS_BYTES - USLOSS_DISK_SECTOR_SIZE);
+    if (length == -1)
+    {
+        memcpy(packed, plain, DISK_COMPRESS_BYTES);
+        return DISK_COMPRESS_BYTES;
+    }
+    return length;
+}
+
+/*
+ *  Turns the stored form of a block in packed back into the block in plain.
+ *  Returns -1 if the stored data is corrupt and 0 otherwise.
+ */
+static int unpackBlock(compressMapEntry *entry, unsigned char *packed, unsigned char *plain)
+{
+    if (entry->length == 0)
+    {
+        memset(plain, 0, DISK_COMPRESS_BYTES);
+        return 0;
+    }
+    if (entry->length == DISK_COMPRESS_BYTES)
+    {
+        memcpy(plain, packed, DISK_COMPRESS_BYTES);
+        return 0;
+    }
+    if (lzDecompress(packed, entry->length, plain, DISK_COMPRESS_BYTES) != DISK_COMPRESS_BYTES)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ *  Appends a length in the codec's format: a nibble that was 15 is followed by
+ *  bytes of 255 and then the remainder. Returns -1 if dst is full.
+ */
+static int lzPutLength(unsigned char *dst, int dstCap, int *op, int length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (*op >= dstCap)
+        {
+            return -1;
+        }
+        dst[(*op)++] = 255;
+    }
+    if (*op >= dstCap)
+    {
+        return -1;
+    }
+    dst[(*op)++] = length;
+    return 0;
+}
+
+/*
+ *  Appends one sequence: a token, the literals, and then the match, if there
+ *  is one. The token's high nibble is the number of literals and its low
+ *  nibble is the match length less LZ_MIN_MATCH. Returns -1 if dst is full.
+ */
+static int lzPutSequence(unsigned char *dst, int dstCap, int *op, unsigned char *literals,
+                         int numLiterals, int offset, int matchLength)
+{
+    int literalCode = numLiterals < 15 ? numLiterals : 15;
+    int matchCode = 0;
+    if (matchLength > 0)
+    {
+        matchCode = matchLength - LZ_MIN_MATCH < 15 ? matchLength - LZ_MIN_MATCH : 15;
+    }
+
+    if (*op >= dstCap)
+    {
+        return -1;
+    }
+    dst[(*op)++] = (literalCode << 4) | matchCode;
+    if (literalCode == 15 && lzPutLength(dst, dstCap, op, numLiterals - 15) == -1)
+    {
+        return -1;
+    }
+    if (*op + numLiterals > dstCap)
+    {
+        return -1;
+    }
+    memcpy(dst + *op, literals, numLiterals);
+    *op += numLiterals;
+
+    if (matchLength > 0)
+    {
+        if (*op + 2 > dstCap)
+        {
+            return -1;
+        }
+        dst[(*op)++] = offset & 0xff;
+        dst[(*op)++] = offset >> 8;
+        if (matchCode == 15 &&
+            lzPutLength(dst, dstCap, op, matchLength - LZ_MIN_MATCH - 15) == -1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  Compresses srcLength bytes of src into dst. Returns the compressed length,
+ *  or -1 if it does not fit in dstCap bytes.
+ */
+int lzCompress(unsigned char *src, int srcLength, unsigned char *dst, int dstCap)
+{
+    int table[LZ_HASH_SIZE];
+    for (int i = 0; i < LZ_HASH_SIZE; i++)
+    {
+        table[i] = -1;
+    }
+
+    int ip = 0;
+    int anchor = 0;
+    int op = 0;
+    while (ip + LZ_MIN_MATCH <= srcLength)
+    {
+        unsigned int sequence;
+        memcpy(&sequence, src + ip, sizeof(sequence));
+        int hash = (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+        int ref = table[hash];
+        table[hash] = ip;
+        if (ref < 0 || ip - ref > LZ_MAX_OFFSET || memcmp(src + ref, src + ip, LZ_MIN_MATCH) != 0)
+        {
+            ip++;
+            continue;
+        }
+
+        int length = LZ_MIN_MATCH;
+        while (ip + length < srcLength && src[ref + length] == src[ip + length])
+        {
+            length++;
+        }
+        if (lzPutSequence(dst, dstCap, &op, src + anchor, ip - anchor, ip - ref, length) == -1)
+        {
+            return -1;
+        }
+        ip += length;
+        anchor = ip;
+    }
+
+    // The last sequence holds the remaining literals and no match
+    if (lzPutSequence(dst, dstCap, &op, src + anchor, srcLength - anchor, 0, 0) == -1)
+    {
+        return -1;
+    }
+    return op;
+}
+
+/*
+ *  Reads a length in the codec's format that follows a nibble of 15. Returns
+ *  -1 if src runs out.
+ */
+static int lzGetLength(unsigned char *src, int srcLength, int *ip)
+{
+    int length = 0;
+    int byte;
+    do
+    {
+        if (*ip >= srcLength)
+        {
+            return -1;
+        }
+        byte = src[(*ip)++];
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+/*
+ *  Decompresses srcLength bytes of src into dst, which holds dstCap bytes.
+ *  Returns the decompressed length, or -1 if src is not valid.
+ */
+int lzDecompress(unsigned char *src, int srcLength, unsigned char *dst, int dstCap)
+{
+    int ip = 0;
+    int op = 0;
+    while (ip < srcLength)
+    {
+        int token = src[ip++];
+
+        int numLiterals = token >> 4;
+        if (numLiterals == 15)
+        {
+            int extra = lzGetLength(src, srcLength, &ip);
+            if (extra == -1)
+            {
+                return -1;
+            }
+            numLiterals += extra;
+        }
+        if (ip + numLiterals > srcLength || op + numLiterals > dstCap)
+        {
+            return -1;
+        }
+        memcpy(dst + op, src + ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+
+        // The last sequence has no match
+        if (ip == srcLength)
+        {
+            break;
+        }
+
+        if (ip + 2 > srcLength)
+        {
+            return -1;
+        }
+        int offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        int length = (token & 0xf) + LZ_MIN_MATCH;
+        if ((token & 0xf) == 15)
+        {
+            int extra = lzGetLength(src, srcLength, &ip);
+            if (extra == -1)
+            {
+                return -1;
+            }
+            length += extra;
+        }
+        if (offset == 0 || offset > op || op + length > dstCap)
+        {
+            return -1;
+        }
+
+        // Copy a byte at a time, since the match may overlap what it makes
+        for (int i = 0; i < length; i++, op++)
+        {
+            dst[op] = dst[op - offset];
+        }
+    }
+    return op;
+}
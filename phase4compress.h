@@ -0,0 +1,49 @@
+#ifndef _PHASE4COMPRESS_H
+#define _PHASE4COMPRESS_H
+
+#include "devices.h"
+
+// Number of sectors in a compressed block
+#define DISK_COMPRESS_BLOCK     4
+#define DISK_COMPRESS_BYTES     (DISK_COMPRESS_BLOCK * USLOSS_DISK_SECTOR_SIZE)
+
+// Largest unit, in tracks, that can be compressed
+#define DISK_COMPRESS_MAX_TRACKS 256
+#define DISK_COMPRESS_MAX_SECTORS (DISK_COMPRESS_MAX_TRACKS * USLOSS_DISK_TRACK_SIZE)
+#define DISK_COMPRESS_MAX_BLOCKS (DISK_COMPRESS_MAX_SECTORS / DISK_COMPRESS_BLOCK)
+
+// Most blocks one DiskRead or DiskWrite can touch
+#define DISK_COMPRESS_SPAN      ((USLOSS_DISK_TRACK_SIZE - 2) / DISK_COMPRESS_BLOCK + 2)
+
+// The last tracks of a compressed unit hold the checkpointed block map
+#define DISK_COMPRESS_CHECKPOINT_TRACKS 2
+#define DISK_COMPRESS_MAGIC     0x4c5a4d21
+
+// Magic number the checkpoint is given once the driver starts. Only a clean
+// shutdown writes DISK_COMPRESS_MAGIC back.
+#define DISK_COMPRESS_STALE_MAGIC 0x4c5a4d3f
+
+// Where a compressed block is stored. length is the number of bytes stored:
+// 0 for a block of zeros, which takes no sectors, and DISK_COMPRESS_BYTES for
+// a block that did not compress.
+typedef struct compressMapEntry
+{
+    short length;
+    short sectors[DISK_COMPRESS_BLOCK];
+} compressMapEntry;
+
+#define DISK_COMPRESS_MAP_SECTORS \
+    ((DISK_COMPRESS_MAX_BLOCKS * (int) sizeof(compressMapEntry) + USLOSS_DISK_SECTOR_SIZE - 1) / \
+     USLOSS_DISK_SECTOR_SIZE)
+
+extern int diskCompressed[USLOSS_DISK_UNITS];
+
+extern void initCompress(int);
+extern int compressTracks(int);
+extern int compressReadReal(int, void *, int, int, int);
+extern int compressWriteReal(int, void *, int, int, int);
+extern void checkpointCompress(int);
+extern int lzCompress(unsigned char *, int, unsigned char *, int);
+extern int lzDecompress(unsigned char *, int, unsigned char *, int);
+
+#endif
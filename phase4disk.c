@@ -7,6 +7,8 @@
 #include <usloss.h>
 #include <usyscall.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "devices.h"
 #include "phase1.h"
@@ -14,23 +16,58 @@
 #include "providedPrototypes.h"
 #include "phase4utility.h"
 #include "phase4disk.h"
+#include "phase4raid.h"
+#include "phase4log.h"
+#include "phase4sparse.h"
+#include "phase4compress.h"
+#include "phase4relocate.h"
+#include "phase4cache.h"
+#include "disktrace.h"
 
 extern int debugflag4;
 extern process ProcTable[];
 extern int diskPIDs[USLOSS_DISK_UNITS];
 extern int diskMutex[USLOSS_DISK_UNITS];
 
-void printQueue(int);
-
 extern semaphore diskSem[USLOSS_DISK_UNITS];
 
-// Pointers to the queue of disk operations
-processPtr DiskDriverQueue[USLOSS_DISK_UNITS];
-processPtr NextDiskRequest[USLOSS_DISK_UNITS];
-
 // Disk sizes (number of tracks)
 int DiskSizes[USLOSS_DISK_UNITS];
 
+// Disk statistics. The track each head was last sent to is used to measure seeks.
+// When diskStatsAtShutdown is set start3 prints the statistics before it quits.
+DiskStatistics DiskUnitStats[USLOSS_DISK_UNITS];
+int DiskHeadTrack[USLOSS_DISK_UNITS];
+int diskStatsAtShutdown = FALSE;
+
+// Disk tracing. When diskTraceFile names a host file, a diskTraceRecord is
+// appended to it for every request the drivers complete.
+char *diskTraceFile = NULL;
+FILE *DiskTrace = NULL;
+int diskTraceMutex;
+
+// Admission control. When diskQueueLimit is non-zero for a unit, no more than
+// that many requests are admitted to its queue at once, and when
+// diskProcessQueueLimit is non-zero, no more than that many from one process.
+// Requests are admitted until the driver takes them. Processes that find no
+// room wait in first come, first served order.
+int diskQueueLimit[USLOSS_DISK_UNITS];
+int diskProcessQueueLimit = 0;
+static int DiskQueueAdmitted[USLOSS_DISK_UNITS];
+static int DiskAdmissionWaiting[USLOSS_DISK_UNITS];
+static processPtr DiskAdmissionHead[USLOSS_DISK_UNITS];
+static processPtr DiskAdmissionTail[USLOSS_DISK_UNITS];
+
+// Kernel buffers used by DiskCopy, DiskFill, DiskPread and DiskPwrite, two for
+// each process so that a copy can read into one while it writes out of the other
+static char DiskCopyBuffers[MAXPROC][2][DISK_COPY_CHUNK * USLOSS_DISK_SECTOR_SIZE];
+
+// One DiskPwrite at a time reads, patches and writes back sectors of a
+// physical unit, so that two writes to different bytes of a sector don't undo
+// each other. A write to a RAID unit holds the mutexes of every physical
+// unit, since its sectors are on them.
+static int DiskPwriteMutex[USLOSS_DISK_UNITS];
+
 /*
  *  System call for user function DiskRead. Serves as a bridge between DiskRead
  *  and diskReadReal
@@ -95,55 +132,61 @@ int diskReadReal(void* memoryAddress, int numSectors, int startDiskTrack,
         USLOSS_Console("diskReadReal(): called.\n");
     }
 
-    // check for illegal input values
-    if(numSectors < 0 || numSectors >= USLOSS_DISK_TRACK_SIZE)
+    // The RAID layer handles the virtual units
+    if (unitNum == DISK_RAID0_UNIT)
     {
-        if(DEBUG4 && debugflag4)
-        {
-            USLOSS_Console("diskReadReal(): invalid args.\n");
-        }
-        return -1;
+        return raid0Request(DISK_READ, memoryAddress, numSectors, startDiskTrack, startDiskSector);
     }
-    else if(startDiskTrack < 0 || startDiskTrack >= DiskSizes[unitNum])
+    else if (unitNum == DISK_RAID1_UNIT)
     {
-        if(DEBUG4 && debugflag4)
-        {
-            USLOSS_Console("diskReadReal(): invalid args.\n");
-        }
-        return -1;
+        return raid1Request(DISK_READ, memoryAddress, numSectors, startDiskTrack, startDiskSector);
     }
-    else if(startDiskSector < 0 || startDiskSector >= USLOSS_DISK_TRACK_SIZE)
+
+    // Units in log-structured mode go through the sector map, compressed
+    // units through the block map, and relocating units through the track map
+    if (unitNum >= 0 && unitNum < USLOSS_DISK_UNITS && diskLogStructured[unitNum])
     {
-        if(DEBUG4 && debugflag4)
-        {
-            USLOSS_Console("diskReadReal(): invalid args.\n");
-        }
-        return -1;
+        return logReadReal(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector);
     }
-    else if(unitNum < 0 || unitNum >= USLOSS_DISK_UNITS)
+    if (unitNum >= 0 && unitNum < USLOSS_DISK_UNITS && diskCompressed[unitNum])
     {
-        if(DEBUG4 && debugflag4)
-        {
-            USLOSS_Console("diskReadReal(): invalid args.\n");
-        }
-        return -1;
+        return compressReadReal(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector);
     }
-    int endingDiskTrack = startDiskSector + numSectors/USLOSS_DISK_TRACK_SIZE;
-    if(endingDiskTrack >= DiskSizes[unitNum])
+    if (unitNum >= 0 && unitNum < USLOSS_DISK_UNITS && diskRelocate[unitNum])
+    {
+        return relocateReadReal(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector);
+    }
+
+    // check for illegal input values
+    if (checkDiskArgs("diskReadReal", numSectors, startDiskTrack, startDiskSector, unitNum) == -1)
     {
-        if(DEBUG4 && debugflag4)
-        {
-            USLOSS_Console("diskReadReal(): would have read past the end of the disk.\n");
-        }
         return -1;
     }
 
+    // Sectors in the buffer cache don't need the disk
+    if (cacheRead(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector))
+    {
+        cacheReadAhead(unitNum, startDiskTrack, startDiskSector, numSectors);
+        return 0;
+    }
+
+    // Sectors known to hold only zeros don't need the disk
+    if (diskSparseSectors &&
+        knownZeroRange(unitNum, startDiskTrack, startDiskSector, numSectors))
+    {
+        memset(memoryAddress, 0, numSectors * USLOSS_DISK_SECTOR_SIZE);
+        return 0;
+    }
+
     // Put this into the disk driver queue and block
     diskQueueAdd(DISK_READ, memoryAddress, numSectors, startDiskTrack, startDiskSector, unitNum);
-    blockOnMbox(); 
+    waitForDiskRequests(1);
     processPtr proc = &ProcTable[getpid() % MAXPROC];
-    int status = proc->diskRequest.resultStatus;
+    int status = proc->diskRequests[0].resultStatus;
     clearProc(proc);
+
+    // Read ahead of sequential reads
+    cacheReadAhead(unitNum, startDiskTrack, startDiskSector, numSectors);
     return status;
 }
 
@@ -209,278 +252,1399 @@ int diskWriteReal(void* memoryAddress, int numSectors, int startDiskTrack,
         USLOSS_Console("diskWriteReal(): called.\n");
     }
 
+    // The RAID layer handles the virtual units
+    if (unitNum == DISK_RAID0_UNIT)
+    {
+        return raid0Request(DISK_WRITE, memoryAddress, numSectors, startDiskTrack, startDiskSector);
+    }
+    else if (unitNum == DISK_RAID1_UNIT)
+    {
+        return raid1Request(DISK_WRITE, memoryAddress, numSectors, startDiskTrack, startDiskSector);
+    }
+
+    // Units in log-structured mode go through the sector map, compressed
+    // units through the block map, and relocating units through the track map
+    if (unitNum >= 0 && unitNum < USLOSS_DISK_UNITS && diskLogStructured[unitNum])
+    {
+        return logWriteReal(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector);
+    }
+    if (unitNum >= 0 && unitNum < USLOSS_DISK_UNITS && diskCompressed[unitNum])
+    {
+        return compressWriteReal(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector);
+    }
+    if (unitNum >= 0 && unitNum < USLOSS_DISK_UNITS && diskRelocate[unitNum])
+    {
+        return relocateWriteReal(unitNum, memoryAddress, numSectors, startDiskTrack, startDiskSector);
+    }
+
     // check for illegal input values
-    if(numSectors < 0 || numSectors >= USLOSS_DISK_TRACK_SIZE)
+    if (checkDiskArgs("diskWriteReal", numSectors, startDiskTrack, startDiskSector, unitNum) == -1)
+    {
+        return -1;
+    }
+
+    // Writing zeros over sectors that already hold only zeros changes nothing
+    if (diskSparseSectors &&
+        bufferIsZero(memoryAddress, numSectors * USLOSS_DISK_SECTOR_SIZE) &&
+        knownZeroRange(unitNum, startDiskTrack, startDiskSector, numSectors))
+    {
+        return 0;
+    }
+
+    // Put this into the disk driver queue and block
+    diskQueueAdd(DISK_WRITE, memoryAddress, numSectors, startDiskTrack, startDiskSector, unitNum);
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskWriteReal(): finished adding request to the queue.\n");
+    }
+    waitForDiskRequests(1);
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskWriteReal(): write request finished.\n");
+    }
+    processPtr proc = &ProcTable[getpid() % MAXPROC];
+    int status = proc->diskRequests[0].resultStatus;
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Checks the parameters of a disk read or write. Returns -1 if they are
+ *  invalid and 0 otherwise. caller is used in debugging output.
+ */
+int checkDiskArgs(char *caller, int numSectors, int startDiskTrack,
+                  int startDiskSector, int unitNum)
+{
+    if(unitNum < 0 || unitNum >= USLOSS_DISK_UNITS || mappedDiskUnit(unitNum))
     {
         if(DEBUG4 && debugflag4)
         {
-            USLOSS_Console("diskWriteReal(): invalid args.\n");
+            USLOSS_Console("%s(): invalid args.\n", caller);
         }
         return -1;
     }
-    else if(startDiskTrack < 0 || startDiskTrack >= DiskSizes[unitNum])
+    else if(numSectors < 0 || numSectors >= USLOSS_DISK_TRACK_SIZE)
     {
         if(DEBUG4 && debugflag4)
         {
-            USLOSS_Console("diskWriteReal(): invalid args.\n");
+            USLOSS_Console("%s(): invalid args.\n", caller);
         }
         return -1;
     }
-    else if(startDiskSector < 0 || startDiskSector >= USLOSS_DISK_TRACK_SIZE)
+    else if(startDiskTrack < 0 || startDiskTrack >= DiskSizes[unitNum])
     {
         if(DEBUG4 && debugflag4)
         {
-            USLOSS_Console("diskWriteReal(): invalid args.\n");
+            USLOSS_Console("%s(): invalid args.\n", caller);
         }
         return -1;
     }
-    else if(unitNum < 0 || unitNum >= USLOSS_DISK_UNITS)
+    else if(startDiskSector < 0 || startDiskSector >= USLOSS_DISK_TRACK_SIZE)
     {
         if(DEBUG4 && debugflag4)
         {
-            USLOSS_Console("diskWriteReal(): invalid args.\n");
+            USLOSS_Console("%s(): invalid args.\n", caller);
         }
         return -1;
     }
-    int endingDiskTrack = startDiskSector + numSectors/USLOSS_DISK_TRACK_SIZE;
+    int endingDiskTrack = startDiskTrack +
+        (startDiskSector + numSectors - 1) / USLOSS_DISK_TRACK_SIZE;
     if(endingDiskTrack >= DiskSizes[unitNum])
     {
         if(DEBUG4 && debugflag4)
         {
-            USLOSS_Console("diskWriteReal(): would have written past the end of the disk.\n");
+            USLOSS_Console("%s(): would have gone past the end of the disk.\n", caller);
         }
         return -1;
     }
+    return 0;
+}
 
-    // Put this into the disk driver queue and block
-    diskQueueAdd(DISK_WRITE, memoryAddress, numSectors, startDiskTrack, startDiskSector, unitNum);
+/*
+ *  System call for user function DiskSubmitBatch. Serves as a bridge between
+ *  DiskSubmitBatch and diskSubmitBatchReal
+ */
+void diskSubmitBatch(systemArgs *args)
+{
     if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskWriteReal(): finished adding request to the queue.\n");
+        USLOSS_Console("diskSubmitBatch(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKBATCH)
+    {
+        USLOSS_Console("diskSubmitBatch(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
     }
-    blockOnMbox();
+
+    // Unpack the args
+    DiskBatchRequest *requests = (DiskBatchRequest *) args->arg1;
+    int numRequests = (int) ((long) args->arg2);
+
+    int result = diskSubmitBatchReal(requests, numRequests);
+
+    args->arg4 = (void *) ((long) result);
+
+    setToUserMode();
+}
+
+/*
+ *  Submits numRequests independent reads and writes at once. All of the valid
+ *  requests for a unit are put into that unit's queue under a single acquisition
+ *  of its mutex, so the disk driver sees the whole batch before it starts. A
+ *  DISK_BATCH_BARRIER entry keeps the entries after it for its unit from being
+ *  served before those ahead of it. Blocks until every request has finished.
+ *  The status field of each entry is set to -1 if its parameters were invalid
+ *  (it is not performed), 0 if it succeeded, or the disk's status register
+ *  otherwise.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: the batch was performed
+ */
+int diskSubmitBatchReal(DiskBatchRequest *requests, int numRequests)
+{
     if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskWriteReal(): write request finished.\n");
+        USLOSS_Console("diskSubmitBatchReal(): called.\n");
+    }
+
+    // Check args
+    if (requests == NULL || numRequests < 1 || numRequests > MAXDISKBATCH)
+    {
+        return -1;
+    }
+
+    processPtr proc = getCurrentProc();
+    int valid[MAXDISKBATCH];
+    for (int i = 0; i < numRequests; i++)
+    {
+        DiskBatchRequest *entry = &requests[i];
+        if (entry->op == DISK_BATCH_BARRIER)
+        {
+            valid[i] = entry->unit >= 0 && entry->unit < USLOSS_DISK_UNITS;
+            if (valid[i])
+            {
+                initDiskRequest(&proc->diskRequests[i], entry->op, NULL, 0, 0, 0, entry->unit);
+            }
+            continue;
+        }
+        valid[i] = (entry->op == DISK_READ || entry->op == DISK_WRITE) &&
+                   (entry->ioClass == DISK_IOCLASS_DEFAULT || validIOClass(entry->ioClass)) &&
+                   checkDiskArgs("diskSubmitBatchReal", entry->sectors, entry->track,
+                                 entry->first, entry->unit) == 0;
+        if (valid[i])
+        {
+            initDiskRequest(&proc->diskRequests[i], entry->op, entry->buffer,
+                            entry->sectors, entry->track, entry->first, entry->unit);
+            if (entry->ioClass != DISK_IOCLASS_DEFAULT)
+            {
+                proc->diskRequests[i].ioClass = entry->ioClass;
+            }
+        }
+    }
+    proc->numDiskRequests = numRequests;
+
+    // Put each unit's share of the batch into its queue all at once
+    int numQueued = queueDiskRequests(proc);
+
+    // Wait for the drivers to finish everything
+    waitForDiskRequests(numQueued);
+
+    for (int i = 0; i < numRequests; i++)
+    {
+        requests[i].status = valid[i] ? proc->diskRequests[i].resultStatus : -1;
     }
-    processPtr proc = &ProcTable[getpid() % MAXPROC];
-    int status = proc->diskRequest.resultStatus;
     clearProc(proc);
-    return status;
+    return 0;
 }
 
 /*
- *  System call for user function DiskSize. Serves as a bridge between DiskSize
- *  and diskSizeReal
+ *  System call for user function DiskBarrier. Serves as a bridge between
+ *  DiskBarrier and diskBarrierReal
  */
-void diskSize(systemArgs *args)
+void diskBarrier(systemArgs *args)
 {
     if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskSize(): called.\n");
+        USLOSS_Console("diskBarrier(): called.\n");
     }
 
     initProc();
 
     // Check the syscall number
-    if (args->number != SYS_DISKSIZE)
+    if (args->number != SYS_DISKBARRIER)
     {
-        USLOSS_Console("diskRead(): Called with wrong syscall number.\n");;
+        USLOSS_Console("diskBarrier(): Called with wrong syscall number.\n");
         USLOSS_Halt(1);
     }
 
     int unit = (int) ((long) args->arg1);
 
-    int sector = -1;
-    int track = -1;
-    int disk = -1;
-
-    int result = diskSizeReal(unit, &sector, &track, &disk);
-
-    args->arg1 = (void*) ((long) sector);
-    args->arg2 = (void*) ((long) track);
-    args->arg3 = (void*) ((long) disk);
-    args->arg4 = (void*) ((long) result);
+    int result = diskBarrierReal(unit);
 
-    //clearProc(getCurrentProc());
+    args->arg4 = (void *) ((long) result);
 
     setToUserMode();
 }
 
 /*
- *  Returns information about the size of the disk indicated by unit. The sector
- *  parameter is filled in with the number of bytes in a sector, track with the
- *  number of sectors in a track, and disk with the number of tracks in the disk.
+ *  Puts a barrier in the queue of a physical unit: every request queued for
+ *  the unit before it is served before any request queued after it. Requests
+ *  on either side are still reordered freely among themselves. Doesn't wait
+ *  for anything to be served.
  *  Return values:
  *    -1: invalid parameters
- *     0: disk size parameters returned successfully
+ *     0: the barrier was queued
  */
-int diskSizeReal(int unit, int *sector, int *track, int *disk)
+int diskBarrierReal(int unit)
 {
     if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskSizeReal(): called.\n");
+        USLOSS_Console("diskBarrierReal(): called.\n");
     }
 
-    // Check params
-    if(unit < 0 || unit >= USLOSS_DISK_UNITS)
+    if (unit < 0 || unit >= USLOSS_DISK_UNITS)
     {
         return -1;
     }
 
-    // Set the track and sector sizes
-    *track = USLOSS_DISK_TRACK_SIZE;
-    *sector = USLOSS_DISK_SECTOR_SIZE;
-    *disk = DiskSizes[unit];
+    getMutex(diskMutex[unit]);
+    queueDiskBarrier(unit);
+    returnMutex(diskMutex[unit]);
     return 0;
 }
 
 /*
- * Initialize the current process with a request and add it to the disk queue
+ *  System call for user function DiskSetIOClass. Serves as a bridge between
+ *  DiskSetIOClass and diskSetIOClassReal
  */
-void diskQueueAdd(int op, void *memAddress, int numSectors, int startTrack, int startSector, int unit)
+void diskSetIOClass(systemArgs *args)
 {
-    getMutex(diskMutex[unit]);
     if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskQueueAdd(): called.\n");
-        printQueue(unit);
+        USLOSS_Console("diskSetIOClass(): called.\n");
     }
 
-    processPtr proc = &ProcTable[getpid() % MAXPROC];
-    diskRequest *request = &proc->diskRequest;
-
-    request->op = op;
-    request->memAddress = memAddress;
-    request->numSectors = numSectors;
-    request->startTrack = startTrack;
-    request->startSector = startSector;
-    request->unit = unit;
-
+    initProc();
 
-    if (DiskDriverQueue[unit] == NULL)
-    {
-        DiskDriverQueue[unit] = proc;
-    }
-    else if (compareRequests(&(DiskDriverQueue[unit]->diskRequest), &(proc->diskRequest)) > 0)
-    {
-        proc->nextDiskQueueProc = DiskDriverQueue[unit];
-        DiskDriverQueue[unit] = proc;
-    }
-    else
+    // Check the syscall number
+    if (args->number != SYS_DISKIOCLASS)
     {
-        processPtr current = DiskDriverQueue[unit];
-        processPtr next = current->nextDiskQueueProc;
-        while (next != NULL && compareRequests(&(proc->diskRequest), &(current->diskRequest)) > 0)
-        {
-            current = next;
-            next = next->nextDiskQueueProc;
-        }
-        current->nextDiskQueueProc = proc;
-        proc->nextDiskQueueProc = next;
+        USLOSS_Console("diskSetIOClass(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
     }
 
-    if(DEBUG4 && debugflag4)
-    {
-        printQueue(unit);
-    }
-    returnMutex(diskMutex[unit]);
+    int ioClass = (int) ((long) args->arg1);
+
+    int result = diskSetIOClassReal(ioClass);
 
-    semvReal(diskSem[unit]);
+    args->arg4 = (void *) ((long) result);
+
+    setToUserMode();
 }
 
 /*
- * Returns a pointer to the next disk request to process. Cleans the next
- * pointer on the returned process. Removes the returned process from the queue
+ *  Sets the I/O priority class used for the current process's disk requests
+ *  that don't name a class of their own.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: the class was set
  */
-processPtr dequeueDiskRequest(int unit)
+int diskSetIOClassReal(int ioClass)
 {
-    getMutex(diskMutex[unit]);
     if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskQueueRequest(): called.\n");
-        printQueue(unit);
+        USLOSS_Console("diskSetIOClassReal(): called.\n");
     }
 
-    // Return null when the queue is empty
-    if (DiskDriverQueue[unit] == NULL)
+    if (!validIOClass(ioClass))
     {
-        returnMutex(diskMutex[unit]);
-        if(DEBUG4 && debugflag4)
-        {
-            USLOSS_Console("diskQueueRequest(): returning NULL.\n");
-        }
-        return NULL;
+        return -1;
     }
 
-    // Initialize next request on first call
-    if (NextDiskRequest[unit] == NULL)
+    processPtr proc = getCurrentProc();
+    proc->diskIOClass = ioClass;
+    proc->diskIOClassPid = getpid();
+    return 0;
+}
+
+/*
+ *  Returns TRUE if ioClass names one of the I/O priority classes
+ */
+int validIOClass(int ioClass)
+{
+    return ioClass >= 0 && ioClass < DISK_IOCLASSES;
+}
+
+/*
+ *  Returns the I/O priority class of the current process
+ */
+int currentIOClass()
+{
+    processPtr proc = getCurrentProc();
+    if (proc->diskIOClassPid != getpid())
     {
-        NextDiskRequest[unit] = DiskDriverQueue[unit];
+        return DISK_IOCLASS_BE;
     }
+    return proc->diskIOClass;
+}
 
-    // Get the request to dequeue and update
-    processPtr ret = NextDiskRequest[unit];
-    if(DEBUG4 && debugflag4 && ret == NULL)
+/*
+ *  System call for user function DiskStats. Serves as a bridge between
+ *  DiskStats and diskStatsReal
+ */
+void diskStats(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
     {
-        USLOSS_Console("diskQueueRequest(): ret is set to NULL.\n");
+        USLOSS_Console("diskStats(): called.\n");
     }
-    NextDiskRequest[unit] = NextDiskRequest[unit]->nextDiskQueueProc;
 
-    // Search for the parent of the request to dequeue and remove
-    if (ret != DiskDriverQueue[unit])
-    {
-        processPtr parent = DiskDriverQueue[unit];
-        while (parent->nextDiskQueueProc != ret)
-        {
-            parent = parent->nextDiskQueueProc;
-        }
+    initProc();
 
-        // Remove ret
-        parent->nextDiskQueueProc = ret->nextDiskQueueProc;
-    }
-    else
+    // Check the syscall number
+    if (args->number != SYS_DISKSTATS)
     {
-        DiskDriverQueue[unit] = ret->nextDiskQueueProc;
+        USLOSS_Console("diskStats(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
     }
 
-    if (NextDiskRequest[unit] == NULL)
-    {
-        NextDiskRequest[unit] = DiskDriverQueue[unit];
-    }
+    int unit = (int) ((long) args->arg1);
+    DiskStatistics *stats = (DiskStatistics *) args->arg2;
+
+    int result = diskStatsReal(unit, stats);
 
-    ret->nextDiskQueueProc = NULL;
+    args->arg4 = (void *) ((long) result);
+
+    setToUserMode();
+}
 
+/*
+ *  Copies the statistics gathered for the disk indicated by unit into stats.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: statistics returned successfully
+ */
+int diskStatsReal(int unit, DiskStatistics *stats)
+{
     if(DEBUG4 && debugflag4)
     {
-        printQueue(unit);
+        USLOSS_Console("diskStatsReal(): called.\n");
+    }
+
+    // Check params
+    if (unit < 0 || unit >= USLOSS_DISK_UNITS || stats == NULL)
+    {
+        return -1;
     }
-    returnMutex(diskMutex[unit]);
 
-    return ret;
+    getMutex(diskMutex[unit]);
+    *stats = DiskUnitStats[unit];
+    returnMutex(diskMutex[unit]);
+    return 0;
 }
 
 /*
- *  Perform a disk operation as defined in the request struct in processPtr proc
+ *  System call for user function DiskQueueDepth. Serves as a bridge between
+ *  DiskQueueDepth and diskQueueDepthReal
  */
-int performDiskOp(processPtr proc)
+void diskQueueDepth(systemArgs *args)
 {
-    diskRequest request = proc->diskRequest;
-
-    // Seek to the given track
-    int result = seekTrack(request.unit, request.startTrack);
-    if (result != 0)
+    if(DEBUG4 && debugflag4)
     {
-        return result;
+        USLOSS_Console("diskQueueDepth(): called.\n");
     }
 
-    // Read/Write from the given track
-    int currentTrack = request.startTrack;
-    for (int i = 0; i < request.numSectors; i++)
-    {
-        // Assume sectors start from 0
+    initProc();
 
-        int sector = request.startSector + i;
+    // Check the syscall number
+    if (args->number != SYS_DISKQUEUEDEPTH)
+    {
+        USLOSS_Console("diskQueueDepth(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int unit = (int) ((long) args->arg1);
+    int depth, limit, waiting;
+
+    int result = diskQueueDepthReal(unit, &depth, &limit, &waiting);
+
+    if(result == -1)
+    {
+        args->arg4 = (void *) -1;
+        args->arg1 = (void *) 0;
+        args->arg2 = (void *) 0;
+        args->arg3 = (void *) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = (void *) ((long) depth);
+        args->arg2 = (void *) ((long) limit);
+        args->arg3 = (void *) ((long) waiting);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Reports how full the queue of the disk indicated by unit is: the number of
+ *  requests admitted to it, its limit, which is 0 if there is none, and the
+ *  number of processes waiting for room in it.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: the depth was returned
+ */
+int diskQueueDepthReal(int unit, int *depth, int *limit, int *waiting)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskQueueDepthReal(): called.\n");
+    }
+
+    if (unit < 0 || unit >= USLOSS_DISK_UNITS)
+    {
+        return -1;
+    }
+
+    getMutex(diskMutex[unit]);
+    *depth = DiskQueueAdmitted[unit];
+    *limit = diskQueueLimit[unit] > 0 ? diskQueueLimit[unit] : 0;
+    *waiting = DiskAdmissionWaiting[unit];
+    returnMutex(diskMutex[unit]);
+    return 0;
+}
+
+/*
+ *  System call for user function DiskCopy. Serves as a bridge between DiskCopy
+ *  and diskCopyReal
+ */
+void diskCopy(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskCopy(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKCOPY)
+    {
+        USLOSS_Console("diskCopy(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Unpack the args
+    int srcUnit = (int) ((long) args->arg1);
+    int srcBlock = (int) ((long) args->arg2);
+    int dstUnit = (int) ((long) args->arg3);
+    int dstBlock = (int) ((long) args->arg4);
+    int numSectors = (int) ((long) args->arg5);
+
+    int result = diskCopyReal(srcUnit, srcBlock, dstUnit, dstBlock, numSectors);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg1 = (void*) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Copies numSectors sectors starting at srcBlock on srcUnit to dstBlock on
+ *  dstUnit. Blocks count sectors from track 0 sector 0. The copy goes through
+ *  kernel buffers DISK_COPY_CHUNK sectors at a time; while one chunk is written
+ *  to the destination the next is read from the source, so the two drivers work
+ *  at the same time. Overlapping ranges on one unit are not allowed.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were copied successfully >0: disk's status register
+ */
+int diskCopyReal(int srcUnit, int srcBlock, int dstUnit, int dstBlock, int numSectors)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskCopyReal(): called.\n");
+    }
+
+    // Check args
+    if (checkDiskRange(srcUnit, srcBlock, numSectors) == -1 ||
+        checkDiskRange(dstUnit, dstBlock, numSectors) == -1)
+    {
+        return -1;
+    }
+    if (srcUnit == dstUnit && srcBlock < dstBlock + numSectors && dstBlock < srcBlock + numSectors)
+    {
+        return -1;
+    }
+
+    processPtr proc = getCurrentProc();
+    char (*buffers)[DISK_COPY_CHUNK * USLOSS_DISK_SECTOR_SIZE] = DiskCopyBuffers[getpid() % MAXPROC];
+    int numChunks = (numSectors + DISK_COPY_CHUNK - 1) / DISK_COPY_CHUNK;
+    int status = 0;
+
+    // Step i reads chunk i and writes chunk i - 1
+    for (int i = 0; i <= numChunks && status == 0; i++)
+    {
+        clearProcRequest(proc);
+        if (i < numChunks)
+        {
+            int offset = i * DISK_COPY_CHUNK;
+            int count = numSectors - offset < DISK_COPY_CHUNK ? numSectors - offset : DISK_COPY_CHUNK;
+            initDiskRequest(&proc->diskRequests[0], DISK_READ, buffers[i % 2], count,
+                            (srcBlock + offset) / USLOSS_DISK_TRACK_SIZE,
+                            (srcBlock + offset) % USLOSS_DISK_TRACK_SIZE, srcUnit);
+        }
+        if (i > 0)
+        {
+            int offset = (i - 1) * DISK_COPY_CHUNK;
+            int count = numSectors - offset < DISK_COPY_CHUNK ? numSectors - offset : DISK_COPY_CHUNK;
+            initDiskRequest(&proc->diskRequests[1], DISK_WRITE, buffers[(i - 1) % 2], count,
+                            (dstBlock + offset) / USLOSS_DISK_TRACK_SIZE,
+                            (dstBlock + offset) % USLOSS_DISK_TRACK_SIZE, dstUnit);
+        }
+        proc->numDiskRequests = 2;
+
+        waitForDiskRequests(queueDiskRequests(proc));
+
+        status = proc->diskRequests[0].resultStatus;
+        if (status == 0)
+        {
+            status = proc->diskRequests[1].resultStatus;
+        }
+    }
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  System call for user function DiskFill. Serves as a bridge between DiskFill
+ *  and diskFillReal
+ */
+void diskFill(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskFill(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKFILL)
+    {
+        USLOSS_Console("diskFill(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Unpack the args
+    int unit = (int) ((long) args->arg1);
+    int block = (int) ((long) args->arg2);
+    int numSectors = (int) ((long) args->arg3);
+    int pattern = (int) ((long) args->arg4);
+
+    int result = diskFillReal(unit, block, numSectors, pattern);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg1 = (void*) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Sets every byte of numSectors sectors starting at block on unit to pattern.
+ *  Blocks count sectors from track 0 sector 0. Up to MAXDISKBATCH chunks of
+ *  DISK_COPY_CHUNK sectors are written from one kernel buffer at a time.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were filled successfully >0: disk's status register
+ */
+int diskFillReal(int unit, int block, int numSectors, int pattern)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskFillReal(): called.\n");
+    }
+
+    // Check args
+    if (checkDiskRange(unit, block, numSectors) == -1 || pattern < 0 || pattern > 255)
+    {
+        return -1;
+    }
+
+    processPtr proc = getCurrentProc();
+    char *buffer = DiskCopyBuffers[getpid() % MAXPROC][0];
+    memset(buffer, pattern, DISK_COPY_CHUNK * USLOSS_DISK_SECTOR_SIZE);
+
+    int status = 0;
+    int done = 0;
+    while (done < numSectors && status == 0)
+    {
+        // Queue as many chunks as fit in one batch
+        clearProcRequest(proc);
+        int numRequests = 0;
+        while (done < numSectors && numRequests < MAXDISKBATCH)
+        {
+            int count = numSectors - done < DISK_COPY_CHUNK ? numSectors - done : DISK_COPY_CHUNK;
+            initDiskRequest(&proc->diskRequests[numRequests], DISK_WRITE, buffer, count,
+                            (block + done) / USLOSS_DISK_TRACK_SIZE,
+                            (block + done) % USLOSS_DISK_TRACK_SIZE, unit);
+            numRequests++;
+            done += count;
+        }
+        proc->numDiskRequests = numRequests;
+
+        waitForDiskRequests(queueDiskRequests(proc));
+
+        for (int i = 0; i < numRequests && status == 0; i++)
+        {
+            status = proc->diskRequests[i].resultStatus;
+        }
+    }
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  System call for user function DiskPread. Serves as a bridge between
+ *  DiskPread and diskPreadReal
+ */
+void diskPread(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskPread(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKPREAD)
+    {
+        USLOSS_Console("diskPread(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Unpack the args
+    void *buffer = args->arg1;
+    int unit = (int) ((long) args->arg2);
+    int offset = (int) ((long) args->arg3);
+    int length = (int) ((long) args->arg4);
+
+    int result = diskPreadReal(buffer, unit, offset, length);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg1 = (void*) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Reads length bytes of unit, starting at byte offset counted from track 0
+ *  sector 0, into buffer. The sectors holding them are read into a kernel
+ *  buffer DISK_COPY_CHUNK at a time, through diskReadReal, so cached sectors
+ *  don't need the disk.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: bytes were read successfully >0: disk's status register
+ */
+int diskPreadReal(void *buffer, int unit, int offset, int length)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskPreadReal(): called.\n");
+    }
+
+    if (buffer == NULL || checkByteRange(unit, offset, length) == -1)
+    {
+        return -1;
+    }
+
+    char *chunk = DiskCopyBuffers[getpid() % MAXPROC][0];
+    int status = 0;
+    int done = 0;
+    while (done < length && status == 0)
+    {
+        int block = (offset + done) / USLOSS_DISK_SECTOR_SIZE;
+        int skip = (offset + done) % USLOSS_DISK_SECTOR_SIZE;
+        int count = DISK_COPY_CHUNK * USLOSS_DISK_SECTOR_SIZE - skip;
+        if (count > length - done)
+        {
+            count = length - done;
+        }
+        int numSectors = (skip + count + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+
+        status = diskReadReal(chunk, numSectors, block / USLOSS_DISK_TRACK_SIZE,
+                              block % USLOSS_DISK_TRACK_SIZE, unit);
+        if (status == 0)
+        {
+            memcpy(buffer + done, chunk + skip, count);
+        }
+        done += count;
+    }
+    return status;
+}
+
+/*
+ *  System call for user function DiskPwrite. Serves as a bridge between
+ *  DiskPwrite and diskPwriteReal
+ */
+void diskPwrite(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskPwrite(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKPWRITE)
+    {
+        USLOSS_Console("diskPwrite(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    // Unpack the args
+    void *buffer = args->arg1;
+    int unit = (int) ((long) args->arg2);
+    int offset = (int) ((long) args->arg3);
+    int length = (int) ((long) args->arg4);
+
+    int result = diskPwriteReal(buffer, unit, offset, length);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg1 = (void*) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Writes length bytes from buffer to unit, starting at byte offset counted
+ *  from track 0 sector 0. The bytes are copied into a kernel buffer
+ *  DISK_COPY_CHUNK sectors at a time and written with diskWriteReal. A sector
+ *  that is only partly written is read first, through the cache when it is
+ *  there, so the rest of it is kept; that is done under the DiskPwriteMutex
+ *  of each physical unit the sectors are on.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: bytes were written successfully >0: disk's status register
+ */
+int diskPwriteReal(void *buffer, int unit, int offset, int length)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskPwriteReal(): called.\n");
+    }
+
+    if (buffer == NULL || checkByteRange(unit, offset, length) == -1)
+    {
+        return -1;
+    }
+
+    char *chunk = DiskCopyBuffers[getpid() % MAXPROC][0];
+    int status = 0;
+    int done = 0;
+    while (done < length && status == 0)
+    {
+        int block = (offset + done) / USLOSS_DISK_SECTOR_SIZE;
+        int skip = (offset + done) % USLOSS_DISK_SECTOR_SIZE;
+        int count = DISK_COPY_CHUNK * USLOSS_DISK_SECTOR_SIZE - skip;
+        if (count > length - done)
+        {
+            count = length - done;
+        }
+        int numSectors = (skip + count + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+        int partialFirst = skip != 0;
+        int partialLast = (skip + count) % USLOSS_DISK_SECTOR_SIZE != 0;
+
+        // Fill in the parts of the end sectors that aren't being written
+        int patching = partialFirst || partialLast;
+        if (patching)
+        {
+            lockPwriteUnits(unit);
+        }
+        if (partialFirst)
+        {
+            status = diskReadReal(chunk, 1, block / USLOSS_DISK_TRACK_SIZE,
+                                  block % USLOSS_DISK_TRACK_SIZE, unit);
+        }
+        if (status == 0 && partialLast && !(partialFirst && numSectors == 1))
+        {
+            int last = block + numSectors - 1;
+            status = diskReadReal(chunk + (numSectors - 1) * USLOSS_DISK_SECTOR_SIZE, 1,
+                                  last / USLOSS_DISK_TRACK_SIZE, last % USLOSS_DISK_TRACK_SIZE,
+                                  unit);
+        }
+
+        if (status == 0)
+        {
+            memcpy(chunk + skip, buffer + done, count);
+            status = diskWriteReal(chunk, numSectors, block / USLOSS_DISK_TRACK_SIZE,
+                                   block % USLOSS_DISK_TRACK_SIZE, unit);
+        }
+        if (patching)
+        {
+            unlockPwriteUnits(unit);
+        }
+        done += count;
+    }
+    return status;
+}
+
+/*
+ *  Creates the mutexes that DiskPwrite patches the sectors of each unit under.
+ *  Called by start3 before the disk drivers start.
+ */
+void initDiskPwrite()
+{
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        DiskPwriteMutex[unit] = MboxCreate(1, 0);
+        returnMutex(DiskPwriteMutex[unit]);
+    }
+}
+
+/*
+ *  Takes the DiskPwriteMutex of each physical unit that the sectors of unit
+ *  are on, in unit order
+ */
+void lockPwriteUnits(int unit)
+{
+    for (int physical = 0; physical < USLOSS_DISK_UNITS; physical++)
+    {
+        if (physical == unit || unit >= USLOSS_DISK_UNITS)
+        {
+            getMutex(DiskPwriteMutex[physical]);
+        }
+    }
+}
+
+/*
+ *  Releases the mutexes taken by lockPwriteUnits
+ */
+void unlockPwriteUnits(int unit)
+{
+    for (int physical = USLOSS_DISK_UNITS - 1; physical >= 0; physical--)
+    {
+        if (physical == unit || unit >= USLOSS_DISK_UNITS)
+        {
+            returnMutex(DiskPwriteMutex[physical]);
+        }
+    }
+}
+
+/*
+ *  Checks that length bytes starting at byte offset, counted from track 0
+ *  sector 0, lie on unit, which may be a virtual unit. Returns -1 if not and
+ *  0 otherwise.
+ */
+int checkByteRange(int unit, int offset, int length)
+{
+    int sectorSize, trackSize, tracks;
+    if (diskSizeReal(unit, &sectorSize, &trackSize, &tracks) == -1 || offset < 0 ||
+        length < 0 || offset > tracks * trackSize * sectorSize - length)
+    {
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("checkByteRange(): invalid args.\n");
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ *  Checks that numSectors sectors starting at block, counted from track 0
+ *  sector 0, lie on the physical disk unit, and that the unit's sectors are
+ *  the ones on its disk. Returns -1 if not and 0 otherwise.
+ */
+int checkDiskRange(int unit, int block, int numSectors)
+{
+    if (unit < 0 || unit >= USLOSS_DISK_UNITS || mappedDiskUnit(unit) || block < 0 || numSectors < 0 ||
+        block + numSectors > DiskSizes[unit] * USLOSS_DISK_TRACK_SIZE)
+    {
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("checkDiskRange(): invalid args.\n");
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ *  Returns TRUE if the reads and writes of a physical unit go through a map
+ *  rather than to the sectors they name. DiskCopy, DiskFill, DiskSubmitBatch
+ *  and the RAID units name physical sectors, so they can't be used on it.
+ */
+int mappedDiskUnit(int unit)
+{
+    return diskLogStructured[unit] || diskCompressed[unit] || diskRelocate[unit];
+}
+
+/*
+ *  System call for user function DiskSize. Serves as a bridge between DiskSize
+ *  and diskSizeReal
+ */
+void diskSize(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskSize(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_DISKSIZE)
+    {
+        USLOSS_Console("diskRead(): Called with wrong syscall number.\n");;
+        USLOSS_Halt(1);
+    }
+
+    int unit = (int) ((long) args->arg1);
+
+    int sector = -1;
+    int track = -1;
+    int disk = -1;
+
+    int result = diskSizeReal(unit, &sector, &track, &disk);
+
+    args->arg1 = (void*) ((long) sector);
+    args->arg2 = (void*) ((long) track);
+    args->arg3 = (void*) ((long) disk);
+    args->arg4 = (void*) ((long) result);
+
+    //clearProc(getCurrentProc());
+
+    setToUserMode();
+}
+
+/*
+ *  Returns information about the size of the disk indicated by unit. The sector
+ *  parameter is filled in with the number of bytes in a sector, track with the
+ *  number of sectors in a track, and disk with the number of tracks in the disk.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: disk size parameters returned successfully
+ */
+int diskSizeReal(int unit, int *sector, int *track, int *disk)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskSizeReal(): called.\n");
+    }
+
+    // Check params
+    if(unit < 0 || unit >= USLOSS_DISK_UNITS + DISK_VIRTUAL_UNITS)
+    {
+        return -1;
+    }
+
+    // Set the track and sector sizes
+    *track = USLOSS_DISK_TRACK_SIZE;
+    *sector = USLOSS_DISK_SECTOR_SIZE;
+    if (unit == DISK_RAID0_UNIT)
+    {
+        *disk = raid0Tracks();
+    }
+    else if (unit == DISK_RAID1_UNIT)
+    {
+        *disk = raid1Tracks();
+    }
+    else if (diskLogStructured[unit])
+    {
+        *disk = logTracks(unit);
+    }
+    else if (diskCompressed[unit])
+    {
+        *disk = compressTracks(unit);
+    }
+    else if (diskRelocate[unit])
+    {
+        *disk = relocateTracks(unit);
+    }
+    else
+    {
+        *disk = DiskSizes[unit];
+    }
+    return 0;
+}
+
+/*
+ * Fill in a request to the disk on behalf of the current process
+ */
+void initDiskRequest(diskRequestPtr request, int op, void *memAddress, int numSectors,
+                     int startTrack, int startSector, int unit)
+{
+    request->op = op;
+    request->memAddress = memAddress;
+    request->numSectors = numSectors;
+    request->startTrack = startTrack;
+    request->startSector = startSector;
+    request->unit = unit;
+    request->resultStatus = 0;
+    request->ioClass = currentIOClass();
+    request->proc = getCurrentProc();
+    request->nextDiskQueueRequest = NULL;
+}
+
+/*
+ * Initialize the current process with a request and add it to the disk queue
+ */
+void diskQueueAdd(int op, void *memAddress, int numSectors, int startTrack, int startSector, int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskQueueAdd(): called.\n");
+    }
+
+    processPtr proc = &ProcTable[getpid() % MAXPROC];
+    diskRequestPtr request = &proc->diskRequests[0];
+    initDiskRequest(request, op, memAddress, numSectors, startTrack, startSector, unit);
+    proc->numDiskRequests = 1;
+
+    queueDiskRequests(proc);
+}
+
+/*
+ * Puts all of the initialized requests of the given process into their disk
+ * queues. Each unit's requests are inserted under a single acquisition of its
+ * mutex, so the driver sees them all before it starts on any of them, unless
+ * the process has to wait for room in the queue. Requests whose op is EMPTY
+ * are skipped, and DISK_BATCH_BARRIER requests become barriers between the
+ * requests around them. Returns the number of requests queued.
+ */
+int queueDiskRequests(processPtr proc)
+{
+    int numQueued = 0;
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        int numForUnit = 0;
+        int numToSignal = 0;
+        getMutex(diskMutex[unit]);
+        for (int i = 0; i < proc->numDiskRequests; i++)
+        {
+            diskRequestPtr request = &proc->diskRequests[i];
+            if (request->op == DISK_BATCH_BARRIER && request->unit == unit)
+            {
+                queueDiskBarrier(unit);
+            }
+            else if (request->op != EMPTY && request->unit == unit)
+            {
+                if (!admitDiskRequest(proc, unit))
+                {
+                    // Let the driver start on what is already queued while
+                    // this process waits its turn
+                    returnMutex(diskMutex[unit]);
+                    for (; numToSignal > 0; numToSignal--)
+                    {
+                        semvReal(diskSem[unit]);
+                    }
+                    sempReal(proc->diskAdmissionSem);
+                    getMutex(diskMutex[unit]);
+                }
+                insertDiskRequest(request);
+                numForUnit++;
+                numToSignal++;
+            }
+        }
+        if(DEBUG4 && debugflag4)
+        {
+            printQueue(unit);
+        }
+        returnMutex(diskMutex[unit]);
+
+        // The driver takes one request per V
+        for (; numToSignal > 0; numToSignal--)
+        {
+            semvReal(diskSem[unit]);
+        }
+        numQueued += numForUnit;
+    }
+    return numQueued;
+}
+
+/*
+ * Admits one request of proc to the queue of unit if there is room for it and
+ * no process is waiting for room ahead of it, and returns TRUE. Otherwise
+ * puts proc at the end of the line for the unit and returns FALSE; the request
+ * is admitted when the driver wakes proc. The caller must hold diskMutex for
+ * the unit.
+ */
+int admitDiskRequest(processPtr proc, int unit)
+{
+    if (DiskAdmissionHead[unit] == NULL && roomForDiskRequest(proc, unit))
+    {
+        DiskQueueAdmitted[unit]++;
+        proc->diskQueued[unit]++;
+        return TRUE;
+    }
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("admitDiskRequest(): pid %d waits for room in the queue of disk %d.\n",
+                       proc->pid, unit);
+    }
+    proc->nextDiskAdmission = NULL;
+    if (DiskAdmissionTail[unit] == NULL)
+    {
+        DiskAdmissionHead[unit] = proc;
+    }
+    else
+    {
+        DiskAdmissionTail[unit]->nextDiskAdmission = proc;
+    }
+    DiskAdmissionTail[unit] = proc;
+    DiskAdmissionWaiting[unit]++;
+    return FALSE;
+}
+
+/*
+ * Returns TRUE if the limits leave room for another request of proc in the
+ * queue of unit. The caller must hold diskMutex for the unit.
+ */
+int roomForDiskRequest(processPtr proc, int unit)
+{
+    return (diskQueueLimit[unit] <= 0 || DiskQueueAdmitted[unit] < diskQueueLimit[unit]) &&
+           (diskProcessQueueLimit <= 0 || proc->diskQueued[unit] < diskProcessQueueLimit);
+}
+
+/*
+ * Called by the driver when it takes a request out of its queue. Frees the
+ * request's place, then admits the waiting processes in order for as long as
+ * there is room for the first of them.
+ */
+void releaseDiskAdmission(diskRequestPtr request)
+{
+    int unit = request->unit;
+    getMutex(diskMutex[unit]);
+    DiskQueueAdmitted[unit]--;
+    request->proc->diskQueued[unit]--;
+    while (DiskAdmissionHead[unit] != NULL && roomForDiskRequest(DiskAdmissionHead[unit], unit))
+    {
+        processPtr next = DiskAdmissionHead[unit];
+        DiskAdmissionHead[unit] = next->nextDiskAdmission;
+        if (DiskAdmissionHead[unit] == NULL)
+        {
+            DiskAdmissionTail[unit] = NULL;
+        }
+        next->nextDiskAdmission = NULL;
+        DiskAdmissionWaiting[unit]--;
+        DiskQueueAdmitted[unit]++;
+        next->diskQueued[unit]++;
+        semvReal(next->diskAdmissionSem);
+    }
+    returnMutex(diskMutex[unit]);
+}
+
+/*
+ * Lets the process that issued the given request know that it has finished
+ */
+void finishDiskRequest(diskRequestPtr request)
+{
+    // Record the request before the process can reuse it
+    int now;
+    gettimeofdayReal(&now);
+    getMutex(diskMutex[request->unit]);
+    DiskStatistics *stats = &DiskUnitStats[request->unit];
+    stats->requests++;
+    stats->sectors += request->numSectors;
+    stats->waitHistogram[statsBucket(request->startTime - request->queueTime)]++;
+    stats->serviceHistogram[statsBucket(now - request->startTime)]++;
+    returnMutex(diskMutex[request->unit]);
+
+    if (DiskTrace != NULL)
+    {
+        traceDiskRequest(request, now);
+    }
+
+    MboxSend(request->proc->diskCompletionMboxID, NULL, 0);
+}
+
+/*
+ * Returns the histogram bucket for a duration in microseconds
+ */
+int statsBucket(int micros)
+{
+    int bucket = 0;
+    int limit = 1000;
+    while (micros >= limit && bucket < DISK_STATS_BUCKETS - 1)
+    {
+        bucket++;
+        limit *= 2;
+    }
+    return bucket;
+}
+
+/*
+ *  Opens the trace file named by diskTraceFile, if there is one
+ */
+void openDiskTrace()
+{
+    if (diskTraceFile == NULL)
+    {
+        return;
+    }
+
+    DiskTrace = fopen(diskTraceFile, "wb");
+    if (DiskTrace == NULL)
+    {
+        USLOSS_Console("openDiskTrace(): Could not open trace file %s.\n", diskTraceFile);
+        return;
+    }
+
+    // Both drivers write to the trace, so it gets a mutex
+    diskTraceMutex = MboxCreate(1, 0);
+    returnMutex(diskTraceMutex);
+}
+
+/*
+ *  Closes the trace file, if one is open
+ */
+void closeDiskTrace()
+{
+    if (DiskTrace != NULL)
+    {
+        fclose(DiskTrace);
+        DiskTrace = NULL;
+    }
+}
+
+/*
+ *  Appends a record of a request that finished at time now to the trace file
+ */
+void traceDiskRequest(diskRequestPtr request, int now)
+{
+    diskTraceRecord record;
+    record.queueTime = request->queueTime;
+    record.waitTime = request->startTime - request->queueTime;
+    record.serviceTime = now - request->startTime;
+    record.pid = request->proc->pid;
+    record.op = request->op;
+    record.unit = request->unit;
+    record.track = request->startTrack;
+    record.sector = request->startSector;
+    record.numSectors = request->numSectors;
+    record.ioClass = request->ioClass;
+
+    getMutex(diskTraceMutex);
+    if (fwrite(&record, sizeof(record), 1, DiskTrace) != 1)
+    {
+        USLOSS_Console("traceDiskRequest(): Could not write to the trace file.\n");
+    }
+    returnMutex(diskTraceMutex);
+}
+
+/*
+ * Blocks the current process until count of its disk requests have finished
+ */
+void waitForDiskRequests(int count)
+{
+    processPtr proc = getCurrentProc();
+    for (int i = 0; i < count; i++)
+    {
+        MboxReceive(proc->diskCompletionMboxID, NULL, 0);
+    }
+}
+
+/*
+ * Adds a request for one sector to the requests of proc. The sector is given
+ * as block, counted from track 0 sector 0. If extend is set the sector follows
+ * the last request on disk and in memory, so that request grows instead.
+ * Returns the number of requests.
+ */
+int addSectorRequest(processPtr proc, int op, int unit, void *memAddress, int block, int extend)
+{
+    if (extend)
+    {
+        proc->diskRequests[proc->numDiskRequests - 1].numSectors++;
+    }
+    else
+    {
+        initDiskRequest(&proc->diskRequests[proc->numDiskRequests], op, memAddress, 1,
+                        block / USLOSS_DISK_TRACK_SIZE, block % USLOSS_DISK_TRACK_SIZE, unit);
+        proc->numDiskRequests++;
+    }
+    return proc->numDiskRequests;
+}
+
+/*
+ * Queues all of the requests of proc, waits for them to finish, and returns
+ * the first non-zero status among them, or 0
+ */
+int runDiskRequests(processPtr proc)
+{
+    int numQueued = queueDiskRequests(proc);
+    waitForDiskRequests(numQueued);
+
+    int status = 0;
+    for (int i = 0; i < proc->numDiskRequests && status == 0; i++)
+    {
+        status = proc->diskRequests[i].resultStatus;
+    }
+    return status;
+}
+
+/*
+ *  Perform a disk operation as defined in the given request struct
+ */
+int performDiskOp(diskRequestPtr requestPtr)
+{
+    diskRequest request = *requestPtr;
+
+    // Seek to the given track
+    int result = seekTrack(request.unit, request.startTrack);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    // Read/Write from the given track
+    int currentTrack = request.startTrack;
+    for (int i = 0; i < request.numSectors; i++)
+    {
+        // Assume sectors start from 0
+
+        int sector = request.startSector + i;
         int overflow = sector / USLOSS_DISK_TRACK_SIZE;
         sector = sector % USLOSS_DISK_TRACK_SIZE;
         int track = request.startTrack + overflow;
@@ -517,9 +1681,25 @@ int performDiskOp(processPtr proc)
         if (status == USLOSS_DEV_ERROR)
         {
             // Inform the proc of the error
-            proc->diskRequest.resultStatus = status;
+            if (diskSparseSectors)
+            {
+                noteSectorContents(request.unit, track, sector, NULL);
+            }
+            requestPtr->resultStatus = status;
             return 0;
         }
+
+        // Keep track of which sectors hold only zeros
+        if (diskSparseSectors)
+        {
+            noteSectorContents(request.unit, track, sector, uslossRequest.reg2);
+        }
+
+        // Keep cached tracks the same as the disk
+        if (request.op == DISK_WRITE)
+        {
+            cacheNoteWrite(request.unit, track, sector, uslossRequest.reg2);
+        }
     }
 
     return 0;
@@ -530,6 +1710,14 @@ int performDiskOp(processPtr proc)
  */
 int seekTrack(int unit, int track)
 {
+    // Record the seek
+    if (track != DiskHeadTrack[unit])
+    {
+        DiskUnitStats[unit].seeks++;
+        DiskUnitStats[unit].seekDistance += abs(track - DiskHeadTrack[unit]);
+        DiskHeadTrack[unit] = track;
+    }
+
     // Send the disk a seek request
     USLOSS_DeviceRequest request;
     request.opr = USLOSS_DISK_SEEK;
@@ -547,19 +1735,84 @@ int seekTrack(int unit, int track)
 }
 
 /*
- *  A debugging function that prints the current disk queue and next disk request
+ *  Fills in the seek cost table of a unit by timing seeks of 1, 2, 4, ...
+ *  tracks out from track 0 and back, DISK_SEEK_SAMPLES times each. Distances
+ *  longer than the disk get costs extrapolated from the two longest that fit.
+ *  The head is left at track 0, and the calibration seeks aren't counted in
+ *  the statistics. Called by the driver before it takes any requests.
  */
-void printQueue(int unit){
-    USLOSS_Console("Printing the disk queue for unit %d\nQueue: ", unit);
-    processPtr current = DiskDriverQueue[unit];
-    while(current != NULL){
-        USLOSS_Console("%d ", current->pid);
-        current = current->nextDiskQueueProc;
+void calibrateSeeks(int unit)
+{
+    DiskStatistics saved = DiskUnitStats[unit];
+    seekTrack(unit, 0);
+
+    int point = 0;
+    for (; point < DISK_SEEK_COST_POINTS && (1 << point) < DiskSizes[unit]; point++)
+    {
+        int total = 0;
+        for (int i = 0; i < DISK_SEEK_SAMPLES; i++)
+        {
+            int start, end;
+            gettimeofdayReal(&start);
+            seekTrack(unit, 1 << point);
+            seekTrack(unit, 0);
+            gettimeofdayReal(&end);
+            total += end - start;
+        }
+        DiskSeekCost[unit][point] = total / (2 * DISK_SEEK_SAMPLES);
+    }
+    DiskUnitStats[unit] = saved;
+
+    // A disk too small to calibrate keeps costing seeks by distance
+    if (point < 2)
+    {
+        return;
+    }
+    for (; point < DISK_SEEK_COST_POINTS; point++)
+    {
+        int last = DiskSeekCost[unit][point - 1];
+        int step = last - DiskSeekCost[unit][point - 2];
+        DiskSeekCost[unit][point] = last + (step > 0 ? step : 0);
     }
-    USLOSS_Console("\t\tNext: ");
-    if(NextDiskRequest[unit] != NULL)
+    DiskSeekCalibrated[unit] = TRUE;
+
+    if (DEBUG4 && debugflag4)
+    {
+        for (point = 0; point < DISK_SEEK_COST_POINTS; point++)
+        {
+            USLOSS_Console("calibrateSeeks(%d): %d tracks take %d us.\n", unit, 1 << point,
+                           DiskSeekCost[unit][point]);
+        }
+    }
+}
+
+/*
+ *  Prints the statistics gathered for the given unit
+ */
+void printDiskStats(int unit)
+{
+    DiskStatistics *stats = &DiskUnitStats[unit];
+    USLOSS_Console("Disk %d statistics:\n", unit);
+    USLOSS_Console("  requests: %d  sectors: %d  seeks: %d  seek distance: %d  max queue depth: %d\n",
+                   stats->requests, stats->sectors, stats->seeks, stats->seekDistance,
+                   stats->maxQueueDepth);
+    USLOSS_Console("  %-12s %10s %10s\n", "time (ms)", "queued", "service");
+    for (int i = 0; i < DISK_STATS_BUCKETS; i++)
     {
-        USLOSS_Console("%d", NextDiskRequest[unit]->pid);
+        char range[20];
+        if (i == 0)
+        {
+            sprintf(range, "< 1");
+        }
+        else if (i == DISK_STATS_BUCKETS - 1)
+        {
+            sprintf(range, ">= %d", 1 << (i - 1));
+        }
+        else
+        {
+            sprintf(range, "%d - %d", 1 << (i - 1), 1 << i);
+        }
+        USLOSS_Console("  %-12s %10d %10d\n", range, stats->waitHistogram[i],
+                       stats->serviceHistogram[i]);
     }
-    USLOSS_Console("\n");
 }
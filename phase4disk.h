@@ -3,17 +3,126 @@
 
 #include "devices.h"
 
+// Default number of sectors served from one process per turn in fair share mode
+#define DISK_FAIR_SHARE_BUDGET  (4 * USLOSS_DISK_TRACK_SIZE)
+
+// Default time, in microseconds, and distance, in tracks, that the driver
+// waits for a reader's next request in anticipatory mode
+#define DISK_ANTICIPATE_WINDOW  6000
+#define DISK_ANTICIPATE_DISTANCE 2
+
+// Most follow-up reads in a row remembered for a process in anticipatory mode
+#define DISK_ANTICIPATE_HISTORY 4
+
+// Default time, in microseconds, and number of queued requests after which a
+// plugged queue is unplugged
+#define DISK_PLUG_WINDOW        3000
+#define DISK_PLUG_REQUESTS      8
+
+// Seek distances, 1, 2, 4, ... tracks, timed by seek calibration, and the
+// number of times each is timed
+#define DISK_SEEK_COST_POINTS   12
+#define DISK_SEEK_SAMPLES       2
+
+// Number of sectors DiskCopy and DiskFill move with each request
+#define DISK_COPY_CHUNK         8
+
+extern int diskFairShare;
+extern int diskFairShareBudget;
+extern int diskAnticipate;
+extern int diskAnticipateWindow;
+extern int diskAnticipateDistance;
+extern int DiskAnticipatePid[USLOSS_DISK_UNITS];
+extern int diskSeekCalibrate;
+extern int DiskSeekCost[USLOSS_DISK_UNITS][DISK_SEEK_COST_POINTS];
+extern int DiskSeekCalibrated[USLOSS_DISK_UNITS];
+extern int diskPlug;
+extern int diskPlugWindow;
+extern int diskPlugRequests;
+extern semaphore diskPlugSem[USLOSS_DISK_UNITS];
+extern semaphore diskUnplugSem;
+extern int DiskPlugged[USLOSS_DISK_UNITS];
+extern int DiskPlugDrained[USLOSS_DISK_UNITS];
+extern int diskStatsAtShutdown;
+extern char *diskTraceFile;
+extern int diskQueueLimit[USLOSS_DISK_UNITS];
+extern int diskProcessQueueLimit;
+
 extern void diskRead(systemArgs *);
 extern void diskWrite(systemArgs *);
 extern void diskSize(systemArgs *);
+extern void diskSubmitBatch(systemArgs *);
+extern void diskSetIOClass(systemArgs *);
+extern void diskStats(systemArgs *);
+extern void diskCopy(systemArgs *);
+extern void diskFill(systemArgs *);
+extern void diskQueueDepth(systemArgs *);
+extern void diskPread(systemArgs *);
+extern void diskPwrite(systemArgs *);
+extern void diskBarrier(systemArgs *);
 
 extern int diskReadReal(void *, int, int, int, int);
 extern int diskWriteReal(void *, int, int, int, int);
 extern int diskSizeReal(int, int *, int *, int *);
+extern int diskSubmitBatchReal(DiskBatchRequest *, int);
+extern int diskSetIOClassReal(int);
+extern int diskStatsReal(int, DiskStatistics *);
+extern int diskCopyReal(int, int, int, int, int);
+extern int diskFillReal(int, int, int, int);
+extern int diskQueueDepthReal(int, int *, int *, int *);
+extern int diskPreadReal(void *, int, int, int);
+extern int diskPwriteReal(void *, int, int, int);
+extern int diskBarrierReal(int);
+extern int checkByteRange(int, int, int);
+extern int mappedDiskUnit(int);
+extern void initDiskPwrite();
+extern void lockPwriteUnits(int);
+extern void unlockPwriteUnits(int);
+extern int checkDiskRange(int, int, int);
+extern int checkDiskArgs(char *, int, int, int, int);
+extern int validIOClass(int);
+extern int currentIOClass();
 
-extern int performDiskOp(processPtr);
+extern int performDiskOp(diskRequestPtr);
+extern void initDiskRequest(diskRequestPtr, int, void *, int, int, int, int);
 extern void diskQueueAdd(int, void*, int, int, int, int);
-extern processPtr dequeueDiskRequest(int);
+extern int compareRequests(diskRequest *, diskRequest *);
+extern void insertDiskRequest(diskRequestPtr);
+extern void sortDiskRequest(diskRequestPtr);
+extern diskRequestPtr dequeueDiskRequest(int);
+extern void queueDiskBarrier(int);
+extern int diskQueuesEmpty(int);
+extern void releaseHeldRequests(int);
+extern diskRequestPtr removeNextDiskRequest(int, int);
+extern diskRequestPtr removeFairDiskRequest(int, int);
+extern diskRequestPtr nextRequestForPid(int, int, int);
+extern int nextQueuedPid(int, int, int);
+extern void anticipateNextRequest(diskRequestPtr);
+extern void noteFollowUpRead(diskRequestPtr);
+extern void forgetDiskProcess(int);
+extern int waitForAnticipatedRequest(int);
+extern diskRequestPtr anticipatedRequest(int, int);
+extern int worthAnticipating(int, int);
+extern int waitForPluggedRequests(int);
+extern void unplugDiskQueue(int);
+extern void unplugDiskQueues();
+extern void expireDiskPlugs();
+extern int queueDiskRequests(processPtr);
+extern int admitDiskRequest(processPtr, int);
+extern int roomForDiskRequest(processPtr, int);
+extern void releaseDiskAdmission(diskRequestPtr);
+extern void finishDiskRequest(diskRequestPtr);
+extern void waitForDiskRequests(int);
+extern int runDiskRequests(processPtr);
+extern int addSectorRequest(processPtr, int, int, void *, int, int);
+extern void openDiskTrace();
+extern void closeDiskTrace();
+extern void traceDiskRequest(diskRequestPtr, int);
+extern int statsBucket(int);
+extern void printDiskStats(int);
 extern int seekTrack(int, int);
+extern void calibrateSeeks(int);
+extern int seekCost(int, int, int);
+extern void printQueue(int);
 
 #endif
@@ -0,0 +1,800 @@
+/*
+ *  File: phase4diskqueue.c
+ *  Purpose: This file holds the disk request queues and the policies used to
+ *  decide which request each disk driver serves next. It only depends on the
+ *  disk mutexes and the clock, so it can also be built on the host.
+ */
+
+#include <usloss.h>
+#include <stdlib.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+
+extern int debugflag4;
+extern int diskMutex[USLOSS_DISK_UNITS];
+extern DiskStatistics DiskUnitStats[USLOSS_DISK_UNITS];
+
+// Pointers to the queues of disk operations, one per I/O priority class
+diskRequestPtr DiskDriverQueue[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+diskRequestPtr NextDiskRequest[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+
+// Fair share scheduling. When diskFairShare is set the driver takes turns between
+// the processes with queued requests, serving up to diskFairShareBudget sectors
+// from each before moving on.
+int diskFairShare = FALSE;
+int diskFairShareBudget = DISK_FAIR_SHARE_BUDGET;
+int DiskActivePid[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+int DiskBudgetLeft[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+
+// Anticipatory scheduling. When diskAnticipate is set, a driver that has just
+// finished a read waits up to diskAnticipateWindow microseconds for the same
+// process to ask for something within diskAnticipateDistance tracks of where
+// the read ended, before it serves anyone else. It only waits for a process
+// whose last reads were each followed that way: DiskAnticipateHits counts the
+// follow-ups in a row for the process in each proc table slot, up to
+// DISK_ANTICIPATE_HISTORY, and DiskLastRead* record where and when its last
+// read ended. The driver checks the clock itself while it waits, and stops
+// waiting for a process that quits.
+int diskAnticipate = FALSE;
+int diskAnticipateWindow = DISK_ANTICIPATE_WINDOW;
+int diskAnticipateDistance = DISK_ANTICIPATE_DISTANCE;
+int DiskAnticipatePid[USLOSS_DISK_UNITS];
+int DiskAnticipateTrack[USLOSS_DISK_UNITS];
+int DiskAnticipateClass[USLOSS_DISK_UNITS];
+int DiskAnticipateDeadline[USLOSS_DISK_UNITS];
+static int DiskAnticipateHits[USLOSS_DISK_UNITS][MAXPROC];
+static int DiskLastReadPid[USLOSS_DISK_UNITS][MAXPROC];
+static int DiskLastReadTrack[USLOSS_DISK_UNITS][MAXPROC];
+static int DiskLastReadTime[USLOSS_DISK_UNITS][MAXPROC];
+
+// Seek costs. When diskSeekCalibrate is set each driver times seeks of 1, 2,
+// 4, ... tracks when it starts, and DiskSeekCost holds the times in
+// microseconds. Without a calibration a seek costs its distance in tracks.
+// Costs are only ever compared with each other.
+int diskSeekCalibrate = FALSE;
+int DiskSeekCost[USLOSS_DISK_UNITS][DISK_SEEK_COST_POINTS];
+int DiskSeekCalibrated[USLOSS_DISK_UNITS];
+
+// Queue plugging. When diskPlug is set, a driver that has caught up with its
+// queue waits on diskPlugSem before taking the next request, so that a burst
+// of requests can be queued and sorted before it starts on any of them. The
+// queue is unplugged when diskPlugRequests requests are queued, when
+// diskPlugWindow microseconds have passed, or when the unplugger process runs.
+// The unplugger has the lowest priority, so it only runs once the processes
+// waiting for plugged requests have nothing else to do.
+int diskPlug = FALSE;
+int diskPlugWindow = DISK_PLUG_WINDOW;
+int diskPlugRequests = DISK_PLUG_REQUESTS;
+semaphore diskPlugSem[USLOSS_DISK_UNITS];
+semaphore diskUnplugSem;
+int DiskPlugged[USLOSS_DISK_UNITS];
+int DiskPlugDrained[USLOSS_DISK_UNITS];
+int DiskPlugDeadline[USLOSS_DISK_UNITS];
+
+// Write barriers. A barrier starts a new epoch for a unit, and each request is
+// tagged with the epoch it was queued in. Only requests of the oldest epoch
+// still queued are sorted into the queues that the policies above choose
+// from; later ones wait in DiskBarrierHeld, in the order they came, until the
+// driver has taken every older request. Since a driver performs one request
+// at a time, that is when the older requests have all finished.
+int DiskBarrierEpoch[USLOSS_DISK_UNITS];
+int DiskReleasedEpoch[USLOSS_DISK_UNITS];
+diskRequestPtr DiskBarrierHeld[USLOSS_DISK_UNITS];
+diskRequestPtr DiskBarrierHeldTail[USLOSS_DISK_UNITS];
+
+/*
+ * Insert a request into the disk queue for its unit and I/O class in sorted
+ * order, or hold it back if it came after a barrier that older requests are
+ * still queued before. The caller must hold diskMutex for the unit.
+ */
+void insertDiskRequest(diskRequestPtr request)
+{
+    int unit = request->unit;
+
+    // Update the statistics
+    gettimeofdayReal(&request->queueTime);
+    DiskStatistics *stats = &DiskUnitStats[unit];
+    stats->queueDepth++;
+    if (stats->queueDepth > stats->maxQueueDepth)
+    {
+        stats->maxQueueDepth = stats->queueDepth;
+    }
+
+    // Nothing older is queued, so a barrier before this request has been met
+    request->epoch = DiskBarrierEpoch[unit];
+    if (DiskBarrierHeld[unit] == NULL && diskQueuesEmpty(unit))
+    {
+        DiskReleasedEpoch[unit] = request->epoch;
+    }
+
+    if (request->epoch == DiskReleasedEpoch[unit])
+    {
+        sortDiskRequest(request);
+    }
+    else
+    {
+        request->nextDiskQueueRequest = NULL;
+        if (DiskBarrierHeld[unit] == NULL)
+        {
+            DiskBarrierHeld[unit] = request;
+        }
+        else
+        {
+            DiskBarrierHeldTail[unit]->nextDiskQueueRequest = request;
+        }
+        DiskBarrierHeldTail[unit] = request;
+    }
+
+    // Learn whether reads from this process follow on from each other
+    if (diskAnticipate && request->op == DISK_READ)
+    {
+        noteFollowUpRead(request);
+    }
+
+    // A plugged queue that has filled up can go
+    if (DiskPlugged[unit] && stats->queueDepth >= diskPlugRequests)
+    {
+        unplugDiskQueue(unit);
+    }
+}
+
+/*
+ * Puts a request into the queue for its unit and I/O class, in the order
+ * given by compareRequests. The caller must hold diskMutex for the unit.
+ */
+void sortDiskRequest(diskRequestPtr request)
+{
+    int unit = request->unit;
+    int ioClass = request->ioClass;
+
+    if (DiskDriverQueue[unit][ioClass] == NULL)
+    {
+        DiskDriverQueue[unit][ioClass] = request;
+    }
+    else if (compareRequests(DiskDriverQueue[unit][ioClass], request) > 0)
+    {
+        request->nextDiskQueueRequest = DiskDriverQueue[unit][ioClass];
+        DiskDriverQueue[unit][ioClass] = request;
+    }
+    else
+    {
+        diskRequestPtr current = DiskDriverQueue[unit][ioClass];
+        diskRequestPtr next = current->nextDiskQueueRequest;
+        while (next != NULL && compareRequests(request, next) > 0)
+        {
+            current = next;
+            next = next->nextDiskQueueRequest;
+        }
+        current->nextDiskQueueRequest = request;
+        request->nextDiskQueueRequest = next;
+    }
+}
+
+/*
+ * Returns a pointer to the next disk request to process. Requests are taken
+ * from the highest priority I/O class that has any queued, so idle requests
+ * only run when nothing else is waiting. Cleans the next pointer on the
+ * returned request. Removes the returned request from the queue
+ */
+diskRequestPtr dequeueDiskRequest(int unit)
+{
+    getMutex(diskMutex[unit]);
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("diskQueueRequest(): called.\n");
+        printQueue(unit);
+    }
+
+    // Once everything before a barrier has been taken, let in what came after
+    if (diskQueuesEmpty(unit))
+    {
+        releaseHeldRequests(unit);
+    }
+
+    // Find the highest priority class with a request in it
+    int ioClass = 0;
+    while (ioClass < DISK_IOCLASSES && DiskDriverQueue[unit][ioClass] == NULL)
+    {
+        ioClass++;
+    }
+
+    // Return null when the queue is empty
+    if (ioClass == DISK_IOCLASSES)
+    {
+        returnMutex(diskMutex[unit]);
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("diskQueueRequest(): returning NULL.\n");
+        }
+        return NULL;
+    }
+
+    // Serve the request the driver waited for, if it came, moving the
+    // elevator to it
+    diskRequestPtr ret = NULL;
+    if (DiskAnticipatePid[unit] != EMPTY)
+    {
+        diskRequestPtr anticipated = anticipatedRequest(unit, ioClass);
+        DiskAnticipatePid[unit] = EMPTY;
+        if (anticipated != NULL)
+        {
+            NextDiskRequest[unit][ioClass] = anticipated;
+            ret = removeNextDiskRequest(unit, ioClass);
+        }
+    }
+
+    if (ret == NULL && diskFairShare)
+    {
+        ret = removeFairDiskRequest(unit, ioClass);
+    }
+    else if (ret == NULL)
+    {
+        ret = removeNextDiskRequest(unit, ioClass);
+    }
+
+    // The next request to come in finds the driver caught up
+    if (DiskUnitStats[unit].queueDepth == 0)
+    {
+        DiskPlugDrained[unit] = TRUE;
+    }
+
+    if(DEBUG4 && debugflag4)
+    {
+        printQueue(unit);
+    }
+    returnMutex(diskMutex[unit]);
+
+    return ret;
+}
+
+/*
+ * Starts a new barrier epoch for a unit, so that the requests queued from now
+ * on are only served once those queued before have been. The caller must
+ * hold diskMutex for the unit.
+ */
+void queueDiskBarrier(int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("queueDiskBarrier(): barrier %d on disk %d.\n",
+                       DiskBarrierEpoch[unit] + 1, unit);
+    }
+    DiskBarrierEpoch[unit]++;
+}
+
+/*
+ * Returns TRUE if no request of a unit is in the queues the driver chooses
+ * from, although some may be held back by a barrier. The caller must hold
+ * diskMutex for the unit.
+ */
+int diskQueuesEmpty(int unit)
+{
+    for (int ioClass = 0; ioClass < DISK_IOCLASSES; ioClass++)
+    {
+        if (DiskDriverQueue[unit][ioClass] != NULL)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Sorts the held requests of the oldest epoch into the queues of a unit,
+ * called once the requests before their barrier have all been taken. The
+ * caller must hold diskMutex for the unit.
+ */
+void releaseHeldRequests(int unit)
+{
+    if (DiskBarrierHeld[unit] == NULL)
+    {
+        return;
+    }
+
+    DiskReleasedEpoch[unit] = DiskBarrierHeld[unit]->epoch;
+    while (DiskBarrierHeld[unit] != NULL && DiskBarrierHeld[unit]->epoch == DiskReleasedEpoch[unit])
+    {
+        diskRequestPtr request = DiskBarrierHeld[unit];
+        DiskBarrierHeld[unit] = request->nextDiskQueueRequest;
+        request->nextDiskQueueRequest = NULL;
+        sortDiskRequest(request);
+    }
+    if (DiskBarrierHeld[unit] == NULL)
+    {
+        DiskBarrierHeldTail[unit] = NULL;
+    }
+}
+
+/*
+ * Removes and returns the request at the elevator position of the given
+ * non-empty queue, advancing the elevator past it. The caller must hold
+ * diskMutex for the unit.
+ */
+diskRequestPtr removeNextDiskRequest(int unit, int ioClass)
+{
+    // Initialize next request on first call
+    if (NextDiskRequest[unit][ioClass] == NULL)
+    {
+        NextDiskRequest[unit][ioClass] = DiskDriverQueue[unit][ioClass];
+    }
+
+    // Get the request to dequeue and update
+    diskRequestPtr ret = NextDiskRequest[unit][ioClass];
+    NextDiskRequest[unit][ioClass] = ret->nextDiskQueueRequest;
+
+    // Search for the parent of the request to dequeue and remove
+    if (ret != DiskDriverQueue[unit][ioClass])
+    {
+        diskRequestPtr parent = DiskDriverQueue[unit][ioClass];
+        while (parent->nextDiskQueueRequest != ret)
+        {
+            parent = parent->nextDiskQueueRequest;
+        }
+
+        // Remove ret
+        parent->nextDiskQueueRequest = ret->nextDiskQueueRequest;
+    }
+    else
+    {
+        DiskDriverQueue[unit][ioClass] = ret->nextDiskQueueRequest;
+    }
+
+    if (NextDiskRequest[unit][ioClass] == NULL)
+    {
+        NextDiskRequest[unit][ioClass] = DiskDriverQueue[unit][ioClass];
+    }
+
+    ret->nextDiskQueueRequest = NULL;
+    DiskUnitStats[unit].queueDepth--;
+    gettimeofdayReal(&ret->startTime);
+    return ret;
+}
+
+/*
+ * Fair share version of removeNextDiskRequest. Keeps serving the active process
+ * for the unit and class, in elevator order, until it has used its budget of
+ * sectors or has nothing left queued. Then the turn passes to the process with
+ * the next higher pid that has a queued request, wrapping around. The caller
+ * must hold diskMutex for the unit.
+ */
+diskRequestPtr removeFairDiskRequest(int unit, int ioClass)
+{
+    diskRequestPtr ret = NULL;
+    if (DiskBudgetLeft[unit][ioClass] > 0)
+    {
+        ret = nextRequestForPid(unit, ioClass, DiskActivePid[unit][ioClass]);
+    }
+
+    // Pass the turn on to the next process
+    if (ret == NULL)
+    {
+        int pid = nextQueuedPid(unit, ioClass, DiskActivePid[unit][ioClass]);
+        DiskActivePid[unit][ioClass] = pid;
+        DiskBudgetLeft[unit][ioClass] = diskFairShareBudget;
+        ret = nextRequestForPid(unit, ioClass, pid);
+    }
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("removeFairDiskRequest(): serving pid %d with %d sectors of budget left.\n",
+                       DiskActivePid[unit][ioClass], DiskBudgetLeft[unit][ioClass]);
+    }
+
+    // Move the elevator to the chosen request and take it
+    NextDiskRequest[unit][ioClass] = ret;
+    ret = removeNextDiskRequest(unit, ioClass);
+    DiskBudgetLeft[unit][ioClass] -= ret->numSectors > 0 ? ret->numSectors : 1;
+    return ret;
+}
+
+/*
+ * Returns the first request from the given pid at or after the elevator
+ * position of a queue, wrapping around to the front. Returns NULL if the pid
+ * has nothing queued.
+ */
+diskRequestPtr nextRequestForPid(int unit, int ioClass, int pid)
+{
+    diskRequestPtr start = NextDiskRequest[unit][ioClass];
+    if (start == NULL)
+    {
+        start = DiskDriverQueue[unit][ioClass];
+    }
+    for (diskRequestPtr current = start; current != NULL; current = current->nextDiskQueueRequest)
+    {
+        if (current->proc->pid == pid)
+        {
+            return current;
+        }
+    }
+    for (diskRequestPtr current = DiskDriverQueue[unit][ioClass]; current != start;
+         current = current->nextDiskQueueRequest)
+    {
+        if (current->proc->pid == pid)
+        {
+            return current;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns the smallest pid greater than pid that has a request in the given
+ * non-empty queue. Wraps around to the smallest queued pid if there is none.
+ */
+int nextQueuedPid(int unit, int ioClass, int pid)
+{
+    int next = EMPTY;
+    int smallest = EMPTY;
+    for (diskRequestPtr current = DiskDriverQueue[unit][ioClass]; current != NULL;
+         current = current->nextDiskQueueRequest)
+    {
+        int queuedPid = current->proc->pid;
+        if (smallest == EMPTY || queuedPid < smallest)
+        {
+            smallest = queuedPid;
+        }
+        if (queuedPid > pid && (next == EMPTY || queuedPid < next))
+        {
+            next = queuedPid;
+        }
+    }
+    return next == EMPTY ? smallest : next;
+}
+
+/*
+ * Called by the driver of a unit when it has performed a request. After a
+ * read that worked, the driver anticipates another request from the same
+ * process near where the read ended, if the process's last reads were each
+ * followed by one.
+ */
+void anticipateNextRequest(diskRequestPtr request)
+{
+    if (!diskAnticipate)
+    {
+        return;
+    }
+
+    int unit = request->unit;
+    getMutex(diskMutex[unit]);
+    DiskAnticipatePid[unit] = EMPTY;
+    if (request->op == DISK_READ && request->resultStatus == 0)
+    {
+        int now;
+        gettimeofdayReal(&now);
+        int pid = request->proc->pid;
+        int slot = pid % MAXPROC;
+        int track = request->startTrack +
+            (request->startSector + request->numSectors - 1) / USLOSS_DISK_TRACK_SIZE;
+        if (DiskLastReadPid[unit][slot] != pid)
+        {
+            DiskAnticipateHits[unit][slot] = 0;
+        }
+        DiskLastReadPid[unit][slot] = pid;
+        DiskLastReadTrack[unit][slot] = track;
+        DiskLastReadTime[unit][slot] = now;
+
+        if (DiskAnticipateHits[unit][slot] > 0)
+        {
+            DiskAnticipatePid[unit] = pid;
+            DiskAnticipateTrack[unit] = track;
+            DiskAnticipateClass[unit] = request->ioClass;
+            DiskAnticipateDeadline[unit] = now + diskAnticipateWindow;
+        }
+    }
+    returnMutex(diskMutex[unit]);
+}
+
+/*
+ * Counts a read that is being queued as a follow-up if it came within
+ * diskAnticipateWindow of the end of the process's last read on the unit,
+ * and within diskAnticipateDistance tracks of it. Any other read starts the
+ * count again. The caller must hold diskMutex for the unit.
+ */
+void noteFollowUpRead(diskRequestPtr request)
+{
+    int unit = request->unit;
+    int pid = request->proc->pid;
+    int slot = pid % MAXPROC;
+    if (DiskLastReadPid[unit][slot] != pid)
+    {
+        DiskLastReadPid[unit][slot] = pid;
+        DiskLastReadTime[unit][slot] = request->queueTime - diskAnticipateWindow - 1;
+        DiskAnticipateHits[unit][slot] = 0;
+    }
+
+    if (request->queueTime - DiskLastReadTime[unit][slot] <= diskAnticipateWindow &&
+        abs(request->startTrack - DiskLastReadTrack[unit][slot]) <= diskAnticipateDistance)
+    {
+        if (DiskAnticipateHits[unit][slot] < DISK_ANTICIPATE_HISTORY)
+        {
+            DiskAnticipateHits[unit][slot]++;
+        }
+    }
+    else
+    {
+        DiskAnticipateHits[unit][slot] = 0;
+    }
+}
+
+/*
+ * Called when a process quits. A driver anticipating a request from it stops
+ * at its next check, and the process's history is forgotten so that a new
+ * process in the same slot starts without one. Doesn't take the disk mutexes,
+ * since the quitting process can't block.
+ */
+void forgetDiskProcess(int pid)
+{
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        if (DiskAnticipatePid[unit] == pid)
+        {
+            DiskAnticipatePid[unit] = EMPTY;
+        }
+        if (DiskLastReadPid[unit][pid % MAXPROC] == pid)
+        {
+            DiskLastReadPid[unit][pid % MAXPROC] = EMPTY;
+            DiskAnticipateHits[unit][pid % MAXPROC] = 0;
+        }
+    }
+}
+
+/*
+ * Returns TRUE if the driver of a unit, which has a request to take, should
+ * wait a moment and check again: it is anticipating a request that hasn't
+ * come yet, its window is still open, nothing more urgent is queued, and the
+ * queued request the elevator is at costs more to seek to than the farthest
+ * request it is waiting for could. Otherwise the anticipation ends unless
+ * the request is already queued. A window that closes with nothing from the
+ * process means its reads no longer follow on, and it isn't anticipated
+ * again until they do.
+ */
+int waitForAnticipatedRequest(int unit)
+{
+    if (!diskAnticipate)
+    {
+        return FALSE;
+    }
+
+    getMutex(diskMutex[unit]);
+    if (diskQueuesEmpty(unit))
+    {
+        // What came after a barrier can be anticipated as well
+        releaseHeldRequests(unit);
+    }
+    int wait = FALSE;
+    if (DiskAnticipatePid[unit] != EMPTY)
+    {
+        int now;
+        gettimeofdayReal(&now);
+        int ioClass = 0;
+        while (ioClass < DISK_IOCLASSES && DiskDriverQueue[unit][ioClass] == NULL)
+        {
+            ioClass++;
+        }
+
+        if (now >= DiskAnticipateDeadline[unit])
+        {
+            DiskAnticipateHits[unit][DiskAnticipatePid[unit] % MAXPROC] = 0;
+            DiskAnticipatePid[unit] = EMPTY;
+        }
+        else if (ioClass < DiskAnticipateClass[unit] ||
+                 (ioClass < DISK_IOCLASSES && !worthAnticipating(unit, ioClass)))
+        {
+            DiskAnticipatePid[unit] = EMPTY;
+        }
+        else if (ioClass == DISK_IOCLASSES || anticipatedRequest(unit, ioClass) == NULL)
+        {
+            wait = TRUE;
+        }
+    }
+    returnMutex(diskMutex[unit]);
+    return wait;
+}
+
+/*
+ * Returns TRUE if the driver of a unit, which has a request to take, should
+ * first wait on diskPlugSem: it emptied its queue since it was last plugged,
+ * and fewer than diskPlugRequests requests are queued. The queue is then
+ * plugged, and the unplugger is woken to unplug it if it gets to run.
+ */
+int waitForPluggedRequests(int unit)
+{
+    if (!diskPlug)
+    {
+        return FALSE;
+    }
+
+    getMutex(diskMutex[unit]);
+    int wait = FALSE;
+    if (DiskPlugDrained[unit] && DiskUnitStats[unit].queueDepth < diskPlugRequests)
+    {
+        int now;
+        gettimeofdayReal(&now);
+        DiskPlugDrained[unit] = FALSE;
+        DiskPlugged[unit] = TRUE;
+        DiskPlugDeadline[unit] = now + diskPlugWindow;
+        semvReal(diskUnplugSem);
+        wait = TRUE;
+    }
+    returnMutex(diskMutex[unit]);
+    return wait;
+}
+
+/*
+ * Wakes the driver of a unit if its queue is plugged. The caller must hold
+ * diskMutex for the unit.
+ */
+void unplugDiskQueue(int unit)
+{
+    if (DiskPlugged[unit])
+    {
+        DiskPlugged[unit] = FALSE;
+        semvReal(diskPlugSem[unit]);
+    }
+}
+
+/*
+ * Called by the unplugger when it runs. Unplugs every plugged queue, since no
+ * other process is ready to add to them.
+ */
+void unplugDiskQueues()
+{
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        if (!DiskPlugged[unit])
+        {
+            continue;
+        }
+        getMutex(diskMutex[unit]);
+        unplugDiskQueue(unit);
+        returnMutex(diskMutex[unit]);
+    }
+}
+
+/*
+ * Called by the clock driver on each interrupt. Unplugs the queues that have
+ * been plugged for longer than diskPlugWindow, so windows are rounded up to
+ * the next clock interrupt.
+ */
+void expireDiskPlugs()
+{
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        // Only a driver that has started can be plugged
+        if (!DiskPlugged[unit])
+        {
+            continue;
+        }
+
+        int now;
+        gettimeofdayReal(&now);
+        getMutex(diskMutex[unit]);
+        if (now >= DiskPlugDeadline[unit])
+        {
+            unplugDiskQueue(unit);
+        }
+        returnMutex(diskMutex[unit]);
+    }
+}
+
+/*
+ * Returns the queued request of the given class from the anticipated process
+ * of a unit that is cheapest to seek to from the anticipated track, within
+ * diskAnticipateDistance tracks of it, or NULL if there is none. The caller
+ * must hold diskMutex for the unit.
+ */
+diskRequestPtr anticipatedRequest(int unit, int ioClass)
+{
+    diskRequestPtr best = NULL;
+    int bestCost = 0;
+    for (diskRequestPtr current = DiskDriverQueue[unit][ioClass]; current != NULL;
+         current = current->nextDiskQueueRequest)
+    {
+        int distance = abs(current->startTrack - DiskAnticipateTrack[unit]);
+        int cost = seekCost(unit, DiskAnticipateTrack[unit], current->startTrack);
+        if (current->proc->pid == DiskAnticipatePid[unit] &&
+            distance <= diskAnticipateDistance && (best == NULL || cost < bestCost))
+        {
+            best = current;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+/*
+ * Returns TRUE if waiting for the anticipated request of a unit could save
+ * seeking, compared with serving the request at the elevator position of the
+ * given non-empty queue. The caller must hold diskMutex for the unit.
+ */
+int worthAnticipating(int unit, int ioClass)
+{
+    diskRequestPtr next = NextDiskRequest[unit][ioClass];
+    if (next == NULL)
+    {
+        next = DiskDriverQueue[unit][ioClass];
+    }
+    int from = DiskAnticipateTrack[unit];
+    return seekCost(unit, from, next->startTrack) >
+           seekCost(unit, from, from + diskAnticipateDistance);
+}
+
+/*
+ * Returns the cost of moving the head of a unit from one track to another.
+ * Distances between the calibrated ones are interpolated, and longer ones
+ * are extrapolated from the last two.
+ */
+int seekCost(int unit, int from, int to)
+{
+    int distance = abs(to - from);
+    if (!DiskSeekCalibrated[unit] || distance == 0)
+    {
+        return distance;
+    }
+
+    // Find the calibrated distances on either side
+    int point = 0;
+    while (point < DISK_SEEK_COST_POINTS - 2 && (2 << point) < distance)
+    {
+        point++;
+    }
+    int low = 1 << point;
+    int lowCost = DiskSeekCost[unit][point];
+    int highCost = DiskSeekCost[unit][point + 1];
+    return lowCost + (highCost - lowCost) * (distance - low) / low;
+}
+
+/*
+ *  A function used to insert disk requests in the correct order in the disk queue
+ *  Returns:
+ *    >0: req1 should go after req2 in the disk queue
+ *    <0: req1 should go before req2 in the disk queue
+ *     0: req1 and req2 are equivalent and should be adjacent in the queue
+ */
+int compareRequests(diskRequest *req1, diskRequest *req2)
+{
+    if (req1->startTrack > req2->startTrack)
+    {
+        return 1;
+    }
+    else if (req2->startTrack > req1->startTrack)
+    {
+        return -1;
+    }
+    else if (req1->startSector > req2->startSector)
+    {
+        return 1;
+    }
+    else if (req2->startSector > req1->startSector)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ *  A debugging function that prints the current disk queues and next disk requests
+ */
+void printQueue(int unit){
+    USLOSS_Console("Printing the disk queue for unit %d\n", unit);
+    for (int ioClass = 0; ioClass < DISK_IOCLASSES; ioClass++)
+    {
+        USLOSS_Console("Class %d queue: ", ioClass);
+        diskRequestPtr current = DiskDriverQueue[unit][ioClass];
+        while(current != NULL){
+            USLOSS_Console("%d ", current->proc->pid);
+            current = current->nextDiskQueueRequest;
+        }
+        USLOSS_Console("\t\tNext: ");
+        if(NextDiskRequest[unit][ioClass] != NULL)
+        {
+            USLOSS_Console("%d", NextDiskRequest[unit][ioClass]->proc->pid);
+        }
+        USLOSS_Console("\n");
+    }
+}
@@ -0,0 +1,922 @@
+/*
+ *  File: phase4file.c
+ *  Purpose: This file holds functions and global variables for a small file
+ *  store kept on one disk unit, reached through the FileOpen, FileRead,
+ *  FileWrite and FileClose system calls. Each file is a list of extents of
+ *  contiguous sectors. New extents are put as close as possible to the end of
+ *  the file's last one, so a file stays on adjacent tracks. The superblock and
+ *  inodes are read into memory by the first FileOpen and written back when a
+ *  file that changed is closed, and at shutdown. All disk access goes through
+ *  diskReadReal and diskWriteReal, so the store works on any kind of unit.
+ *
+ *  Reads and writes of one file are done one at a time, under the file's
+ *  inode mutex, so a sector that is only partly written keeps the bytes that
+ *  another process wrote to the rest of it.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4file.h"
+
+extern int debugflag4;
+
+// The unit the store lives on
+int diskFileStoreUnit = 1;
+
+// Mutex for the inodes, the free map and the open file table, and a mutex
+// for each inode held across a read or write of the file. An inode mutex is
+// always taken before fileStoreMutex.
+int fileStoreMutex;
+static int FileInodeMutex[DISK_FILE_MAX_FILES];
+
+// Whether the store has been read in, and the number of sectors on its unit
+static int FileStoreLoaded = FALSE;
+static int FileStoreSectors;
+
+// The inode table, which inodes changed since they were last written, and
+// which sectors belong to a file
+static fileInode FileInodes[DISK_FILE_MAX_FILES];
+static int FileInodeDirty[DISK_FILE_MAX_FILES];
+static char FileSectorUsed[DISK_FILE_MAX_SECTORS];
+
+static openFile OpenFiles[DISK_FILE_MAX_OPEN];
+
+// Buffer for metadata, used under fileStoreMutex, and a buffer for each
+// process for sectors that are only partly read or written
+static char FileTableBuffer[(1 + DISK_FILE_TABLE_SECTORS) * USLOSS_DISK_SECTOR_SIZE];
+static char FileSectorBuffers[MAXPROC][USLOSS_DISK_SECTOR_SIZE];
+
+static int loadFileStore();
+static int validInode(fileInode *);
+static int writeFileTable(int, int);
+static int findInode(char *);
+static int inodeOpen(int);
+static openFile *getOpenFile(int);
+static int fileSectorToDisk(fileInode *, int, int *);
+static int allocatedSectors(fileInode *);
+static int growFile(fileInode *, int);
+static int findFreeRun(int, int, int *);
+static void freeFileExtents(fileInode *);
+static int fileTransfer(openFile *, int, void *, int);
+static int diskTransfer(int, void *, int, int);
+
+/*
+ *  Sets up the store's mutex and open file table. Called by start3 before any
+ *  process can make a system call.
+ */
+void initFileStore()
+{
+    fileStoreMutex = MboxCreate(1, 0);
+    returnMutex(fileStoreMutex);
+    for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+    {
+        FileInodeMutex[i] = MboxCreate(1, 0);
+        returnMutex(FileInodeMutex[i]);
+    }
+    for (int i = 0; i < DISK_FILE_MAX_OPEN; i++)
+    {
+        OpenFiles[i].inode = EMPTY;
+        OpenFiles[i].position = 0;
+        OpenFiles[i].pid = EMPTY;
+    }
+    FileStoreLoaded = FALSE;
+}
+
+/*
+ *  Writes every changed inode back to disk. Called by start3 at shutdown,
+ *  while the disk drivers still run.
+ */
+void flushFileStore()
+{
+    if (!FileStoreLoaded)
+    {
+        return;
+    }
+
+    initProc();
+    getMutex(fileStoreMutex);
+    for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+    {
+        if (FileInodeDirty[i])
+        {
+            writeFileTable(i, FALSE);
+        }
+    }
+    returnMutex(fileStoreMutex);
+}
+
+/*
+ *  Reads the superblock and inode table of the store, making an empty store if
+ *  the unit doesn't hold one. Called with fileStoreMutex held. Returns -1 if
+ *  the unit can't be used or its store is corrupt, and 0 otherwise.
+ */
+static int loadFileStore()
+{
+    int sectorSize, trackSize, tracks;
+    if (diskSizeReal(diskFileStoreUnit, &sectorSize, &trackSize, &tracks) == -1 || tracks < 2)
+    {
+        USLOSS_Console("loadFileStore(): Disk %d can't hold a file store.\n", diskFileStoreUnit);
+        return -1;
+    }
+    if (tracks > DISK_FILE_MAX_TRACKS)
+    {
+        tracks = DISK_FILE_MAX_TRACKS;
+    }
+    FileStoreSectors = tracks * USLOSS_DISK_TRACK_SIZE;
+
+    int status = diskReadReal(FileTableBuffer, 1 + DISK_FILE_TABLE_SECTORS, 0, 0, diskFileStoreUnit);
+    fileSuperblock *superblock = (fileSuperblock *) FileTableBuffer;
+    if (status != 0 || superblock->magic != DISK_FILE_MAGIC ||
+        superblock->maxFiles != DISK_FILE_MAX_FILES ||
+        superblock->tableSectors != DISK_FILE_TABLE_SECTORS)
+    {
+        // Make a new, empty store
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("loadFileStore(): Making a file store on disk %d.\n", diskFileStoreUnit);
+        }
+        memset(FileInodes, 0, sizeof(FileInodes));
+        for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+        {
+            FileInodeDirty[i] = FALSE;
+        }
+        if (writeFileTable(EMPTY, TRUE) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+        {
+            memcpy(&FileInodes[i], FileTableBuffer + USLOSS_DISK_SECTOR_SIZE +
+                   (i / DISK_FILE_INODES_PER_SECTOR) * USLOSS_DISK_SECTOR_SIZE +
+                   (i % DISK_FILE_INODES_PER_SECTOR) * sizeof(fileInode), sizeof(fileInode));
+            FileInodeDirty[i] = FALSE;
+        }
+    }
+
+    // Work out which sectors the files use. An inode that doesn't fit the
+    // unit, or a sector in two files, means the store can't be trusted.
+    memset(FileSectorUsed, 0, sizeof(FileSectorUsed));
+    for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+    {
+        fileInode *inode = &FileInodes[i];
+        if (!validInode(inode))
+        {
+            USLOSS_Console("loadFileStore(): Inode %d of the file store on disk %d is corrupt.\n",
+                           i, diskFileStoreUnit);
+            return -1;
+        }
+        for (int e = 0; e < inode->numExtents; e++)
+        {
+            for (int s = 0; s < inode->extents[e].length; s++)
+            {
+                if (FileSectorUsed[inode->extents[e].start + s])
+                {
+                    USLOSS_Console("loadFileStore(): Sector %d of disk %d is in two files.\n",
+                                   inode->extents[e].start + s, diskFileStoreUnit);
+                    return -1;
+                }
+                FileSectorUsed[inode->extents[e].start + s] = TRUE;
+            }
+        }
+    }
+
+    FileStoreLoaded = TRUE;
+    return 0;
+}
+
+/*
+ *  Returns TRUE if an inode read from disk has a terminated name, a size its
+ *  sectors can hold, and extents that lie in the data tracks of the unit
+ */
+static int validInode(fileInode *inode)
+{
+    if (memchr(inode->name, '\0', DISK_FILE_NAME_LENGTH) == NULL ||
+        inode->numExtents < 0 || inode->numExtents > DISK_FILE_EXTENTS)
+    {
+        return FALSE;
+    }
+    int sectors = 0;
+    for (int e = 0; e < inode->numExtents; e++)
+    {
+        fileExtent *extent = &inode->extents[e];
+        if (extent->start < DISK_FILE_DATA_START || extent->start >= FileStoreSectors ||
+            extent->length < 1 || extent->length > FileStoreSectors - extent->start)
+        {
+            return FALSE;
+        }
+        sectors += extent->length;
+    }
+    return inode->size >= 0 && inode->size <= sectors * USLOSS_DISK_SECTOR_SIZE;
+}
+
+/*
+ *  Writes the table sector holding the given inode, or with whole set, the
+ *  superblock and every table sector. Called with fileStoreMutex held. Returns
+ *  the status of the write.
+ */
+static int writeFileTable(int inode, int whole)
+{
+    memset(FileTableBuffer, 0, sizeof(FileTableBuffer));
+    fileSuperblock *superblock = (fileSuperblock *) FileTableBuffer;
+    superblock->magic = DISK_FILE_MAGIC;
+    superblock->maxFiles = DISK_FILE_MAX_FILES;
+    superblock->tableSectors = DISK_FILE_TABLE_SECTORS;
+    for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+    {
+        memcpy(FileTableBuffer + USLOSS_DISK_SECTOR_SIZE +
+               (i / DISK_FILE_INODES_PER_SECTOR) * USLOSS_DISK_SECTOR_SIZE +
+               (i % DISK_FILE_INODES_PER_SECTOR) * sizeof(fileInode),
+               &FileInodes[i], sizeof(fileInode));
+    }
+
+    int status;
+    if (whole)
+    {
+        status = diskWriteReal(FileTableBuffer, 1 + DISK_FILE_TABLE_SECTORS, 0, 0, diskFileStoreUnit);
+        for (int i = 0; i < DISK_FILE_MAX_FILES && status == 0; i++)
+        {
+            FileInodeDirty[i] = FALSE;
+        }
+    }
+    else
+    {
+        int sector = 1 + inode / DISK_FILE_INODES_PER_SECTOR;
+        status = diskWriteReal(FileTableBuffer + sector * USLOSS_DISK_SECTOR_SIZE, 1, 0, sector,
+                               diskFileStoreUnit);
+
+        // The other inodes in the sector were written too
+        int first = (sector - 1) * DISK_FILE_INODES_PER_SECTOR;
+        for (int i = first; i < first + DISK_FILE_INODES_PER_SECTOR && i < DISK_FILE_MAX_FILES &&
+             status == 0; i++)
+        {
+            FileInodeDirty[i] = FALSE;
+        }
+    }
+    if (status != 0)
+    {
+        USLOSS_Console("writeFileTable(): Could not write the inode table.\n");
+    }
+    return status;
+}
+
+/*
+ *  System call for user function FileOpen. Serves as a bridge between FileOpen
+ *  and fileOpenReal
+ */
+void fileOpen(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileOpen(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_FILEOPEN)
+    {
+        USLOSS_Console("fileOpen(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    char *name = (char *) args->arg1;
+    int flags = (int) ((long) args->arg2);
+
+    int result = fileOpenReal(name, flags);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg1 = (void*) -1;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg1 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Opens the file with the given name, creating it if flags has
+ *  DISK_FILE_CREATE. DISK_FILE_TRUNCATE empties the file, unless it is already
+ *  open, and DISK_FILE_APPEND starts the file position at its end.
+ *  Return values:
+ *    -1: invalid parameters, no such file, no room for another file, or a
+ *        truncate of an open file
+ *    >=0: the file descriptor
+ */
+int fileOpenReal(char *name, int flags)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileOpenReal(): called.\n");
+    }
+
+    if (name == NULL || name[0] == '\0' || strlen(name) >= DISK_FILE_NAME_LENGTH)
+    {
+        return -1;
+    }
+
+    getMutex(fileStoreMutex);
+    if (!FileStoreLoaded && loadFileStore() == -1)
+    {
+        returnMutex(fileStoreMutex);
+        return -1;
+    }
+
+    // Find a free descriptor
+    int fd = EMPTY;
+    for (int i = 0; i < DISK_FILE_MAX_OPEN && fd == EMPTY; i++)
+    {
+        if (OpenFiles[i].inode == EMPTY)
+        {
+            fd = i;
+        }
+    }
+
+    // Find the file, or make it
+    int inode = findInode(name);
+    if (inode == EMPTY && (flags & DISK_FILE_CREATE))
+    {
+        inode = findInode("");
+        if (inode != EMPTY)
+        {
+            memset(&FileInodes[inode], 0, sizeof(fileInode));
+            strcpy(FileInodes[inode].name, name);
+            FileInodeDirty[inode] = TRUE;
+        }
+    }
+    if (fd == EMPTY || inode == EMPTY)
+    {
+        returnMutex(fileStoreMutex);
+        return -1;
+    }
+
+    // Another descriptor may be part way through reading or writing the
+    // sectors a truncate would free
+    if ((flags & DISK_FILE_TRUNCATE) && inodeOpen(inode))
+    {
+        returnMutex(fileStoreMutex);
+        return -1;
+    }
+
+    if (flags & DISK_FILE_TRUNCATE)
+    {
+        freeFileExtents(&FileInodes[inode]);
+        FileInodes[inode].size = 0;
+        FileInodeDirty[inode] = TRUE;
+    }
+
+    OpenFiles[fd].inode = inode;
+    OpenFiles[fd].position = (flags & DISK_FILE_APPEND) ? FileInodes[inode].size : 0;
+    OpenFiles[fd].pid = getpid();
+
+    // A new file is written out right away
+    if (FileInodeDirty[inode])
+    {
+        writeFileTable(inode, FALSE);
+    }
+    returnMutex(fileStoreMutex);
+    return fd;
+}
+
+/*
+ *  System call for user function FileRead. Serves as a bridge between FileRead
+ *  and fileReadReal
+ */
+void fileRead(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileRead(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_FILEREAD)
+    {
+        USLOSS_Console("fileRead(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int fd = (int) ((long) args->arg1);
+    void *buffer = args->arg2;
+    int bytes = (int) ((long) args->arg3);
+
+    int result = fileReadReal(fd, buffer, bytes);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg2 = (void*) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg2 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Reads up to bytes bytes from the file position of an open file into buffer,
+ *  and moves the position past them.
+ *  Return values:
+ *    -1: invalid parameters or a disk error
+ *    >=0: the number of bytes read, which is 0 at the end of the file
+ */
+int fileReadReal(int fd, void *buffer, int bytes)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileReadReal(): called.\n");
+    }
+
+    openFile *file = getOpenFile(fd);
+    if (file == NULL || buffer == NULL || bytes < 0)
+    {
+        return -1;
+    }
+
+    // Don't read past the end of the file
+    getMutex(FileInodeMutex[file->inode]);
+    getMutex(fileStoreMutex);
+    int size = FileInodes[file->inode].size;
+    returnMutex(fileStoreMutex);
+    if (bytes > size - file->position)
+    {
+        bytes = size - file->position > 0 ? size - file->position : 0;
+    }
+
+    int status = fileTransfer(file, DISK_READ, buffer, bytes);
+    returnMutex(FileInodeMutex[file->inode]);
+    if (status != 0)
+    {
+        return -1;
+    }
+    file->position += bytes;
+    return bytes;
+}
+
+/*
+ *  System call for user function FileWrite. Serves as a bridge between
+ *  FileWrite and fileWriteReal
+ */
+void fileWrite(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileWrite(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_FILEWRITE)
+    {
+        USLOSS_Console("fileWrite(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int fd = (int) ((long) args->arg1);
+    void *buffer = args->arg2;
+    int bytes = (int) ((long) args->arg3);
+
+    int result = fileWriteReal(fd, buffer, bytes);
+
+    if(result == -1)
+    {
+        args->arg4 = (void*) -1;
+        args->arg2 = (void*) 0;
+    }
+    else
+    {
+        args->arg4 = (void *) 0;
+        args->arg2 = (void*) ((long) result);
+    }
+
+    setToUserMode();
+}
+
+/*
+ *  Writes bytes bytes from buffer at the file position of an open file, growing
+ *  the file if needed, and moves the position past them.
+ *  Return values:
+ *    -1: invalid parameters or a disk error
+ *    >=0: the number of bytes written, which is less than bytes if the disk
+ *         or the file's extent list is full
+ */
+int fileWriteReal(int fd, void *buffer, int bytes)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileWriteReal(): called.\n");
+    }
+
+    openFile *file = getOpenFile(fd);
+    if (file == NULL || buffer == NULL || bytes < 0)
+    {
+        return -1;
+    }
+
+    // Make sure the file has sectors for all of it, or as much as will fit
+    getMutex(FileInodeMutex[file->inode]);
+    getMutex(fileStoreMutex);
+    fileInode *inode = &FileInodes[file->inode];
+    int end = file->position + bytes;
+    int needed = (end + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+    if (growFile(inode, needed) == TRUE)
+    {
+        FileInodeDirty[file->inode] = TRUE;
+    }
+    int available = allocatedSectors(inode) * USLOSS_DISK_SECTOR_SIZE - file->position;
+    returnMutex(fileStoreMutex);
+    if (bytes > available)
+    {
+        bytes = available > 0 ? available : 0;
+    }
+
+    if (fileTransfer(file, DISK_WRITE, buffer, bytes) != 0)
+    {
+        returnMutex(FileInodeMutex[file->inode]);
+        return -1;
+    }
+    file->position += bytes;
+
+    getMutex(fileStoreMutex);
+    if (file->position > inode->size)
+    {
+        inode->size = file->position;
+        FileInodeDirty[file->inode] = TRUE;
+    }
+    returnMutex(fileStoreMutex);
+    returnMutex(FileInodeMutex[file->inode]);
+    return bytes;
+}
+
+/*
+ *  System call for user function FileClose. Serves as a bridge between
+ *  FileClose and fileCloseReal
+ */
+void fileClose(systemArgs *args)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileClose(): called.\n");
+    }
+
+    initProc();
+
+    // Check the syscall number
+    if (args->number != SYS_FILECLOSE)
+    {
+        USLOSS_Console("fileClose(): Called with wrong syscall number.\n");
+        USLOSS_Halt(1);
+    }
+
+    int fd = (int) ((long) args->arg1);
+    int result = fileCloseReal(fd);
+    args->arg4 = (void *) ((long) result);
+
+    setToUserMode();
+}
+
+/*
+ *  Closes an open file, writing its inode back if it changed.
+ *  Return values:
+ *    -1: fd is not a file this process has open
+ *     0: the file was closed
+ */
+int fileCloseReal(int fd)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("fileCloseReal(): called.\n");
+    }
+
+    openFile *file = getOpenFile(fd);
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    getMutex(fileStoreMutex);
+    if (FileInodeDirty[file->inode])
+    {
+        writeFileTable(file->inode, FALSE);
+    }
+    file->inode = EMPTY;
+    file->pid = EMPTY;
+    returnMutex(fileStoreMutex);
+    return 0;
+}
+
+/*
+ *  Returns the inode with the given name, or EMPTY if there is none. An empty
+ *  name finds a free inode.
+ */
+static int findInode(char *name)
+{
+    for (int i = 0; i < DISK_FILE_MAX_FILES; i++)
+    {
+        if (strncmp(FileInodes[i].name, name, DISK_FILE_NAME_LENGTH) == 0)
+        {
+            return i;
+        }
+    }
+    return EMPTY;
+}
+
+/*
+ *  Returns TRUE if a descriptor has the given inode open. Called with
+ *  fileStoreMutex held.
+ */
+static int inodeOpen(int inode)
+{
+    for (int i = 0; i < DISK_FILE_MAX_OPEN; i++)
+    {
+        if (OpenFiles[i].inode == inode)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Returns the open file for fd if the current process opened it, or NULL
+ */
+static openFile *getOpenFile(int fd)
+{
+    if (fd < 0 || fd >= DISK_FILE_MAX_OPEN || OpenFiles[fd].inode == EMPTY ||
+        OpenFiles[fd].pid != getpid())
+    {
+        return NULL;
+    }
+    return &OpenFiles[fd];
+}
+
+/*
+ *  Returns the disk sector holding sector fileSector of a file, and sets *run
+ *  to the number of sectors of the file that follow it contiguously on disk,
+ *  counting itself. Returns EMPTY if the file doesn't have that sector.
+ */
+static int fileSectorToDisk(fileInode *inode, int fileSector, int *run)
+{
+    for (int e = 0; e < inode->numExtents; e++)
+    {
+        if (fileSector < inode->extents[e].length)
+        {
+            *run = inode->extents[e].length - fileSector;
+            return inode->extents[e].start + fileSector;
+        }
+        fileSector -= inode->extents[e].length;
+    }
+    return EMPTY;
+}
+
+/*
+ *  Returns the number of sectors allocated to a file
+ */
+static int allocatedSectors(fileInode *inode)
+{
+    int sectors = 0;
+    for (int e = 0; e < inode->numExtents; e++)
+    {
+        sectors += inode->extents[e].length;
+    }
+    return sectors;
+}
+
+/*
+ *  Gives a file at least the given number of sectors if there is room, a
+ *  track at a time. The last extent is grown in place if the sectors after it
+ *  are free; otherwise a new extent is started as close to it as possible.
+ *  Called with fileStoreMutex held. Returns TRUE if the file grew.
+ */
+static int growFile(fileInode *inode, int sectors)
+{
+    int grew = FALSE;
+    int have = allocatedSectors(inode);
+    while (have < sectors)
+    {
+        int want = sectors - have;
+        if (want < DISK_FILE_EXTENT_MIN)
+        {
+            want = DISK_FILE_EXTENT_MIN;
+        }
+
+        // Grow the last extent in place
+        if (inode->numExtents > 0)
+        {
+            fileExtent *last = &inode->extents[inode->numExtents - 1];
+            int added = 0;
+            while (added < want && last->start + last->length < FileStoreSectors &&
+                   !FileSectorUsed[last->start + last->length])
+            {
+                FileSectorUsed[last->start + last->length] = TRUE;
+                last->length++;
+                added++;
+            }
+            if (added > 0)
+            {
+                have += added;
+                grew = TRUE;
+                continue;
+            }
+        }
+        if (inode->numExtents == DISK_FILE_EXTENTS)
+        {
+            break;
+        }
+
+        // Start a new extent near the end of the last one
+        int hint = DISK_FILE_DATA_START;
+        if (inode->numExtents > 0)
+        {
+            fileExtent *last = &inode->extents[inode->numExtents - 1];
+            hint = last->start + last->length;
+        }
+        int length;
+        int start = findFreeRun(hint, want, &length);
+        if (start == EMPTY)
+        {
+            break;
+        }
+        for (int s = start; s < start + length; s++)
+        {
+            FileSectorUsed[s] = TRUE;
+        }
+        inode->extents[inode->numExtents].start = start;
+        inode->extents[inode->numExtents].length = length;
+        inode->numExtents++;
+        have += length;
+        grew = TRUE;
+    }
+    return grew;
+}
+
+/*
+ *  Finds free sectors for a new extent of want sectors. Runs long enough are
+ *  preferred, and among those the one starting closest to hint. If no run is
+ *  long enough the longest one is used. Returns the start and sets *length,
+ *  or returns EMPTY if the disk is full.
+ */
+static int findFreeRun(int hint, int want, int *length)
+{
+    int best = EMPTY;
+    int bestLength = 0;
+    int start = DISK_FILE_DATA_START;
+    while (start < FileStoreSectors)
+    {
+        if (FileSectorUsed[start])
+        {
+            start++;
+            continue;
+        }
+        int end = start;
+        while (end < FileStoreSectors && !FileSectorUsed[end])
+        {
+            end++;
+        }
+
+        // Within a long enough run, start as close to hint as it allows
+        int runLength = end - start;
+        int candidate = start;
+        if (runLength >= want && hint > start)
+        {
+            candidate = hint < end - want ? hint : end - want;
+        }
+        int fits = runLength >= want;
+        int bestFits = bestLength >= want;
+        if (best == EMPTY || (fits && !bestFits) ||
+            (fits && bestFits && abs(candidate - hint) < abs(best - hint)) ||
+            (!fits && !bestFits && runLength > bestLength))
+        {
+            best = candidate;
+            bestLength = end - candidate;
+        }
+        start = end;
+    }
+
+    if (best != EMPTY)
+    {
+        *length = bestLength < want ? bestLength : want;
+    }
+    return best;
+}
+
+/*
+ *  Gives back all of the sectors of a file
+ */
+static void freeFileExtents(fileInode *inode)
+{
+    for (int e = 0; e < inode->numExtents; e++)
+    {
+        for (int s = 0; s < inode->extents[e].length; s++)
+        {
+            FileSectorUsed[inode->extents[e].start + s] = FALSE;
+        }
+    }
+    inode->numExtents = 0;
+}
+
+/*
+ *  Reads or writes bytes bytes at the file position of an open file. Whole
+ *  sectors move straight between the disk and buffer, as many at a time as
+ *  lie together on disk. Sectors that are only partly covered go through a
+ *  kernel buffer. The file must already have the sectors, and the caller must
+ *  hold its inode mutex. Returns 0 or the first non-zero disk status.
+ */
+static int fileTransfer(openFile *file, int op, void *buffer, int bytes)
+{
+    fileInode *inode = &FileInodes[file->inode];
+    char *partial = FileSectorBuffers[getpid() % MAXPROC];
+    int position = file->position;
+    int done = 0;
+    while (done < bytes)
+    {
+        int run;
+        int offset = position % USLOSS_DISK_SECTOR_SIZE;
+        int sector = fileSectorToDisk(inode, position / USLOSS_DISK_SECTOR_SIZE, &run);
+        if (sector == EMPTY)
+        {
+            return USLOSS_DEV_ERROR;
+        }
+
+        int status;
+        int count;
+        if (offset != 0 || bytes - done < USLOSS_DISK_SECTOR_SIZE)
+        {
+            // Part of one sector
+            count = USLOSS_DISK_SECTOR_SIZE - offset;
+            if (count > bytes - done)
+            {
+                count = bytes - done;
+            }
+            status = diskTransfer(DISK_READ, partial, sector, 1);
+            if (status == 0 && op == DISK_READ)
+            {
+                memcpy(buffer + done, partial + offset, count);
+            }
+            else if (status == 0)
+            {
+                memcpy(partial + offset, buffer + done, count);
+                status = diskTransfer(DISK_WRITE, partial, sector, 1);
+            }
+        }
+        else
+        {
+            // Whole sectors
+            int sectors = (bytes - done) / USLOSS_DISK_SECTOR_SIZE;
+            if (sectors > run)
+            {
+                sectors = run;
+            }
+            if (sectors > DISK_FILE_CHUNK)
+            {
+                sectors = DISK_FILE_CHUNK;
+            }
+            count = sectors * USLOSS_DISK_SECTOR_SIZE;
+            status = diskTransfer(op, buffer + done, sector, sectors);
+        }
+        if (status != 0)
+        {
+            return status;
+        }
+        done += count;
+        position += count;
+    }
+    return 0;
+}
+
+/*
+ *  Reads or writes sectors of the store's unit starting at the given sector,
+ *  counted from track 0 sector 0
+ */
+static int diskTransfer(int op, void *buffer, int sector, int sectors)
+{
+    int track = sector / USLOSS_DISK_TRACK_SIZE;
+    int first = sector % USLOSS_DISK_TRACK_SIZE;
+    if (op == DISK_READ)
+    {
+        return diskReadReal(buffer, sectors, track, first, diskFileStoreUnit);
+    }
+    return diskWriteReal(buffer, sectors, track, first, diskFileStoreUnit);
+}
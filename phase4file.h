@@ -0,0 +1,76 @@
+#ifndef _PHASE4FILE_H
+#define _PHASE4FILE_H
+
+#include "devices.h"
+
+// Number of files the store holds, files open at once, and extents per file
+#define DISK_FILE_MAX_FILES     64
+#define DISK_FILE_MAX_OPEN      32
+#define DISK_FILE_EXTENTS       6
+
+// Largest unit, in tracks, the store can use
+#define DISK_FILE_MAX_TRACKS    256
+#define DISK_FILE_MAX_SECTORS   (DISK_FILE_MAX_TRACKS * USLOSS_DISK_TRACK_SIZE)
+
+// Files grow a track at a time, so that their extents stay long
+#define DISK_FILE_EXTENT_MIN    USLOSS_DISK_TRACK_SIZE
+
+// Most sectors moved by one diskReadReal or diskWriteReal call
+#define DISK_FILE_CHUNK         (USLOSS_DISK_TRACK_SIZE - 1)
+
+#define DISK_FILE_MAGIC         0x46535421
+
+// Track 0 holds the superblock in sector 0 followed by the inode table. File
+// data starts at track 1.
+#define DISK_FILE_INODES_PER_SECTOR (USLOSS_DISK_SECTOR_SIZE / (int) sizeof(fileInode))
+#define DISK_FILE_TABLE_SECTORS \
+    ((DISK_FILE_MAX_FILES + DISK_FILE_INODES_PER_SECTOR - 1) / DISK_FILE_INODES_PER_SECTOR)
+#define DISK_FILE_DATA_START    USLOSS_DISK_TRACK_SIZE
+
+// A run of contiguous sectors, counted from track 0 sector 0
+typedef struct fileExtent
+{
+    int start;
+    int length;
+} fileExtent;
+
+// A file. An inode whose name is empty is free.
+typedef struct fileInode
+{
+    char name[DISK_FILE_NAME_LENGTH];
+    int size;
+    int numExtents;
+    fileExtent extents[DISK_FILE_EXTENTS];
+} fileInode;
+
+// An open file. inode is EMPTY if the entry is free.
+typedef struct openFile
+{
+    int inode;
+    int position;
+    int pid;
+} openFile;
+
+typedef struct fileSuperblock
+{
+    int magic;
+    int maxFiles;
+    int tableSectors;
+} fileSuperblock;
+
+extern int diskFileStoreUnit;
+
+extern void initFileStore();
+extern void flushFileStore();
+
+extern void fileOpen(systemArgs *);
+extern void fileRead(systemArgs *);
+extern void fileWrite(systemArgs *);
+extern void fileClose(systemArgs *);
+
+extern int fileOpenReal(char *, int);
+extern int fileReadReal(int, void *, int);
+extern int fileWriteReal(int, void *, int);
+extern int fileCloseReal(int);
+
+#endif
@@ -0,0 +1,748 @@
+/*
+ *  File: phase4log.c
+ *  Purpose: This file holds functions and global variables for the optional
+ *  log-structured mode of a disk unit. Writes to a unit in this mode are not sent
+ *  to the sectors they name. Instead they are appended at the head of a log, and
+ *  a map from logical to physical sectors sends reads to wherever a sector was
+ *  last written. Each track of the unit is one log segment. A cleaner process
+ *  moves the live sectors out of mostly dead segments so the log can reuse them.
+ *
+ *  The map is checkpointed to the last DISK_LOG_CHECKPOINT_TRACKS tracks of the
+ *  unit when start3 shuts down, and loaded again when the driver starts.
+ *  Once the driver has started, the checkpoint is marked stale on the disk. If
+ *  the system stops without a clean shutdown, the next boot finds the stale
+ *  mark instead of a map that no longer matches what the log has moved, and
+ *  erases the unit rather than serve whatever now sits at the old sectors. Only
+ *  DiskRead and DiskWrite go through the map. DiskCopy, DiskFill,
+ *  DiskSubmitBatch and the RAID units name physical sectors, so they refuse a
+ *  unit in this mode.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4raid.h"
+#include "phase4log.h"
+
+extern int debugflag4;
+extern int DiskSizes[USLOSS_DISK_UNITS];
+
+// Header of the checkpointed map
+typedef struct logCheckpointHeader
+{
+    int magic;
+    int logicalTracks;
+    int segments;
+} logCheckpointHeader;
+
+// Set before start3 runs to put a unit in log-structured mode
+int diskLogStructured[USLOSS_DISK_UNITS];
+
+// Mutex for the log state of each unit, a semaphore writers wait on for free
+// space, and a semaphore that wakes the unit's cleaner
+int logMutex[USLOSS_DISK_UNITS];
+semaphore logSpaceSem[USLOSS_DISK_UNITS];
+semaphore logCleanSem[USLOSS_DISK_UNITS];
+
+// Number of logical tracks and of log segments (physical tracks) in each unit
+static int LogTracks[USLOSS_DISK_UNITS];
+static int LogSegments[USLOSS_DISK_UNITS];
+
+// LogMap maps each logical sector to the physical sector that holds it.
+// LogOwner maps each physical sector to the logical sector it holds, EMPTY if it
+// is dead, or LOG_PENDING while a write to it is in flight.
+static int LogMap[USLOSS_DISK_UNITS][DISK_LOG_MAX_SECTORS];
+static int LogOwner[USLOSS_DISK_UNITS][DISK_LOG_MAX_SECTORS];
+
+// State of each segment, the number of its sectors that are live or pending,
+// and the number that are pending
+static int LogSegmentState[USLOSS_DISK_UNITS][DISK_LOG_MAX_TRACKS];
+static int LogSegmentLive[USLOSS_DISK_UNITS][DISK_LOG_MAX_TRACKS];
+static int LogSegmentPending[USLOSS_DISK_UNITS][DISK_LOG_MAX_TRACKS];
+
+// The next physical sector the log writes, or EMPTY when the head segment is
+// full, and the segment the head is in or was last in
+static int LogHead[USLOSS_DISK_UNITS];
+static int LogHeadSegment[USLOSS_DISK_UNITS];
+
+static int LogFreeSegments[USLOSS_DISK_UNITS];
+static int LogActiveReads[USLOSS_DISK_UNITS];
+static int LogSpaceWaiters[USLOSS_DISK_UNITS];
+static int LogCleanerWoken[USLOSS_DISK_UNITS];
+
+// Buffers for the cleaner and for the checkpoint
+static char LogCleanBuffer[USLOSS_DISK_UNITS][USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+static char LogCheckpointBuffer[USLOSS_DISK_UNITS][(1 + DISK_LOG_MAP_SECTORS) * USLOSS_DISK_SECTOR_SIZE];
+
+static int rebuildLog(int);
+static int loadLogCheckpoint(int);
+static void markLogCheckpointStale(int);
+static void eraseLog(int);
+static int logMapSectors(int);
+static int logFreeSectors(int);
+static void collectReclaimedSegments(int);
+static int allocLogSector(int);
+static void releaseLogSector(int, int);
+static void commitLogSector(int, int, int);
+static void discardLogSector(int, int);
+static void waitForLogSpace(int, int);
+static void wakeLogCleaner(int);
+static void wakeLogSpaceWaiters(int);
+static int pickLogVictim(int);
+
+/*
+ *  Sets up the log of a unit. Called by the unit's driver once the size of the
+ *  disk is known, before the driver starts taking requests.
+ */
+void initLog(int unit)
+{
+    logMutex[unit] = MboxCreate(1, 0);
+    returnMutex(logMutex[unit]);
+    logSpaceSem[unit] = semcreateReal(0);
+    logCleanSem[unit] = semcreateReal(0);
+
+    // Keep enough segments free for the log head and for the cleaner to work
+    int segments = DiskSizes[unit] - DISK_LOG_CHECKPOINT_TRACKS;
+    int spare = segments / DISK_LOG_RESERVE;
+    if (spare < 2)
+    {
+        spare = 2;
+    }
+    if (DiskSizes[unit] > DISK_LOG_MAX_TRACKS || segments <= spare)
+    {
+        USLOSS_Console("initLog(%d): A disk of %d tracks can't be log structured.\n",
+                       unit, DiskSizes[unit]);
+        diskLogStructured[unit] = FALSE;
+        return;
+    }
+    LogSegments[unit] = segments;
+    LogTracks[unit] = segments - spare;
+    LogActiveReads[unit] = 0;
+    LogSpaceWaiters[unit] = 0;
+    LogCleanerWoken[unit] = FALSE;
+
+    // Pick up the map from the last run, or start with every logical sector
+    // stored at the physical sector of the same number
+    if (loadLogCheckpoint(unit) == -1 || rebuildLog(unit) == -1)
+    {
+        for (int i = 0; i < LogTracks[unit] * USLOSS_DISK_TRACK_SIZE; i++)
+        {
+            LogMap[unit][i] = i;
+        }
+        rebuildLog(unit);
+    }
+    markLogCheckpointStale(unit);
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("initLog(%d): %d logical tracks, %d segments, %d free.\n",
+                       unit, LogTracks[unit], LogSegments[unit], LogFreeSegments[unit]);
+    }
+}
+
+/*
+ *  Works out the owners and segment counts of a unit from LogMap. Returns -1 if
+ *  the map is not valid and 0 otherwise.
+ */
+static int rebuildLog(int unit)
+{
+    int physicalSectors = LogSegments[unit] * USLOSS_DISK_TRACK_SIZE;
+    for (int p = 0; p < physicalSectors; p++)
+    {
+        LogOwner[unit][p] = EMPTY;
+    }
+    for (int seg = 0; seg < LogSegments[unit]; seg++)
+    {
+        LogSegmentLive[unit][seg] = 0;
+        LogSegmentPending[unit][seg] = 0;
+    }
+
+    for (int logical = 0; logical < LogTracks[unit] * USLOSS_DISK_TRACK_SIZE; logical++)
+    {
+        int p = LogMap[unit][logical];
+        if (p < 0 || p >= physicalSectors || LogOwner[unit][p] != EMPTY)
+        {
+            return -1;
+        }
+        LogOwner[unit][p] = logical;
+        LogSegmentLive[unit][p / USLOSS_DISK_TRACK_SIZE]++;
+    }
+
+    LogFreeSegments[unit] = 0;
+    for (int seg = 0; seg < LogSegments[unit]; seg++)
+    {
+        if (LogSegmentLive[unit][seg] == 0)
+        {
+            LogSegmentState[unit][seg] = LOG_SEG_FREE;
+            LogFreeSegments[unit]++;
+        }
+        else
+        {
+            LogSegmentState[unit][seg] = LOG_SEG_USED;
+        }
+    }
+    LogHead[unit] = EMPTY;
+    LogHeadSegment[unit] = LogSegments[unit] - 1;
+    return 0;
+}
+
+/*
+ *  Reads the checkpointed map of a unit into LogMap. A stale checkpoint means
+ *  the map of the last run was lost, and the unit is erased. This runs in the driver before it takes requests, so it does the disk
+ *  operations itself. Returns -1 if there is no usable checkpoint and 0
+ *  otherwise.
+ */
+static int loadLogCheckpoint(int unit)
+{
+    diskRequest request;
+    clearRequest(&request);
+    request.op = DISK_READ;
+    request.memAddress = LogCheckpointBuffer[unit];
+    request.numSectors = 1 + logMapSectors(unit);
+    request.startTrack = LogSegments[unit];
+    request.startSector = 0;
+    request.unit = unit;
+    performDiskOp(&request);
+    if (request.resultStatus != 0)
+    {
+        return -1;
+    }
+
+    logCheckpointHeader *header = (logCheckpointHeader *) LogCheckpointBuffer[unit];
+    if (header->logicalTracks != LogTracks[unit] || header->segments != LogSegments[unit])
+    {
+        return -1;
+    }
+    if (header->magic == DISK_LOG_STALE_MAGIC)
+    {
+        USLOSS_Console("initLog(%d): The log was not shut down cleanly; erasing the unit.\n",
+                       unit);
+        eraseLog(unit);
+        return -1;
+    }
+    if (header->magic != DISK_LOG_MAGIC)
+    {
+        return -1;
+    }
+
+    short *map = (short *) (LogCheckpointBuffer[unit] + USLOSS_DISK_SECTOR_SIZE);
+    for (int i = 0; i < LogTracks[unit] * USLOSS_DISK_TRACK_SIZE; i++)
+    {
+        LogMap[unit][i] = map[i];
+    }
+    return 0;
+}
+
+/*
+ *  Marks the checkpoint of a unit stale. Writes from now on leave any map on
+ *  the disk behind, so until checkpointLog writes a new one the next boot must
+ *  not trust it. Runs in the driver before it takes requests.
+ */
+static void markLogCheckpointStale(int unit)
+{
+    memset(LogCheckpointBuffer[unit], 0, USLOSS_DISK_SECTOR_SIZE);
+    logCheckpointHeader *header = (logCheckpointHeader *) LogCheckpointBuffer[unit];
+    header->magic = DISK_LOG_STALE_MAGIC;
+    header->logicalTracks = LogTracks[unit];
+    header->segments = LogSegments[unit];
+
+    diskRequest request;
+    clearRequest(&request);
+    request.op = DISK_WRITE;
+    request.memAddress = LogCheckpointBuffer[unit];
+    request.numSectors = 1;
+    request.startTrack = LogSegments[unit];
+    request.startSector = 0;
+    request.unit = unit;
+    performDiskOp(&request);
+    if (request.resultStatus != 0)
+    {
+        USLOSS_Console("initLog(%d): Could not mark the checkpoint stale.\n", unit);
+    }
+}
+
+/*
+ *  Zeros every segment of a unit, so that reads through the new map find zeros
+ *  rather than old log contents
+ */
+static void eraseLog(int unit)
+{
+    diskRequest request;
+    int half = USLOSS_DISK_TRACK_SIZE / 2;
+    memset(LogCleanBuffer[unit], 0, sizeof(LogCleanBuffer[unit]));
+    for (int track = 0; track < LogSegments[unit]; track++)
+    {
+        for (int first = 0; first < USLOSS_DISK_TRACK_SIZE; first += half)
+        {
+            clearRequest(&request);
+            request.op = DISK_WRITE;
+            request.memAddress = LogCleanBuffer[unit];
+            request.numSectors = half;
+            request.startTrack = track;
+            request.startSector = first;
+            request.unit = unit;
+            performDiskOp(&request);
+        }
+    }
+}
+
+/*
+ *  Writes the map of a unit to its checkpoint tracks. Called by start3 at
+ *  shutdown, after the unit's cleaner has quit.
+ */
+void checkpointLog(int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("checkpointLog(%d): called.\n", unit);
+    }
+
+    initProc();
+    processPtr proc = getCurrentProc();
+
+    getMutex(logMutex[unit]);
+    memset(LogCheckpointBuffer[unit], 0, sizeof(LogCheckpointBuffer[unit]));
+    logCheckpointHeader *header = (logCheckpointHeader *) LogCheckpointBuffer[unit];
+    header->magic = DISK_LOG_MAGIC;
+    header->logicalTracks = LogTracks[unit];
+    header->segments = LogSegments[unit];
+    short *map = (short *) (LogCheckpointBuffer[unit] + USLOSS_DISK_SECTOR_SIZE);
+    for (int i = 0; i < LogTracks[unit] * USLOSS_DISK_TRACK_SIZE; i++)
+    {
+        map[i] = LogMap[unit][i];
+    }
+    returnMutex(logMutex[unit]);
+
+    initDiskRequest(&proc->diskRequests[0], DISK_WRITE, LogCheckpointBuffer[unit],
+                    1 + logMapSectors(unit), LogSegments[unit], 0, unit);
+    proc->numDiskRequests = 1;
+    if (runDiskRequests(proc) != 0)
+    {
+        USLOSS_Console("checkpointLog(%d): Could not write the checkpoint.\n", unit);
+    }
+    clearProc(proc);
+}
+
+/*
+ *  Returns the number of sectors the checkpointed map of a unit takes up
+ */
+static int logMapSectors(int unit)
+{
+    int bytes = LogTracks[unit] * USLOSS_DISK_TRACK_SIZE * (int) sizeof(short);
+    return (bytes + USLOSS_DISK_SECTOR_SIZE - 1) / USLOSS_DISK_SECTOR_SIZE;
+}
+
+/*
+ *  Returns the number of logical tracks of a log-structured unit
+ */
+int logTracks(int unit)
+{
+    return LogTracks[unit];
+}
+
+/*
+ *  Reads sectors of a log-structured unit. Each logical sector is read from
+ *  wherever the map says it is, with one request per run of physically
+ *  contiguous sectors.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were read successfully >0: disk's status register
+ */
+int logReadReal(int unit, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("logReadReal(): called.\n");
+    }
+
+    if (checkRaidArgs("logReadReal", numSectors, startTrack, startSector, LogTracks[unit],
+                      DISK_REQUEST_SECTORS) == -1)
+    {
+        return -1;
+    }
+
+    int first = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    processPtr proc = getCurrentProc();
+
+    // Look up where the sectors are. Segments freed while the read is in
+    // flight are not reused until it finishes.
+    getMutex(logMutex[unit]);
+    int last = 0;
+    for (int i = 0; i < numSectors; i++)
+    {
+        int p = LogMap[unit][first + i];
+        addSectorRequest(proc, DISK_READ, unit, memAddress + i * USLOSS_DISK_SECTOR_SIZE,
+                      p, i > 0 && p == last + 1);
+        last = p;
+    }
+    LogActiveReads[unit]++;
+    returnMutex(logMutex[unit]);
+
+    int status = runDiskRequests(proc);
+
+    getMutex(logMutex[unit]);
+    LogActiveReads[unit]--;
+    wakeLogSpaceWaiters(unit);
+    returnMutex(logMutex[unit]);
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Writes sectors of a log-structured unit. The sectors are written at the log
+ *  head, and the map is pointed at them once the write has finished.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were written successfully >0: disk's status register
+ */
+int logWriteReal(int unit, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("logWriteReal(): called.\n");
+    }
+
+    if (checkRaidArgs("logWriteReal", numSectors, startTrack, startSector, LogTracks[unit],
+                      DISK_REQUEST_SECTORS) == -1)
+    {
+        return -1;
+    }
+
+    int first = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    int physical[USLOSS_DISK_TRACK_SIZE];
+    processPtr proc = getCurrentProc();
+
+    // Take space at the head, leaving a segment for the cleaner
+    getMutex(logMutex[unit]);
+    waitForLogSpace(unit, numSectors + USLOSS_DISK_TRACK_SIZE);
+    for (int i = 0; i < numSectors; i++)
+    {
+        physical[i] = allocLogSector(unit);
+        addSectorRequest(proc, DISK_WRITE, unit, memAddress + i * USLOSS_DISK_SECTOR_SIZE,
+                      physical[i], i > 0 && physical[i] == physical[i - 1] + 1);
+    }
+    returnMutex(logMutex[unit]);
+
+    int status = runDiskRequests(proc);
+
+    // Point the map at the new copies, or give the space back if the write failed
+    getMutex(logMutex[unit]);
+    for (int i = 0; i < numSectors; i++)
+    {
+        if (status == 0)
+        {
+            commitLogSector(unit, first + i, physical[i]);
+        }
+        else
+        {
+            discardLogSector(unit, physical[i]);
+        }
+    }
+    wakeLogSpaceWaiters(unit);
+    returnMutex(logMutex[unit]);
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Moves the live sectors of one segment to the log head so the segment can be
+ *  reused. Runs in the cleaner process. Returns 0 if a segment was cleaned and
+ *  -1 if there was nothing the cleaner could do.
+ */
+int cleanLogSegment(int unit)
+{
+    processPtr proc = getCurrentProc();
+    int logical[USLOSS_DISK_TRACK_SIZE];
+    int physical[USLOSS_DISK_TRACK_SIZE];
+
+    // Pick the segment with the fewest live sectors
+    getMutex(logMutex[unit]);
+    collectReclaimedSegments(unit);
+    int victim = pickLogVictim(unit);
+    if (victim == EMPTY || logFreeSectors(unit) < LogSegmentLive[unit][victim])
+    {
+        returnMutex(logMutex[unit]);
+        return -1;
+    }
+    int ioClass = LogSpaceWaiters[unit] > 0 ? DISK_IOCLASS_BE : DISK_IOCLASS_IDLE;
+    int base = victim * USLOSS_DISK_TRACK_SIZE;
+    for (int s = 0; s < USLOSS_DISK_TRACK_SIZE; s++)
+    {
+        logical[s] = LogOwner[unit][base + s];
+    }
+
+    // Writers may kill the rest of the victim meanwhile. Counting the cleaner
+    // as a reader keeps the segment from being reused until the map has been
+    // moved over, so LogMap still pointing into it means the copy is current.
+    LogActiveReads[unit]++;
+    returnMutex(logMutex[unit]);
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("cleanLogSegment(%d): cleaning segment %d.\n", unit, victim);
+    }
+
+    // Read the whole segment
+    initDiskRequest(&proc->diskRequests[0], DISK_READ, LogCleanBuffer[unit],
+                    USLOSS_DISK_TRACK_SIZE, victim, 0, unit);
+    proc->diskRequests[0].ioClass = ioClass;
+    proc->numDiskRequests = 1;
+    int status = runDiskRequests(proc);
+    clearProcRequest(proc);
+    if (status != 0)
+    {
+        getMutex(logMutex[unit]);
+        LogActiveReads[unit]--;
+        wakeLogSpaceWaiters(unit);
+        returnMutex(logMutex[unit]);
+        return -1;
+    }
+
+    // Write out the sectors that are still live. Any that were overwritten
+    // while the segment was read are skipped.
+    getMutex(logMutex[unit]);
+    int last = EMPTY;
+    for (int s = 0; s < USLOSS_DISK_TRACK_SIZE; s++)
+    {
+        physical[s] = EMPTY;
+        if (logical[s] < 0 || LogOwner[unit][base + s] != logical[s])
+        {
+            last = EMPTY;
+            continue;
+        }
+        physical[s] = allocLogSector(unit);
+        addSectorRequest(proc, DISK_WRITE, unit, LogCleanBuffer[unit] + s * USLOSS_DISK_SECTOR_SIZE,
+                      physical[s], last != EMPTY && physical[s] == last + 1);
+        proc->diskRequests[proc->numDiskRequests - 1].ioClass = ioClass;
+        last = physical[s];
+    }
+    returnMutex(logMutex[unit]);
+
+    status = runDiskRequests(proc);
+
+    // Move the map over, unless a writer got to a sector first
+    getMutex(logMutex[unit]);
+    for (int s = 0; s < USLOSS_DISK_TRACK_SIZE; s++)
+    {
+        if (physical[s] == EMPTY)
+        {
+            continue;
+        }
+        if (status == 0 && LogMap[unit][logical[s]] == base + s)
+        {
+            commitLogSector(unit, logical[s], physical[s]);
+        }
+        else
+        {
+            discardLogSector(unit, physical[s]);
+        }
+    }
+    LogActiveReads[unit]--;
+    wakeLogSpaceWaiters(unit);
+    returnMutex(logMutex[unit]);
+
+    clearProcRequest(proc);
+    return status == 0 ? 0 : -1;
+}
+
+/*
+ *  Returns TRUE if the cleaner of a unit has work to do: free segments are low
+ *  or writers are waiting for space. Once the cleaner has checked, writers may
+ *  wake it again.
+ */
+int logNeedsCleaning(int unit)
+{
+    getMutex(logMutex[unit]);
+    LogCleanerWoken[unit] = FALSE;
+    collectReclaimedSegments(unit);
+    int result = LogFreeSegments[unit] < DISK_LOG_CLEAN_THRESHOLD || LogSpaceWaiters[unit] > 0;
+    returnMutex(logMutex[unit]);
+    return result;
+}
+
+/*
+ *  Returns the number of sectors that can be written before the log runs out
+ *  of free segments
+ */
+static int logFreeSectors(int unit)
+{
+    int free = LogFreeSegments[unit] * USLOSS_DISK_TRACK_SIZE;
+    if (LogHead[unit] != EMPTY)
+    {
+        free += USLOSS_DISK_TRACK_SIZE - LogHead[unit] % USLOSS_DISK_TRACK_SIZE;
+    }
+    return free;
+}
+
+/*
+ *  Frees the segments that have emptied, once no read could still be using
+ *  them
+ */
+static void collectReclaimedSegments(int unit)
+{
+    if (LogActiveReads[unit] != 0)
+    {
+        return;
+    }
+    for (int seg = 0; seg < LogSegments[unit]; seg++)
+    {
+        if (LogSegmentState[unit][seg] == LOG_SEG_RECLAIMED)
+        {
+            LogSegmentState[unit][seg] = LOG_SEG_FREE;
+            LogFreeSegments[unit]++;
+        }
+    }
+}
+
+/*
+ *  Takes the next sector at the log head, moving the head to the next free
+ *  segment if it has to. The caller must have made sure there is space.
+ */
+static int allocLogSector(int unit)
+{
+    if (LogHead[unit] == EMPTY)
+    {
+        int seg = LogHeadSegment[unit];
+        do
+        {
+            seg = (seg + 1) % LogSegments[unit];
+        } while (LogSegmentState[unit][seg] != LOG_SEG_FREE);
+
+        LogSegmentState[unit][seg] = LOG_SEG_USED;
+        LogFreeSegments[unit]--;
+        LogHeadSegment[unit] = seg;
+        LogHead[unit] = seg * USLOSS_DISK_TRACK_SIZE;
+    }
+
+    int p = LogHead[unit]++;
+    if (LogHead[unit] % USLOSS_DISK_TRACK_SIZE == 0)
+    {
+        LogHead[unit] = EMPTY;
+    }
+
+    int seg = p / USLOSS_DISK_TRACK_SIZE;
+    LogOwner[unit][p] = LOG_PENDING;
+    LogSegmentLive[unit][seg]++;
+    LogSegmentPending[unit][seg]++;
+    return p;
+}
+
+/*
+ *  Marks a physical sector dead. A segment left with no live sectors is
+ *  reclaimed, unless the log head is still in it.
+ */
+static void releaseLogSector(int unit, int p)
+{
+    int seg = p / USLOSS_DISK_TRACK_SIZE;
+    LogOwner[unit][p] = EMPTY;
+    LogSegmentLive[unit][seg]--;
+    if (LogSegmentLive[unit][seg] == 0 &&
+        !(LogHead[unit] != EMPTY && seg == LogHeadSegment[unit]))
+    {
+        LogSegmentState[unit][seg] = LOG_SEG_RECLAIMED;
+    }
+}
+
+/*
+ *  Makes the pending physical sector p the home of logical sector logical
+ */
+static void commitLogSector(int unit, int logical, int p)
+{
+    LogSegmentPending[unit][p / USLOSS_DISK_TRACK_SIZE]--;
+    releaseLogSector(unit, LogMap[unit][logical]);
+    LogMap[unit][logical] = p;
+    LogOwner[unit][p] = logical;
+}
+
+/*
+ *  Gives back a pending physical sector that will not be used
+ */
+static void discardLogSector(int unit, int p)
+{
+    LogSegmentPending[unit][p / USLOSS_DISK_TRACK_SIZE]--;
+    releaseLogSector(unit, p);
+}
+
+/*
+ *  Blocks until at least needed sectors are free, waking the cleaner while it
+ *  waits. Called and returns with the unit's log mutex held.
+ */
+static void waitForLogSpace(int unit, int needed)
+{
+    collectReclaimedSegments(unit);
+    while (logFreeSectors(unit) < needed)
+    {
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("waitForLogSpace(%d): waiting for the cleaner.\n", unit);
+        }
+        LogSpaceWaiters[unit]++;
+        wakeLogCleaner(unit);
+        returnMutex(logMutex[unit]);
+        sempReal(logSpaceSem[unit]);
+        getMutex(logMutex[unit]);
+        collectReclaimedSegments(unit);
+    }
+    if (LogFreeSegments[unit] < DISK_LOG_CLEAN_THRESHOLD)
+    {
+        wakeLogCleaner(unit);
+    }
+}
+
+/*
+ *  Wakes the cleaner of a unit, unless it has already been woken
+ */
+static void wakeLogCleaner(int unit)
+{
+    if (!LogCleanerWoken[unit])
+    {
+        LogCleanerWoken[unit] = TRUE;
+        semvReal(logCleanSem[unit]);
+    }
+}
+
+/*
+ *  Lets every writer waiting for space check again
+ */
+static void wakeLogSpaceWaiters(int unit)
+{
+    for (; LogSpaceWaiters[unit] > 0; LogSpaceWaiters[unit]--)
+    {
+        semvReal(logSpaceSem[unit]);
+    }
+}
+
+/*
+ *  Returns the in-use segment with the fewest live sectors that the cleaner
+ *  could clean, or EMPTY if there is none. The head segment and segments with
+ *  writes in flight are left alone.
+ */
+static int pickLogVictim(int unit)
+{
+    int victim = EMPTY;
+    for (int seg = 0; seg < LogSegments[unit]; seg++)
+    {
+        if (LogSegmentState[unit][seg] != LOG_SEG_USED ||
+            LogSegmentPending[unit][seg] != 0 ||
+            LogSegmentLive[unit][seg] == USLOSS_DISK_TRACK_SIZE ||
+            (LogHead[unit] != EMPTY && seg == LogHeadSegment[unit]))
+        {
+            continue;
+        }
+        if (victim == EMPTY || LogSegmentLive[unit][seg] < LogSegmentLive[unit][victim])
+        {
+            victim = seg;
+        }
+    }
+    return victim;
+}
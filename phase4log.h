@@ -0,0 +1,44 @@
+#ifndef _PHASE4LOG_H
+#define _PHASE4LOG_H
+
+#include "devices.h"
+
+// Largest unit, in tracks, that can be put in log-structured mode
+#define DISK_LOG_MAX_TRACKS     256
+#define DISK_LOG_MAX_SECTORS    (DISK_LOG_MAX_TRACKS * USLOSS_DISK_TRACK_SIZE)
+
+// One track in DISK_LOG_RESERVE is kept free for the log to move into
+#define DISK_LOG_RESERVE        4
+
+// The cleaner runs when fewer than this many segments are free
+#define DISK_LOG_CLEAN_THRESHOLD 2
+
+// The last tracks of a log-structured unit hold the checkpointed sector map
+#define DISK_LOG_CHECKPOINT_TRACKS 2
+#define DISK_LOG_MAP_SECTORS    (DISK_LOG_MAX_SECTORS * (int) sizeof(short) / USLOSS_DISK_SECTOR_SIZE)
+#define DISK_LOG_MAGIC          0x4c4f4721
+
+// Magic number the checkpoint is given once the driver starts. Only a clean
+// shutdown writes DISK_LOG_MAGIC back, so finding this one means the map of
+// the last run was lost.
+#define DISK_LOG_STALE_MAGIC    0x4c4f473f
+
+// Segment states
+#define LOG_SEG_FREE            0
+#define LOG_SEG_USED            1
+#define LOG_SEG_RECLAIMED       2   // Empty, but a read may still be using it
+
+// LogOwner value for a sector that is being written but isn't mapped yet
+#define LOG_PENDING             -2
+
+extern int diskLogStructured[USLOSS_DISK_UNITS];
+
+extern void initLog(int);
+extern int logTracks(int);
+extern int logReadReal(int, void *, int, int, int);
+extern int logWriteReal(int, void *, int, int, int);
+extern int cleanLogSegment(int);
+extern int logNeedsCleaning(int);
+extern void checkpointLog(int);
+
+#endif
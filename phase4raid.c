@@ -0,0 +1,275 @@
+/*
+ *  File: phase4raid.c
+ *  Purpose: This file holds functions and global variables that deal with the
+ *  virtual disk units built on top of the physical disks: a striped RAID 0 unit
+ *  and a mirrored RAID 1 unit
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4raid.h"
+
+extern int debugflag4;
+extern int DiskSizes[USLOSS_DISK_UNITS];
+extern int DiskHeadTrack[USLOSS_DISK_UNITS];
+extern int diskMutex[USLOSS_DISK_UNITS];
+extern DiskStatistics DiskUnitStats[USLOSS_DISK_UNITS];
+
+// Number of consecutive sectors of the RAID 0 unit stored on one physical unit
+int diskStripeSectors = DISK_STRIPE_SECTORS;
+
+/*
+ *  Checks the parameters of a read or write of at most maxSectors sectors to a
+ *  virtual unit with the given number of tracks. Returns -1 if they are
+ *  invalid and 0 otherwise. caller is used in debugging output.
+ */
+int checkRaidArgs(char *caller, int numSectors, int startTrack, int startSector, int tracks,
+                  int maxSectors)
+{
+    int first = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    if (numSectors < 0 || numSectors > maxSectors ||
+        startTrack < 0 || startSector < 0 || startSector >= USLOSS_DISK_TRACK_SIZE ||
+        first + numSectors > tracks * USLOSS_DISK_TRACK_SIZE)
+    {
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("%s(): invalid args.\n", caller);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ *  Adds requests for count sectors of a physical unit, starting at sector
+ *  block counted from track 0 sector 0, to the requests of proc after the
+ *  first numRequests, cut into pieces the driver takes. Returns the new number
+ *  of requests, or -1 if they don't fit in MAXDISKBATCH.
+ */
+int addRaidRequests(processPtr proc, int numRequests, int op, void *memAddress, int count,
+                    int block, int unit)
+{
+    for (int done = 0; done < count; done += DISK_REQUEST_SECTORS)
+    {
+        if (numRequests == MAXDISKBATCH)
+        {
+            if(DEBUG4 && debugflag4)
+            {
+                USLOSS_Console("addRaidRequests(): too many pieces.\n");
+            }
+            return -1;
+        }
+        int sectors = count - done < DISK_REQUEST_SECTORS ? count - done : DISK_REQUEST_SECTORS;
+        initDiskRequest(&proc->diskRequests[numRequests], op,
+                        memAddress + done * USLOSS_DISK_SECTOR_SIZE, sectors,
+                        (block + done) / USLOSS_DISK_TRACK_SIZE,
+                        (block + done) % USLOSS_DISK_TRACK_SIZE, unit);
+        numRequests++;
+    }
+    return numRequests;
+}
+
+/*
+ *  Returns TRUE if any physical unit is mapped. The virtual units send their
+ *  requests straight to the physical sectors, so they can't be used then.
+ */
+int raidUnitsMapped()
+{
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        if (mappedDiskUnit(unit))
+        {
+            if(DEBUG4 && debugflag4)
+            {
+                USLOSS_Console("raidUnitsMapped(): disk %d is mapped.\n", unit);
+            }
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ *  Returns the number of tracks in the smallest physical unit
+ */
+int smallestDiskSize()
+{
+    int smallest = DiskSizes[0];
+    for (int unit = 1; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        if (DiskSizes[unit] < smallest)
+        {
+            smallest = DiskSizes[unit];
+        }
+    }
+    return smallest;
+}
+
+/*
+ *  Returns the number of tracks in the RAID 0 unit. Each physical unit holds a
+ *  whole number of stripes, limited by the smallest unit.
+ */
+int raid0Tracks()
+{
+    int stripesPerUnit = smallestDiskSize() * USLOSS_DISK_TRACK_SIZE / diskStripeSectors;
+    int sectors = stripesPerUnit * diskStripeSectors * USLOSS_DISK_UNITS;
+    return sectors / USLOSS_DISK_TRACK_SIZE;
+}
+
+/*
+ *  Reads or writes sectors of the RAID 0 unit. The range is split at stripe
+ *  boundaries into one request per stripe, or more if a stripe is longer than
+ *  a request can be, and all of them are queued at once so that the drivers
+ *  for every physical unit work on them in parallel. The range may be longer
+ *  than a track, as long as it splits into at most MAXDISKBATCH requests.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were transferred successfully >0: a disk's status register
+ */
+int raid0Request(int op, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("raid0Request(): called.\n");
+    }
+
+    // check for illegal input values
+    if (checkRaidArgs("raid0Request", numSectors, startTrack, startSector, raid0Tracks(),
+                      DISK_RAID_MAX_SECTORS) == -1 || raidUnitsMapped())
+    {
+        return -1;
+    }
+
+    // Build one request for each stripe the range touches
+    int first = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    processPtr proc = getCurrentProc();
+    int numRequests = 0;
+    int done = 0;
+    while (done < numSectors)
+    {
+        int stripe = (first + done) / diskStripeSectors;
+        int offset = (first + done) % diskStripeSectors;
+        int count = diskStripeSectors - offset;
+        if (count > numSectors - done)
+        {
+            count = numSectors - done;
+        }
+
+        int unit = stripe % USLOSS_DISK_UNITS;
+        int physical = (stripe / USLOSS_DISK_UNITS) * diskStripeSectors + offset;
+        numRequests = addRaidRequests(proc, numRequests, op, memAddress + done * USLOSS_DISK_SECTOR_SIZE,
+                                      count, physical, unit);
+        if (numRequests == -1)
+        {
+            clearProc(proc);
+            return -1;
+        }
+        done += count;
+    }
+    proc->numDiskRequests = numRequests;
+
+    // Queue them all and wait for them to finish
+    int status = runDiskRequests(proc);
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Returns the number of tracks in the RAID 1 unit, which is the size of the
+ *  smallest physical unit
+ */
+int raid1Tracks()
+{
+    return smallestDiskSize();
+}
+
+/*
+ *  Picks the physical unit a RAID 1 read of the given track should go to. The
+ *  unit with the fewest queued requests wins; ties go to the unit whose head
+ *  is cheapest to move to the track. Each unit is looked at under its
+ *  diskMutex.
+ */
+int raid1ReadUnit(int track)
+{
+    int depth[USLOSS_DISK_UNITS];
+    int cost[USLOSS_DISK_UNITS];
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        getMutex(diskMutex[unit]);
+        depth[unit] = DiskUnitStats[unit].queueDepth;
+        cost[unit] = seekCost(unit, DiskHeadTrack[unit], track);
+        returnMutex(diskMutex[unit]);
+    }
+
+    int best = 0;
+    for (int unit = 1; unit < USLOSS_DISK_UNITS; unit++)
+    {
+        if (depth[unit] < depth[best] || (depth[unit] == depth[best] && cost[unit] < cost[best]))
+        {
+            best = unit;
+        }
+    }
+    return best;
+}
+
+/*
+ *  Reads or writes sectors of the RAID 1 unit. Writes go to the same place on
+ *  every physical unit at once. Reads go to a single unit chosen by
+ *  raid1ReadUnit. Each unit's share is cut into requests the driver takes.
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were transferred successfully >0: a disk's status register
+ */
+int raid1Request(int op, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("raid1Request(): called.\n");
+    }
+
+    // check for illegal input values
+    if (checkRaidArgs("raid1Request", numSectors, startTrack, startSector, raid1Tracks(),
+                      DISK_RAID_MAX_SECTORS / USLOSS_DISK_UNITS) == -1 || raidUnitsMapped())
+    {
+        return -1;
+    }
+
+    processPtr proc = getCurrentProc();
+    int block = startTrack * USLOSS_DISK_TRACK_SIZE + startSector;
+    int numRequests = 0;
+    if (op == DISK_WRITE)
+    {
+        for (int unit = 0; unit < USLOSS_DISK_UNITS && numRequests != -1; unit++)
+        {
+            numRequests = addRaidRequests(proc, numRequests, op, memAddress, numSectors, block, unit);
+        }
+    }
+    else
+    {
+        int unit = raid1ReadUnit(startTrack);
+        if(DEBUG4 && debugflag4)
+        {
+            USLOSS_Console("raid1Request(): reading from unit %d.\n", unit);
+        }
+        numRequests = addRaidRequests(proc, 0, op, memAddress, numSectors, block, unit);
+    }
+    if (numRequests == -1)
+    {
+        clearProc(proc);
+        return -1;
+    }
+    proc->numDiskRequests = numRequests;
+
+    // Queue them and wait for them to finish
+    int status = runDiskRequests(proc);
+    clearProc(proc);
+    return status;
+}
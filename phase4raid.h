@@ -0,0 +1,27 @@
+#ifndef _PHASE4RAID_H
+#define _PHASE4RAID_H
+
+#include "devices.h"
+
+// Default number of sectors in each stripe of the RAID 0 unit
+#define DISK_STRIPE_SECTORS     4
+
+// Most sectors the driver of a physical unit takes in one request, and the
+// bound on one request to a virtual unit, which is cut into at most
+// MAXDISKBATCH requests of the physical units
+#define DISK_REQUEST_SECTORS    (USLOSS_DISK_TRACK_SIZE - 1)
+#define DISK_RAID_MAX_SECTORS   (MAXDISKBATCH * DISK_REQUEST_SECTORS)
+
+extern int diskStripeSectors;
+
+extern int checkRaidArgs(char *, int, int, int, int, int);
+extern int addRaidRequests(processPtr, int, int, void *, int, int, int);
+extern int raidUnitsMapped();
+extern int smallestDiskSize();
+extern int raid0Tracks();
+extern int raid0Request(int, void *, int, int, int);
+extern int raid1Tracks();
+extern int raid1ReadUnit(int);
+extern int raid1Request(int, void *, int, int, int);
+
+#endif
@@ -0,0 +1,558 @@
+/*
+ *  File: phase4relocate.c
+ *  Purpose: This file holds functions and global variables for the optional
+ *  track relocation of a disk unit. Each logical track of a relocating unit is
+ *  stored on some physical track, and a map sends reads and writes there. The
+ *  accesses to each logical track are counted, and a relocator process moves
+ *  the hottest tracks next to the access-weighted median track, so that the
+ *  head travels less as it learns the workload.
+ *
+ *  A track is moved by copying it to a spare track and pointing the map at the
+ *  copy, so two tracks are swapped in three moves. The map is saved to the last
+ *  track of the unit after every move, and loaded again when the driver starts.
+ *  Only DiskRead and DiskWrite go through the map. DiskCopy, DiskFill,
+ *  DiskSubmitBatch and the RAID units name physical sectors, so they refuse a
+ *  relocating unit.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4raid.h"
+#include "phase4relocate.h"
+
+extern int debugflag4;
+extern int DiskSizes[USLOSS_DISK_UNITS];
+
+// Header of the saved map
+typedef struct relocateMapHeader
+{
+    int magic;
+    int logicalTracks;
+} relocateMapHeader;
+
+// Set before start3 runs to let the tracks of a unit be relocated. The
+// relocator makes a pass every diskRelocateInterval track accesses.
+int diskRelocate[USLOSS_DISK_UNITS];
+int diskRelocateInterval = DISK_RELOCATE_INTERVAL;
+
+// Mutex for the relocation state of each unit, a semaphore that processes
+// waiting for a track to finish moving block on, and a semaphore that wakes
+// the unit's relocator
+int relocateMutex[USLOSS_DISK_UNITS];
+semaphore relocateWaitSem[USLOSS_DISK_UNITS];
+semaphore relocateSem[USLOSS_DISK_UNITS];
+
+// Number of logical tracks in each unit, and the physical track tracks move
+// through
+static int RelocateTracks[USLOSS_DISK_UNITS];
+static int RelocateSpare[USLOSS_DISK_UNITS];
+
+// RelocateMap maps each logical track to the physical track that holds it, and
+// RelocateOwner maps each physical track back, EMPTY for the spare
+static int RelocateMap[USLOSS_DISK_UNITS][DISK_RELOCATE_MAX_TRACKS];
+static int RelocateOwner[USLOSS_DISK_UNITS][DISK_RELOCATE_MAX_TRACKS];
+
+// Accesses to each logical track, halved after every pass so that old
+// accesses fade, and the number of requests using each logical track
+static int RelocateCount[USLOSS_DISK_UNITS][DISK_RELOCATE_MAX_TRACKS];
+static int RelocateActive[USLOSS_DISK_UNITS][DISK_RELOCATE_MAX_TRACKS];
+
+// The logical track being moved, or EMPTY
+static int RelocateMoving[USLOSS_DISK_UNITS];
+
+static int RelocateAccesses[USLOSS_DISK_UNITS];
+static int RelocateWaiters[USLOSS_DISK_UNITS];
+static int RelocatorWoken[USLOSS_DISK_UNITS];
+
+// Buffers for the relocator and for the saved map
+static char RelocateBuffer[USLOSS_DISK_UNITS][USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+static char RelocateMapBuffer[USLOSS_DISK_UNITS][(1 + DISK_RELOCATE_MAP_SECTORS) * USLOSS_DISK_SECTOR_SIZE];
+
+static int relocateRequest(int, int, void *, int, int, int);
+static int loadRelocateMap(int);
+static int saveRelocateMap(int);
+static int rebuildRelocate(int);
+static int moveTrack(int, int, int);
+static int weightedMedianTrack(int);
+static int slotTrack(int, int, int);
+static void wakeRelocateWaiters(int);
+
+/*
+ *  Sets up the map of a relocating unit. Called by the unit's driver once the
+ *  size of the disk is known, before the driver starts taking requests.
+ */
+void initRelocate(int unit)
+{
+    relocateMutex[unit] = MboxCreate(1, 0);
+    returnMutex(relocateMutex[unit]);
+    relocateWaitSem[unit] = semcreateReal(0);
+    relocateSem[unit] = semcreateReal(0);
+
+    int tracks = DiskSizes[unit] - DISK_RELOCATE_RESERVED_TRACKS;
+    if (DiskSizes[unit] > DISK_RELOCATE_MAX_TRACKS || tracks < 2)
+    {
+        USLOSS_Console("initRelocate(%d): A disk of %d tracks can't relocate its tracks.\n",
+                       unit, DiskSizes[unit]);
+        diskRelocate[unit] = FALSE;
+        return;
+    }
+    RelocateTracks[unit] = tracks;
+    RelocateSpare[unit] = tracks;
+    RelocateMoving[unit] = EMPTY;
+    RelocateAccesses[unit] = 0;
+    RelocateWaiters[unit] = 0;
+    RelocatorWoken[unit] = FALSE;
+    for (int track = 0; track < tracks; track++)
+    {
+        RelocateCount[unit][track] = 0;
+        RelocateActive[unit][track] = 0;
+    }
+
+    // Pick up the map from the last run, or start with every logical track
+    // stored on the physical track of the same number
+    if (loadRelocateMap(unit) == -1 || rebuildRelocate(unit) == -1)
+    {
+        for (int track = 0; track < tracks; track++)
+        {
+            RelocateMap[unit][track] = track;
+        }
+        rebuildRelocate(unit);
+    }
+}
+
+/*
+ *  Works out RelocateOwner and the spare track of a unit from RelocateMap.
+ *  Returns -1 if the map is not valid and 0 otherwise.
+ */
+static int rebuildRelocate(int unit)
+{
+    int physicalTracks = RelocateTracks[unit] + 1;
+    for (int p = 0; p < physicalTracks; p++)
+    {
+        RelocateOwner[unit][p] = EMPTY;
+    }
+    for (int track = 0; track < RelocateTracks[unit]; track++)
+    {
+        int p = RelocateMap[unit][track];
+        if (p < 0 || p >= physicalTracks || RelocateOwner[unit][p] != EMPTY)
+        {
+            return -1;
+        }
+        RelocateOwner[unit][p] = track;
+    }
+    for (int p = 0; p < physicalTracks; p++)
+    {
+        if (RelocateOwner[unit][p] == EMPTY)
+        {
+            RelocateSpare[unit] = p;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  Reads the saved map of a unit into RelocateMap. This runs in the driver
+ *  before it takes requests, so it does the disk operation itself. Returns -1
+ *  if there is no usable map and 0 otherwise.
+ */
+static int loadRelocateMap(int unit)
+{
+    diskRequest request;
+    clearRequest(&request);
+    request.op = DISK_READ;
+    request.memAddress = RelocateMapBuffer[unit];
+    request.numSectors = 1 + DISK_RELOCATE_MAP_SECTORS;
+    request.startTrack = DiskSizes[unit] - 1;
+    request.startSector = 0;
+    request.unit = unit;
+    performDiskOp(&request);
+    if (request.resultStatus != 0)
+    {
+        return -1;
+    }
+
+    relocateMapHeader *header = (relocateMapHeader *) RelocateMapBuffer[unit];
+    if (header->magic != DISK_RELOCATE_MAGIC || header->logicalTracks != RelocateTracks[unit])
+    {
+        return -1;
+    }
+
+    short *map = (short *) (RelocateMapBuffer[unit] + USLOSS_DISK_SECTOR_SIZE);
+    for (int track = 0; track < RelocateTracks[unit]; track++)
+    {
+        RelocateMap[unit][track] = map[track];
+    }
+    return 0;
+}
+
+/*
+ *  Writes the map of a unit to its last track. Runs in the relocator, which
+ *  is the only process that changes the map. Returns 0 if the map was
+ *  written.
+ */
+static int saveRelocateMap(int unit)
+{
+    processPtr proc = getCurrentProc();
+
+    getMutex(relocateMutex[unit]);
+    memset(RelocateMapBuffer[unit], 0, sizeof(RelocateMapBuffer[unit]));
+    relocateMapHeader *header = (relocateMapHeader *) RelocateMapBuffer[unit];
+    header->magic = DISK_RELOCATE_MAGIC;
+    header->logicalTracks = RelocateTracks[unit];
+    short *map = (short *) (RelocateMapBuffer[unit] + USLOSS_DISK_SECTOR_SIZE);
+    for (int track = 0; track < RelocateTracks[unit]; track++)
+    {
+        map[track] = RelocateMap[unit][track];
+    }
+    returnMutex(relocateMutex[unit]);
+
+    initDiskRequest(&proc->diskRequests[0], DISK_WRITE, RelocateMapBuffer[unit],
+                    1 + DISK_RELOCATE_MAP_SECTORS, DiskSizes[unit] - 1, 0, unit);
+    proc->numDiskRequests = 1;
+    int status = runDiskRequests(proc);
+    clearProcRequest(proc);
+    return status;
+}
+
+/*
+ *  Returns the number of logical tracks of a relocating unit
+ */
+int relocateTracks(int unit)
+{
+    return RelocateTracks[unit];
+}
+
+/*
+ *  Reads sectors of a relocating unit
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were read successfully >0: disk's status register
+ */
+int relocateReadReal(int unit, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    return relocateRequest(DISK_READ, unit, memAddress, numSectors, startTrack, startSector);
+}
+
+/*
+ *  Writes sectors of a relocating unit
+ *  Return values:
+ *    -1: invalid parameters
+ *     0: sectors were written successfully >0: disk's status register
+ */
+int relocateWriteReal(int unit, void *memAddress, int numSectors, int startTrack, int startSector)
+{
+    return relocateRequest(DISK_WRITE, unit, memAddress, numSectors, startTrack, startSector);
+}
+
+/*
+ *  Reads or writes sectors of a relocating unit, with one request for each
+ *  logical track the range touches, sent to wherever the map says the track
+ *  is. Waits first for any of the tracks that is being moved, and keeps them
+ *  from being moved until the requests have finished.
+ */
+static int relocateRequest(int op, int unit, void *memAddress, int numSectors,
+                           int startTrack, int startSector)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("relocateRequest(): called.\n");
+    }
+
+    if (checkRaidArgs("relocateRequest", numSectors, startTrack, startSector,
+                      RelocateTracks[unit], DISK_REQUEST_SECTORS) == -1)
+    {
+        return -1;
+    }
+
+    // A request is shorter than a track, so it touches one or two
+    int lastTrack = startTrack + (startSector + numSectors - 1) / USLOSS_DISK_TRACK_SIZE;
+    if (numSectors == 0)
+    {
+        lastTrack = startTrack;
+    }
+    processPtr proc = getCurrentProc();
+
+    getMutex(relocateMutex[unit]);
+    while (RelocateMoving[unit] != EMPTY && RelocateMoving[unit] >= startTrack &&
+           RelocateMoving[unit] <= lastTrack)
+    {
+        RelocateWaiters[unit]++;
+        returnMutex(relocateMutex[unit]);
+        sempReal(relocateWaitSem[unit]);
+        getMutex(relocateMutex[unit]);
+    }
+
+    int sector = startSector;
+    int done = 0;
+    for (int track = startTrack; track <= lastTrack; track++)
+    {
+        int count = USLOSS_DISK_TRACK_SIZE - sector;
+        if (count > numSectors - done)
+        {
+            count = numSectors - done;
+        }
+        initDiskRequest(&proc->diskRequests[proc->numDiskRequests], op,
+                        memAddress + done * USLOSS_DISK_SECTOR_SIZE, count,
+                        RelocateMap[unit][track], sector, unit);
+        proc->numDiskRequests++;
+        RelocateActive[unit][track]++;
+        RelocateCount[unit][track]++;
+        done += count;
+        sector = 0;
+    }
+
+    // Wake the relocator every diskRelocateInterval accesses
+    RelocateAccesses[unit] += lastTrack - startTrack + 1;
+    if (RelocateAccesses[unit] >= diskRelocateInterval && !RelocatorWoken[unit])
+    {
+        RelocateAccesses[unit] = 0;
+        RelocatorWoken[unit] = TRUE;
+        semvReal(relocateSem[unit]);
+    }
+    returnMutex(relocateMutex[unit]);
+
+    int status = runDiskRequests(proc);
+
+    getMutex(relocateMutex[unit]);
+    for (int track = startTrack; track <= lastTrack; track++)
+    {
+        RelocateActive[unit][track]--;
+    }
+    wakeRelocateWaiters(unit);
+    returnMutex(relocateMutex[unit]);
+
+    clearProc(proc);
+    return status;
+}
+
+/*
+ *  Makes one pass of the relocator of a unit. The logical tracks are taken in
+ *  order of their access counts and given the physical tracks in order of
+ *  their distance from the weighted median track: the median, then the tracks
+ *  on alternate sides of it, moving out. A track stays where it is if no
+ *  closer track is free for it. Otherwise the first one that is held by a
+ *  track with at most half as many accesses, or by no track, is swapped with
+ *  it. A pass moves at most one track, and the counts are then halved. Runs in
+ *  the relocator process. Returns 0 if it moved a track and -1 otherwise.
+ */
+int relocateHotTrack(int unit)
+{
+    int ranked[DISK_RELOCATE_MAX_TRACKS] = {0};
+    int taken[DISK_RELOCATE_MAX_TRACKS] = {0};
+    int physicalTracks = RelocateTracks[unit] + 1;
+    int hot = EMPTY;
+    int target = EMPTY;
+
+    getMutex(relocateMutex[unit]);
+    RelocatorWoken[unit] = FALSE;
+    int median = weightedMedianTrack(unit);
+    for (int rank = 0; median != EMPTY && hot == EMPTY && rank < RelocateTracks[unit]; rank++)
+    {
+        // Find the track of this rank
+        int track = EMPTY;
+        for (int t = 0; t < RelocateTracks[unit]; t++)
+        {
+            if (!ranked[t] && (track == EMPTY || RelocateCount[unit][t] > RelocateCount[unit][track]))
+            {
+                track = t;
+            }
+        }
+        ranked[track] = TRUE;
+        if (RelocateCount[unit][track] < DISK_RELOCATE_MIN_COUNT)
+        {
+            break;
+        }
+
+        // Look for a free place closer to the median than where it is
+        int current = RelocateMap[unit][track];
+        for (int k = 0; k < physicalTracks; k++)
+        {
+            int slot = slotTrack(unit, median, k);
+            if (abs(slot - median) >= abs(current - median))
+            {
+                taken[current] = TRUE;
+                break;
+            }
+            int occupant = RelocateOwner[unit][slot];
+            if (!taken[slot] && (occupant == EMPTY ||
+                RelocateCount[unit][track] >= 2 * RelocateCount[unit][occupant]))
+            {
+                hot = track;
+                target = slot;
+                break;
+            }
+        }
+    }
+
+    for (int t = 0; t < RelocateTracks[unit]; t++)
+    {
+        RelocateCount[unit][t] /= 2;
+    }
+    returnMutex(relocateMutex[unit]);
+
+    if (hot == EMPTY)
+    {
+        return -1;
+    }
+
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("relocateHotTrack(%d): moving track %d to physical track %d.\n",
+                       unit, hot, target);
+    }
+
+    // Move the hot track into the spare if that is its slot. Otherwise swap it
+    // with the track in its slot, through the spare.
+    int from = RelocateMap[unit][hot];
+    int occupant = RelocateOwner[unit][target];
+    if (occupant == EMPTY)
+    {
+        return moveTrack(unit, hot, target) == 0 ? 0 : -1;
+    }
+    if (moveTrack(unit, hot, RelocateSpare[unit]) != 0 ||
+        moveTrack(unit, occupant, from) != 0 ||
+        moveTrack(unit, hot, target) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ *  Copies a logical track of a unit to the free physical track to and points
+ *  the map at the copy, once no request is using it. Requests for the track
+ *  wait until it has moved. Returns 0 if the track moved.
+ */
+static int moveTrack(int unit, int track, int to)
+{
+    processPtr proc = getCurrentProc();
+
+    getMutex(relocateMutex[unit]);
+    RelocateMoving[unit] = track;
+    while (RelocateActive[unit][track] > 0)
+    {
+        RelocateWaiters[unit]++;
+        returnMutex(relocateMutex[unit]);
+        sempReal(relocateWaitSem[unit]);
+        getMutex(relocateMutex[unit]);
+    }
+    int from = RelocateMap[unit][track];
+    returnMutex(relocateMutex[unit]);
+
+    // Copy the track, giving way to every other request
+    initDiskRequest(&proc->diskRequests[0], DISK_READ, RelocateBuffer[unit],
+                    USLOSS_DISK_TRACK_SIZE, from, 0, unit);
+    proc->diskRequests[0].ioClass = DISK_IOCLASS_IDLE;
+    proc->numDiskRequests = 1;
+    int status = runDiskRequests(proc);
+    clearProcRequest(proc);
+    if (status == 0)
+    {
+        initDiskRequest(&proc->diskRequests[0], DISK_WRITE, RelocateBuffer[unit],
+                        USLOSS_DISK_TRACK_SIZE, to, 0, unit);
+        proc->diskRequests[0].ioClass = DISK_IOCLASS_IDLE;
+        proc->numDiskRequests = 1;
+        status = runDiskRequests(proc);
+        clearProcRequest(proc);
+    }
+
+    // The old copy stays in use until the map pointing at the new one is saved
+    getMutex(relocateMutex[unit]);
+    if (status == 0)
+    {
+        RelocateMap[unit][track] = to;
+        RelocateOwner[unit][to] = track;
+        RelocateOwner[unit][from] = EMPTY;
+        RelocateSpare[unit] = from;
+    }
+    returnMutex(relocateMutex[unit]);
+    if (status == 0)
+    {
+        status = saveRelocateMap(unit);
+    }
+
+    getMutex(relocateMutex[unit]);
+    RelocateMoving[unit] = EMPTY;
+    wakeRelocateWaiters(unit);
+    returnMutex(relocateMutex[unit]);
+    return status;
+}
+
+/*
+ *  Returns the physical track at which half of the counted accesses to a
+ *  unit fall on either side, or EMPTY if none have been counted. Called with
+ *  the unit's relocation mutex held.
+ */
+static int weightedMedianTrack(int unit)
+{
+    int total = 0;
+    for (int track = 0; track < RelocateTracks[unit]; track++)
+    {
+        total += RelocateCount[unit][track];
+    }
+    if (total == 0)
+    {
+        return EMPTY;
+    }
+
+    int seen = 0;
+    for (int p = 0; p <= RelocateTracks[unit]; p++)
+    {
+        int owner = RelocateOwner[unit][p];
+        if (owner != EMPTY)
+        {
+            seen += RelocateCount[unit][owner];
+        }
+        if (2 * seen >= total)
+        {
+            return p;
+        }
+    }
+    return RelocateTracks[unit];
+}
+
+/*
+ *  Returns the physical track that comes k-th in order of distance from the
+ *  median: median for 0, then median + 1, median - 1, median + 2, and so on,
+ *  leaving out the tracks past either end of the unit
+ */
+static int slotTrack(int unit, int median, int k)
+{
+    int physicalTracks = RelocateTracks[unit] + 1;
+    int slot = median;
+    for (int offset = 1; k > 0; offset++)
+    {
+        if (median + offset < physicalTracks && k > 0)
+        {
+            slot = median + offset;
+            k--;
+        }
+        if (median - offset >= 0 && k > 0)
+        {
+            slot = median - offset;
+            k--;
+        }
+    }
+    return slot;
+}
+
+/*
+ *  Lets every process waiting for a track to move, or for requests to finish,
+ *  check again. Called with the unit's relocation mutex held.
+ */
+static void wakeRelocateWaiters(int unit)
+{
+    for (; RelocateWaiters[unit] > 0; RelocateWaiters[unit]--)
+    {
+        semvReal(relocateWaitSem[unit]);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef _PHASE4RELOCATE_H
+#define _PHASE4RELOCATE_H
+
+#include "devices.h"
+
+// Largest unit, in tracks, whose tracks can be relocated
+#define DISK_RELOCATE_MAX_TRACKS 256
+
+// The second last track of a relocating unit is the spare that tracks move
+// through, and the last holds the saved map
+#define DISK_RELOCATE_RESERVED_TRACKS 2
+#define DISK_RELOCATE_MAP_SECTORS \
+    (DISK_RELOCATE_MAX_TRACKS * (int) sizeof(short) / USLOSS_DISK_SECTOR_SIZE)
+#define DISK_RELOCATE_MAGIC     0x52454c21
+
+// Default number of track accesses between passes of the relocator, and the
+// fewest accesses for which a track is moved
+#define DISK_RELOCATE_INTERVAL  64
+#define DISK_RELOCATE_MIN_COUNT 4
+
+extern int diskRelocate[USLOSS_DISK_UNITS];
+extern int diskRelocateInterval;
+extern semaphore relocateSem[USLOSS_DISK_UNITS];
+
+extern void initRelocate(int);
+extern int relocateTracks(int);
+extern int relocateReadReal(int, void *, int, int, int);
+extern int relocateWriteReal(int, void *, int, int, int);
+extern int relocateHotTrack(int);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ *  File: phase4sparse.c
+ *  Purpose: This file holds functions and global variables that keep track of
+ *  which disk sectors are known to hold only zeros. When diskSparseSectors is
+ *  set, DiskRead fills the buffer with zeros instead of reading such sectors,
+ *  and DiskWrite drops writes of zeros to them.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase2.h"
+#include "providedPrototypes.h"
+#include "phase4utility.h"
+#include "phase4disk.h"
+#include "phase4sparse.h"
+
+extern int debugflag4;
+extern int DiskSizes[USLOSS_DISK_UNITS];
+
+// Set before start3 runs to track zero sectors, and to have the drivers read
+// every sector at boot to find them
+int diskSparseSectors = FALSE;
+int diskZeroScan = FALSE;
+
+// One bit for each sector, set when the sector is known to hold only zeros.
+// Only the driver of a unit changes its bits, as it finishes each sector.
+static unsigned char DiskZeroMap[USLOSS_DISK_UNITS][DISK_SPARSE_MAX_SECTORS / 8];
+
+// Buffer the drivers read tracks into while scanning
+static char ZeroScanBuffer[USLOSS_DISK_UNITS][USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+
+/*
+ *  Returns TRUE if the given number of bytes at buffer are all zero
+ */
+int bufferIsZero(void *buffer, int bytes)
+{
+    long *words = (long *) buffer;
+    int numWords = bytes / sizeof(long);
+    for (int i = 0; i < numWords; i++)
+    {
+        if (words[i] != 0)
+        {
+            return FALSE;
+        }
+    }
+    char *rest = (char *) buffer;
+    for (int i = numWords * sizeof(long); i < bytes; i++)
+    {
+        if (rest[i] != 0)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ *  Records whether a sector that was just read or written holds only zeros.
+ *  data is the sector's contents, or NULL if they are not known.
+ */
+void noteSectorContents(int unit, int track, int sector, void *data)
+{
+    int block = track * USLOSS_DISK_TRACK_SIZE + sector;
+    if (block >= DISK_SPARSE_MAX_SECTORS)
+    {
+        return;
+    }
+
+    if (data != NULL && bufferIsZero(data, USLOSS_DISK_SECTOR_SIZE))
+    {
+        DiskZeroMap[unit][block / 8] |= 1 << (block % 8);
+    }
+    else
+    {
+        DiskZeroMap[unit][block / 8] &= ~(1 << (block % 8));
+    }
+}
+
+/*
+ *  Returns TRUE if every sector in the range is known to hold only zeros
+ */
+int knownZeroRange(int unit, int track, int sector, int numSectors)
+{
+    int first = track * USLOSS_DISK_TRACK_SIZE + sector;
+    if (first + numSectors > DISK_SPARSE_MAX_SECTORS)
+    {
+        return FALSE;
+    }
+    for (int block = first; block < first + numSectors; block++)
+    {
+        if (!(DiskZeroMap[unit][block / 8] & (1 << (block % 8))))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ *  Reads every track of a unit so that performDiskOp records which sectors are
+ *  zero. Runs in the driver before it takes requests.
+ */
+void scanZeroSectors(int unit)
+{
+    if(DEBUG4 && debugflag4)
+    {
+        USLOSS_Console("scanZeroSectors(%d): scanning %d tracks.\n", unit, DiskSizes[unit]);
+    }
+
+    for (int track = 0; track < DiskSizes[unit] && track < DISK_SPARSE_MAX_TRACKS; track++)
+    {
+        diskRequest request;
+        clearRequest(&request);
+        request.op = DISK_READ;
+        request.memAddress = ZeroScanBuffer[unit];
+        request.numSectors = USLOSS_DISK_TRACK_SIZE;
+        request.startTrack = track;
+        request.startSector = 0;
+        request.unit = unit;
+        performDiskOp(&request);
+    }
+}
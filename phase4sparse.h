@@ -0,0 +1,18 @@
+#ifndef _PHASE4SPARSE_H
+#define _PHASE4SPARSE_H
+
+#include "devices.h"
+
+// Largest unit, in tracks, whose zero sectors are tracked
+#define DISK_SPARSE_MAX_TRACKS  1024
+#define DISK_SPARSE_MAX_SECTORS (DISK_SPARSE_MAX_TRACKS * USLOSS_DISK_TRACK_SIZE)
+
+extern int diskSparseSectors;
+extern int diskZeroScan;
+
+extern int bufferIsZero(void *, int);
+extern void noteSectorContents(int, int, int, void *);
+extern int knownZeroRange(int, int, int, int);
+extern void scanZeroSectors(int);
+
+#endif
@@ -141,18 +141,36 @@ int sendPrivateMessageCond(int pid, void *msg, int size)
     return MboxCondSend(proc->privateMboxID, msg, size);
 }
 
+/*
+ *  Set the given diskRequest struct values to their default values
+ */
+void clearRequest(diskRequestPtr request)
+{
+    request->op = EMPTY;
+    request->memAddress = NULL;
+    request->numSectors = EMPTY;
+    request->startTrack = EMPTY;
+    request->startSector = EMPTY;
+    request->unit = EMPTY;
+    request->resultStatus = 0;
+    request->ioClass = DISK_IOCLASS_BE;
+    request->queueTime = -1;
+    request->startTime = -1;
+    request->epoch = 0;
+    request->proc = NULL;
+    request->nextDiskQueueRequest = NULL;
+}
+
 /*
  *  Set the diskRequest struct values in this process to their default values
  */
 void clearProcRequest(processPtr proc)
 {
-    proc->diskRequest.op = EMPTY;
-    proc->diskRequest.memAddress = NULL;
-    proc->diskRequest.numSectors = EMPTY;
-    proc->diskRequest.startTrack = EMPTY;
-    proc->diskRequest.startSector = EMPTY;
-    proc->diskRequest.unit = EMPTY;
-    proc->diskRequest.resultStatus = 0;
+    for (int i = 0; i < MAXDISKBATCH; i++)
+    {
+        clearRequest(&proc->diskRequests[i]);
+    }
+    proc->numDiskRequests = 0;
 }
 
 /*
@@ -164,7 +182,6 @@ void clearProc(processPtr proc)
     proc->nextProc = NULL;
     proc->blockStartTime = -1;
     proc->sleepTime = -1;
-    proc->nextDiskQueueProc = NULL;
 
     clearProcRequest(proc);
 }
@@ -185,31 +202,3 @@ processPtr getCurrentProc()
 {
     return &ProcTable[getpid() % MAXPROC];
 }
-
-/*
- *  A function used to insert disk requests in the correct order in the disk queue
- *  Returns:
- *    >0: req1 should go after req2 in the disk queue
- *    <0: req1 should go before req2 in the disk queue
- *     0: req1 and req2 are equivalent and should be adjacent in the queue
- */
-int compareRequests(diskRequest *req1, diskRequest *req2)
-{
-    if (req1->startTrack > req2->startTrack)
-    {
-        return 1;
-    }
-    else if (req2->startTrack > req1->startTrack)
-    {
-        return -1;
-    }
-    else if (req1->startSector > req2->startSector)
-    {
-        return 1;
-    }
-    else if (req2->startSector > req1->startSector)
-    {
-        return -1;
-    }
-    return 0;
-}
@@ -9,11 +9,11 @@ extern void blockOnMbox();
 extern void unblockByMbox(processPtr);
 extern void getMutex(int);
 extern void returnMutex(int);
+extern void clearRequest(diskRequestPtr);
 extern void clearProcRequest(processPtr);
 extern void clearProc(processPtr);
 extern void initProc();
 extern processPtr getCurrentProc();
-extern int compareRequests(diskRequest *, diskRequest *);
 extern void sendPrivateMessage(int, void *, int);
 extern void receivePrivateMessage(void *, int);
 extern int receivePrivateMessageCond(void *, int);
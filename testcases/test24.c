@@ -0,0 +1,97 @@
+/* DISKTEST
+ * Submit a batch of writes spread across both disks and out of track
+ * order, then read them back with a second batch. One entry of the read
+ * batch has an invalid track and should come back with status -1, as should
+ * an entry that starts on the last track of disk 0 but runs off its end.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[4][512];
+static char copy[5][512];
+static int units[4]  = {0, 1, 0, 1};
+static int tracks[4] = {9, 2, 1, 7};
+
+int start4(char *arg)
+{
+    DiskBatchRequest batch[5];
+    int result;
+
+    USLOSS_Console("start4(): Writing 4 sectors with one batch\n");
+    for (int i = 0; i < 4; i++)
+    {
+        sprintf(sectors[i], "batch sector %d: unit %d, track %d\n", i, units[i], tracks[i]);
+        batch[i].op = USLOSS_DISK_WRITE;
+        batch[i].buffer = sectors[i];
+        batch[i].unit = units[i];
+        batch[i].track = tracks[i];
+        batch[i].first = i;
+        batch[i].sectors = 1;
+        batch[i].ioClass = DISK_IOCLASS_DEFAULT;
+    }
+    result = DiskSubmitBatch(batch, 4);
+    assert(result == 0);
+    for (int i = 0; i < 4; i++)
+    {
+        USLOSS_Console("start4(): write %d status %d\n", i, batch[i].status);
+    }
+
+    USLOSS_Console("\nstart4(): Reading them back with one batch\n");
+    for (int i = 0; i < 4; i++)
+    {
+        batch[i].op = USLOSS_DISK_READ;
+        batch[i].buffer = copy[i];
+    }
+    batch[4] = batch[0];
+    batch[4].buffer = copy[4];
+    batch[4].track = 10000;
+    result = DiskSubmitBatch(batch, 5);
+    assert(result == 0);
+    for (int i = 0; i < 4; i++)
+    {
+        USLOSS_Console("start4(): read %d status %d: %s", i, batch[i].status, copy[i]);
+    }
+    USLOSS_Console("start4(): read 4 status %d\n", batch[4].status);
+
+    USLOSS_Console("\nstart4(): Reading up to and past the end of disk 0\n");
+    int sectorSize, trackSize, diskSize;
+    result = DiskSize(0, &sectorSize, &trackSize, &diskSize);
+    assert(result == 0);
+    static char end[2][10 * 512];
+    for (int i = 0; i < 2; i++)
+    {
+        batch[i].op = USLOSS_DISK_READ;
+        batch[i].buffer = end[i];
+        batch[i].unit = 0;
+        batch[i].track = diskSize - 1;
+        batch[i].first = 6 + 4 * i;
+        batch[i].sectors = 10;
+        batch[i].ioClass = DISK_IOCLASS_DEFAULT;
+    }
+    result = DiskSubmitBatch(batch, 2);
+    assert(result == 0);
+    USLOSS_Console("start4(): sectors 6-15 status %d, sectors 10-19 status %d\n",
+                   batch[0].status, batch[1].status);
+
+    USLOSS_Console("\nstart4(): Submitting an empty batch\n");
+    result = DiskSubmitBatch(batch, 0);
+    USLOSS_Console("start4(): DiskSubmitBatch returned %d\n", result);
+
+    Terminate(24);
+    return 0;
+}
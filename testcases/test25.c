@@ -0,0 +1,62 @@
+/* DISKTEST
+ * Write three sectors to disk 1 that wrap from track 4 to track 5, read
+ * them back, and check the counters reported by DiskStats.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[3 * 512];
+static char copy[3 * 512];
+
+int start4(char *arg)
+{
+    DiskStatistics stats;
+    int result;
+    int status;
+
+    USLOSS_Console("start4(): Writing and reading 3 sectors on disk 1\n");
+    strcpy(&sectors[0 * 512], "first\n");
+    strcpy(&sectors[1 * 512], "second\n");
+    strcpy(&sectors[2 * 512], "third\n");
+    result = DiskWrite((char *) sectors, 1, 4, 15, 3, &status);
+    assert(result == 0);
+    result = DiskRead((char *) copy, 1, 4, 15, 3, &status);
+    assert(result == 0);
+
+    result = DiskStats(1, &stats);
+    assert(result == 0);
+    USLOSS_Console("start4(): requests %d, sectors %d\n", stats.requests, stats.sectors);
+    USLOSS_Console("start4(): seeks %d, seek distance %d\n", stats.seeks, stats.seekDistance);
+    USLOSS_Console("start4(): queue depth %d, max queue depth %d\n",
+                   stats.queueDepth, stats.maxQueueDepth);
+
+    int waits = 0;
+    int services = 0;
+    for (int i = 0; i < DISK_STATS_BUCKETS; i++)
+    {
+        waits += stats.waitHistogram[i];
+        services += stats.serviceHistogram[i];
+    }
+    USLOSS_Console("start4(): histogram totals %d and %d\n", waits, services);
+
+    result = DiskStats(2, &stats);
+    USLOSS_Console("start4(): DiskStats on unit 2 returned %d\n", result);
+
+    Terminate(25);
+    return 0;
+}
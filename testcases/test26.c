@@ -0,0 +1,84 @@
+/* DISKTEST
+ * Write six sectors to the RAID 0 unit so that they span two stripes, read
+ * them back through the RAID 0 unit, and then read the physical disks to see
+ * where the stripes landed. A transfer longer than a track is split into
+ * requests for the physical disks, as long as they fit in one batch.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[6 * 512];
+static char copy[6 * 512];
+static char large[200 * 512];
+static char largeCopy[40 * 512];
+
+int start4(char *arg)
+{
+    int result;
+    int status;
+    int sectorSize, trackSize, diskSize;
+
+    result = DiskSize(DISK_RAID0_UNIT, &sectorSize, &trackSize, &diskSize);
+    assert(result == 0);
+    USLOSS_Console("start4(): RAID 0 unit: sector size %d, track size %d, disk size %d\n",
+                   sectorSize, trackSize, diskSize);
+
+    for (int i = 0; i < 6; i++)
+    {
+        sprintf(&sectors[i * 512], "virtual sector %d", i + 2);
+    }
+    result = DiskWrite(sectors, DISK_RAID0_UNIT, 0, 2, 6, &status);
+    assert(result == 0 && status == 0);
+
+    result = DiskRead(copy, DISK_RAID0_UNIT, 0, 2, 6, &status);
+    assert(result == 0 && status == 0);
+    for (int i = 0; i < 6; i++)
+    {
+        USLOSS_Console("start4(): RAID 0 read: %s\n", &copy[i * 512]);
+    }
+
+    result = DiskRead(copy, 0, 0, 2, 2, &status);
+    assert(result == 0);
+    USLOSS_Console("start4(): disk 0 track 0 sector 2: %s\n", &copy[0 * 512]);
+    USLOSS_Console("start4(): disk 0 track 0 sector 3: %s\n", &copy[1 * 512]);
+    result = DiskRead(copy, 1, 0, 0, 4, &status);
+    assert(result == 0);
+    for (int i = 0; i < 4; i++)
+    {
+        USLOSS_Console("start4(): disk 1 track 0 sector %d: %s\n", i, &copy[i * 512]);
+    }
+
+    result = DiskRead(copy, DISK_RAID0_UNIT, diskSize, 0, 1, &status);
+    USLOSS_Console("start4(): reading past the end returned %d\n", result);
+
+    for (int i = 0; i < 40 * 512; i++)
+    {
+        large[i] = 'A' + i / 512 % 26;
+    }
+    result = DiskWrite(large, DISK_RAID0_UNIT, 2, 3, 40, &status);
+    assert(result == 0 && status == 0);
+    result = DiskRead(largeCopy, DISK_RAID0_UNIT, 2, 3, 40, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): 40 sectors read back through RAID 0 match: %d\n",
+                   memcmp(large, largeCopy, sizeof(largeCopy)) == 0);
+    result = DiskWrite(large, DISK_RAID0_UNIT, 2, 0, 200, &status);
+    USLOSS_Console("start4(): writing 200 sectors in stripes of 4 returned %d\n", result);
+
+    Terminate(26);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* DISKTEST
+ * Fill a range of disk 1 with a pattern, then copy three sectors that wrap
+ * a track boundary on disk 0 to disk 1 inside the kernel, and read back
+ * the results.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[3 * 512];
+static char copy[3 * 512];
+
+int start4(char *arg)
+{
+    int result;
+    int status;
+
+    USLOSS_Console("start4(): Filling 20 sectors of disk 1 from track 2 with 'z'\n");
+    result = DiskFill(1, 2, 0, 20, 'z', &status);
+    assert(result == 0 && status == 0);
+    result = DiskRead(copy, 1, 3, 2, 2, &status);
+    assert(result == 0);
+    USLOSS_Console("start4(): track 3 sector 2 starts with %c, ends with %c\n",
+                   copy[0], copy[511]);
+    USLOSS_Console("start4(): track 3 sector 3 starts with %c, ends with %c\n",
+                   copy[512], copy[1023]);
+
+    USLOSS_Console("\nstart4(): Copying 3 sectors from disk 0 to disk 1\n");
+    strcpy(&sectors[0 * 512], "copied sector one\n");
+    strcpy(&sectors[1 * 512], "copied sector two\n");
+    strcpy(&sectors[2 * 512], "copied sector three\n");
+    result = DiskWrite(sectors, 0, 1, 14, 3, &status);
+    assert(result == 0);
+    result = DiskCopy(0, 1, 14, 1, 5, 0, 3, &status);
+    assert(result == 0 && status == 0);
+    result = DiskRead(copy, 1, 5, 0, 3, &status);
+    assert(result == 0);
+    USLOSS_Console("start4(): Read from disk 1: %s", &copy[0 * 512]);
+    USLOSS_Console("start4(): Read from disk 1: %s", &copy[1 * 512]);
+    USLOSS_Console("start4(): Read from disk 1: %s", &copy[2 * 512]);
+
+    USLOSS_Console("\nstart4(): Copying between overlapping ranges\n");
+    result = DiskCopy(0, 1, 0, 0, 1, 4, 8, &status);
+    USLOSS_Console("start4(): DiskCopy returned %d\n", result);
+
+    Terminate(27);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* DISKTEST
+ * Put disk 1 in log-structured mode and overwrite scattered sectors until the
+ * log has to be cleaned, then read every sector back and check that each one
+ * holds the last thing written to it. The calls that name physical sectors
+ * must refuse the disk.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+#define WRITES 400
+
+extern int diskLogStructured[];
+
+void test_setup(int argc, char *argv[])
+{
+    diskLogStructured[1] = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sector[512];
+static char copy[512];
+static int lastWrite[16 * 32];
+
+int start4(char *arg)
+{
+    int result;
+    int status;
+    int sectorSize, trackSize, diskSize;
+
+    result = DiskSize(1, &sectorSize, &trackSize, &diskSize);
+    assert(result == 0);
+    USLOSS_Console("start4(): log-structured disk 1 has %d tracks\n", diskSize);
+
+    // Write single sectors spread across the disk, many times over
+    for (int i = 0; i < diskSize * 16; i++)
+    {
+        lastWrite[i] = -1;
+    }
+    for (int i = 0; i < WRITES; i++)
+    {
+        int block = (i * 37) % (diskSize * 16);
+        sprintf(sector, "write %d to block %d", i, block);
+        result = DiskWrite(sector, 1, block / 16, block % 16, 1, &status);
+        assert(result == 0 && status == 0);
+        lastWrite[block] = i;
+    }
+    USLOSS_Console("start4(): %d writes done\n", WRITES);
+
+    // Every block written must hold its last write
+    int bad = 0;
+    for (int block = 0; block < diskSize * 16; block++)
+    {
+        if (lastWrite[block] == -1)
+        {
+            continue;
+        }
+        result = DiskRead(copy, 1, block / 16, block % 16, 1, &status);
+        assert(result == 0 && status == 0);
+        sprintf(sector, "write %d to block %d", lastWrite[block], block);
+        if (strcmp(sector, copy) != 0)
+        {
+            bad++;
+        }
+    }
+    USLOSS_Console("start4(): %d blocks did not match\n", bad);
+
+    result = DiskWrite(sector, 1, diskSize, 0, 1, &status);
+    USLOSS_Console("start4(): writing past the end returned %d\n", result);
+
+    result = DiskFill(1, 0, 0, 4, 'x', &status);
+    USLOSS_Console("start4(): DiskFill returned %d\n", result);
+    result = DiskCopy(0, 0, 0, 1, 0, 0, 4, &status);
+    USLOSS_Console("start4(): DiskCopy returned %d\n", result);
+    DiskBatchRequest request = {USLOSS_DISK_WRITE, sector, 1, 0, 0, 1, DISK_IOCLASS_DEFAULT, 0};
+    DiskSubmitBatch(&request, 1);
+    USLOSS_Console("start4(): a batch write got status %d\n", request.status);
+    result = DiskWrite(sector, DISK_RAID0_UNIT, 0, 0, 1, &status);
+    USLOSS_Console("start4(): writing to the striped unit returned %d\n", result);
+
+    Terminate(28);
+    return 0;
+}
@@ -0,0 +1,70 @@
+/* DISKTEST
+ * Track zero sectors on the disks. Write zeros to two sectors of disk 1, then
+ * read them and write zeros again, which should not reach the disk. Then put
+ * data in one of them and read both back from the disk.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskSparseSectors;
+
+void test_setup(int argc, char *argv[])
+{
+    diskSparseSectors = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[2 * 512];
+
+static void printRequests(char *after)
+{
+    DiskStatistics stats;
+    int result = DiskStats(1, &stats);
+    assert(result == 0);
+    USLOSS_Console("start4(): after %s, disk 1 has done %d requests\n", after, stats.requests);
+}
+
+int start4(char *arg)
+{
+    int result;
+    int status;
+
+    memset(sectors, 0, sizeof(sectors));
+    result = DiskWrite(sectors, 1, 3, 0, 2, &status);
+    assert(result == 0 && status == 0);
+    printRequests("writing zeros");
+
+    memset(sectors, 'x', sizeof(sectors));
+    result = DiskRead(sectors, 1, 3, 0, 2, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): read back zeros: %d\n", sectors[0] == 0 && sectors[1023] == 0);
+    printRequests("reading zeros");
+
+    memset(sectors, 0, sizeof(sectors));
+    result = DiskWrite(sectors, 1, 3, 0, 2, &status);
+    assert(result == 0 && status == 0);
+    printRequests("writing zeros again");
+
+    strcpy(sectors, "not zero");
+    result = DiskWrite(sectors, 1, 3, 1, 1, &status);
+    assert(result == 0 && status == 0);
+    printRequests("writing data");
+
+    result = DiskRead(sectors, 1, 3, 0, 2, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): read back '%s' after a zero sector\n", &sectors[512]);
+    printRequests("reading data");
+
+    Terminate(29);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* DISKTEST
+ * Compress disk 1. Write twelve sectors of repetitive text, check that fewer
+ * sectors than that reach the disk, and read back part of them, starting in
+ * the middle of a block. The calls that name physical sectors must refuse the
+ * disk.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskCompressed[];
+
+void test_setup(int argc, char *argv[])
+{
+    diskCompressed[1] = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[12 * 512];
+static char copy[5 * 512];
+
+static int sectorsMoved()
+{
+    DiskStatistics stats;
+    int result = DiskStats(1, &stats);
+    assert(result == 0);
+    return stats.sectors;
+}
+
+int start4(char *arg)
+{
+    int result;
+    int status;
+    int sectorSize, trackSize, diskSize;
+
+    result = DiskSize(1, &sectorSize, &trackSize, &diskSize);
+    assert(result == 0);
+    USLOSS_Console("start4(): compressed disk 1 has %d tracks\n", diskSize);
+
+    for (int i = 0; i < 12; i++)
+    {
+        for (int j = 0; j < 512; j += 32)
+        {
+            sprintf(&sectors[i * 512 + j], "sector %2d of the record %5d  ", i, j);
+        }
+    }
+
+    int before = sectorsMoved();
+    result = DiskWrite(sectors, 1, 2, 0, 12, &status);
+    assert(result == 0 && status == 0);
+    int moved = sectorsMoved() - before;
+    USLOSS_Console("start4(): writing 12 sectors moved fewer: %d\n", moved < 12);
+
+    result = DiskRead(copy, 1, 2, 3, 5, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): read back: %d\n", memcmp(copy, &sectors[3 * 512], 5 * 512) == 0);
+    USLOSS_Console("start4(): %s\n", &copy[4 * 512 + 32]);
+
+    result = DiskRead(copy, 1, diskSize, 0, 1, &status);
+    USLOSS_Console("start4(): reading past the end returned %d\n", result);
+
+    // The block map would be overwritten by calls that name physical sectors
+    result = DiskFill(1, 2, 0, 4, 'x', &status);
+    USLOSS_Console("start4(): DiskFill returned %d\n", result);
+    result = DiskCopy(0, 0, 0, 1, 2, 0, 4, &status);
+    USLOSS_Console("start4(): DiskCopy returned %d\n", result);
+    DiskBatchRequest request = {USLOSS_DISK_WRITE, copy, 1, 2, 0, 1, DISK_IOCLASS_DEFAULT, 0};
+    DiskSubmitBatch(&request, 1);
+    USLOSS_Console("start4(): a batch write got status %d\n", request.status);
+    result = DiskWrite(copy, DISK_RAID1_UNIT, 2, 0, 1, &status);
+    USLOSS_Console("start4(): writing to the mirrored unit returned %d\n", result);
+
+    Terminate(30);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/* DISKTEST
+ * Write two files in the file store on disk 1, a piece at a time and not on
+ * sector boundaries, then read them back and append to one of them. A file
+ * that is open can't be truncated.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+static char data[3000];
+static char copy[4000];
+
+int start4(char *arg)
+{
+    int result;
+    int fd, other;
+    int bytes;
+
+    result = FileOpen("missing", 0, &fd);
+    USLOSS_Console("start4(): opening a missing file returned %d\n", result);
+
+    for (int i = 0; i < 3000; i++)
+    {
+        data[i] = 'a' + i % 26;
+    }
+
+    result = FileOpen("letters", DISK_FILE_CREATE | DISK_FILE_TRUNCATE, &fd);
+    assert(result == 0);
+    result = FileOpen("other", DISK_FILE_CREATE | DISK_FILE_TRUNCATE, &other);
+    assert(result == 0);
+
+    // Interleave the writes so the files grow side by side
+    for (int i = 0; i < 3000; i += 700)
+    {
+        int n = 3000 - i < 700 ? 3000 - i : 700;
+        result = FileWrite(fd, &data[i], n, &bytes);
+        assert(result == 0 && bytes == n);
+        result = FileWrite(other, "0123456789", 10, &bytes);
+        assert(result == 0 && bytes == 10);
+    }
+    assert(FileClose(fd) == 0);
+    assert(FileClose(other) == 0);
+    USLOSS_Console("start4(): closing twice returned %d\n", FileClose(fd));
+
+    result = FileOpen("letters", 0, &fd);
+    assert(result == 0);
+    result = FileRead(fd, copy, sizeof(copy), &bytes);
+    assert(result == 0);
+    USLOSS_Console("start4(): read %d bytes, matching: %d\n", bytes,
+                   memcmp(copy, data, 3000) == 0);
+    result = FileRead(fd, copy, sizeof(copy), &bytes);
+    USLOSS_Console("start4(): reading at the end gave %d bytes\n", bytes);
+    assert(FileClose(fd) == 0);
+
+    result = FileOpen("other", DISK_FILE_APPEND, &other);
+    assert(result == 0);
+    result = FileWrite(other, "!", 1, &bytes);
+    assert(result == 0 && bytes == 1);
+    assert(FileClose(other) == 0);
+
+    result = FileOpen("other", 0, &other);
+    assert(result == 0);
+    result = FileRead(other, copy, sizeof(copy), &bytes);
+    assert(result == 0);
+    copy[bytes] = '\0';
+    USLOSS_Console("start4(): other holds %d bytes, ending %s\n", bytes, &copy[bytes - 11]);
+    assert(FileClose(other) == 0);
+
+    result = FileOpen("letters", 0, &fd);
+    assert(result == 0);
+    result = FileOpen("letters", DISK_FILE_TRUNCATE, &other);
+    USLOSS_Console("start4(): truncating an open file returned %d\n", result);
+    assert(FileClose(fd) == 0);
+    result = FileOpen("letters", DISK_FILE_TRUNCATE, &fd);
+    USLOSS_Console("start4(): truncating it once closed returned %d\n", result);
+    assert(FileClose(fd) == 0);
+
+    Terminate(31);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/* DISKTEST
+ * Keep a few keys in the key-value store on disk 1. Replace and delete some,
+ * check that a get takes one disk request, and check that the values are
+ * still there after the store is closed and opened again.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+static int diskRequests()
+{
+    DiskStatistics stats;
+    int result = DiskStats(1, &stats);
+    assert(result == 0);
+    return stats.requests;
+}
+
+static void show(char *key)
+{
+    char value[64];
+    int length;
+    int result = KvGet(key, value, sizeof(value) - 1, &length);
+    assert(result == 0);
+    if (length == -1)
+    {
+        USLOSS_Console("start4(): %s has no value\n", key);
+    }
+    else
+    {
+        value[length] = '\0';
+        USLOSS_Console("start4(): %s = %s\n", key, value);
+    }
+}
+
+int start4(char *arg)
+{
+    int result;
+    char big[KV_MAX_VALUE + 1];
+
+    result = KvOpen(1);
+    assert(result == 0);
+    USLOSS_Console("start4(): opening twice returned %d\n", KvOpen(1));
+
+    assert(KvPut("apple", "red", 3) == 0);
+    assert(KvPut("banana", "yellow", 6) == 0);
+    assert(KvPut("cherry", "dark red", 8) == 0);
+    assert(KvPut("apple", "green", 5) == 0);
+    assert(KvDelete("banana") == 0);
+    assert(KvDelete("durian") == 0);
+    USLOSS_Console("start4(): a key that is too long returned %d\n",
+                   KvPut("a key that is too long", "x", 1));
+    USLOSS_Console("start4(): a value that is too long returned %d\n",
+                   KvPut("big", big, sizeof(big)));
+
+    int before = diskRequests();
+    show("cherry");
+    USLOSS_Console("start4(): the get took %d disk request\n", diskRequests() - before);
+
+    assert(KvClose() == 0);
+    assert(KvOpen(1) == 0);
+    show("apple");
+    show("banana");
+    show("cherry");
+    assert(KvClose() == 0);
+
+    Terminate(32);
+    return 0;
+}
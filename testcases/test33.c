@@ -0,0 +1,79 @@
+/* DISKTEST
+ * Map sectors of disk 0 through the buffer cache. Mapping the track again and
+ * reading it must not use the disk, and a write to a mapped sector shows up in
+ * the mapped region. Only the process that mapped a region can unmap it, and
+ * only by the address it was given.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+static char sectors[4 * 512];
+static char copy[512];
+static void *region;
+
+int other(char *arg)
+{
+    USLOSS_Console("other(): unmapping start4's region returned %d\n", DiskUnmap(region));
+    Terminate(0);
+    return 0;
+}
+
+static int diskRequests()
+{
+    DiskStatistics stats;
+    int result = DiskStats(0, &stats);
+    assert(result == 0);
+    return stats.requests;
+}
+
+int start4(char *arg)
+{
+    int result;
+    int status;
+    int pid;
+    void *again;
+
+    for (int i = 0; i < 4; i++)
+    {
+        sprintf(&sectors[i * 512], "sector %d of track 3", i);
+    }
+    result = DiskWrite(sectors, 0, 3, 0, 4, &status);
+    assert(result == 0 && status == 0);
+
+    result = DiskMap(0, 3, 1, 2, &region, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): mapped: %s, %s\n", (char *) region, (char *) region + 512);
+
+    int before = diskRequests();
+    result = DiskMap(0, 3, 3, 1, &again, &status);
+    assert(result == 0 && status == 0);
+    result = DiskRead(copy, 0, 3, 0, 1, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): read: %s\n", copy);
+    USLOSS_Console("start4(): mapping and reading again took %d disk requests\n",
+                   diskRequests() - before);
+
+    strcpy(sectors, "sector 1 rewritten");
+    result = DiskWrite(sectors, 0, 3, 1, 1, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): mapped after the write: %s\n", (char *) region);
+
+    USLOSS_Console("start4(): mapping across a track returned %d\n",
+                   DiskMap(0, 3, 15, 2, &again, &status));
+    USLOSS_Console("start4(): unmapping inside the region returned %d\n",
+                   DiskUnmap((char *) region + 512));
+    Spawn("other", other, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start4(): unmapping: %d %d\n", DiskUnmap(region), DiskUnmap(again));
+    USLOSS_Console("start4(): unmapping again returned %d\n", DiskUnmap(region));
+
+    Terminate(33);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/* DISKTEST
+ * Limit the queue of disk 0 to two requests and have four processes each
+ * submit a batch of six writes. The queue must never hold more than two, and
+ * every write must still be done.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskQueueLimit[];
+
+void test_setup(int argc, char *argv[])
+{
+    diskQueueLimit[0] = 2;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char buffers[4][6][512];
+static char copy[512];
+
+int writer(char *arg)
+{
+    int id = arg[0] - '0';
+    DiskBatchRequest requests[6];
+    for (int i = 0; i < 6; i++)
+    {
+        sprintf(buffers[id][i], "writer %d sector %d", id, i);
+        requests[i].op = USLOSS_DISK_WRITE;
+        requests[i].buffer = buffers[id][i];
+        requests[i].unit = 0;
+        requests[i].track = 4 + id * 2 + i % 2;
+        requests[i].first = i;
+        requests[i].sectors = 1;
+        requests[i].ioClass = DISK_IOCLASS_DEFAULT;
+    }
+    int result = DiskSubmitBatch(requests, 6);
+    assert(result == 0);
+    for (int i = 0; i < 6; i++)
+    {
+        assert(requests[i].status == 0);
+    }
+    Terminate(id);
+    return 0;
+}
+
+int start4(char *arg)
+{
+    int depth, limit, waiting;
+    int pid, status;
+
+    int result = DiskQueueDepth(0, &depth, &limit, &waiting);
+    assert(result == 0);
+    USLOSS_Console("start4(): depth %d, limit %d, waiting %d\n", depth, limit, waiting);
+
+    Spawn("writer0", writer, "0", USLOSS_MIN_STACK, 4, &pid);
+    Spawn("writer1", writer, "1", USLOSS_MIN_STACK, 4, &pid);
+    Spawn("writer2", writer, "2", USLOSS_MIN_STACK, 4, &pid);
+    Spawn("writer3", writer, "3", USLOSS_MIN_STACK, 4, &pid);
+    for (int i = 0; i < 4; i++)
+    {
+        Wait(&pid, &status);
+    }
+
+    DiskStatistics stats;
+    DiskStats(0, &stats);
+    USLOSS_Console("start4(): most requests queued at once: %d\n", stats.maxQueueDepth);
+
+    int matching = 0;
+    for (int id = 0; id < 4; id++)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            result = DiskRead(copy, 0, 4 + id * 2 + i % 2, i, 1, &status);
+            assert(result == 0 && status == 0);
+            matching += strcmp(copy, buffers[id][i]) == 0;
+        }
+    }
+    USLOSS_Console("start4(): %d of 24 sectors read back\n", matching);
+
+    result = DiskQueueDepth(0, &depth, &limit, &waiting);
+    USLOSS_Console("start4(): depth %d, limit %d, waiting %d\n", depth, limit, waiting);
+    USLOSS_Console("start4(): asking about disk 5 returned %d\n",
+                   DiskQueueDepth(5, &depth, &limit, &waiting));
+
+    Terminate(34);
+    return 0;
+}
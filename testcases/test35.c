@@ -0,0 +1,59 @@
+/* DISKTEST
+ * Two processes read their own track of disk 0 one sector at a time. In
+ * anticipatory mode the driver waits for each reader's next sector instead of
+ * seeking back and forth between the tracks after every read.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskAnticipate;
+
+void test_setup(int argc, char *argv[])
+{
+    diskAnticipate = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int reader(char *arg)
+{
+    int track = arg[0] == '0' ? 2 : 12;
+    char buffer[512];
+    int status;
+    for (int i = 0; i < USLOSS_DISK_TRACK_SIZE; i++)
+    {
+        int result = DiskRead(buffer, 0, track, i, 1, &status);
+        assert(result == 0 && status == 0);
+    }
+    Terminate(0);
+    return 0;
+}
+
+int start4(char *arg)
+{
+    int pid, status;
+    DiskStatistics before, after;
+
+    DiskStats(0, &before);
+    Spawn("reader0", reader, "0", USLOSS_MIN_STACK, 4, &pid);
+    Spawn("reader1", reader, "1", USLOSS_MIN_STACK, 4, &pid);
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+    DiskStats(0, &after);
+
+    USLOSS_Console("start4(): read %d sectors\n", after.sectors - before.sectors);
+    USLOSS_Console("start4(): the head moved between the tracks fewer than 8 times: %d\n",
+                   after.seeks - before.seeks < 8);
+
+    Terminate(35);
+    return 0;
+}
@@ -0,0 +1,65 @@
+/* DISKTEST
+ * Six processes each read one sector of disk 0, asking for tracks out of
+ * order. With the queue plugged, the driver waits until they have all asked
+ * and then serves them in one sweep, instead of going to the first track
+ * asked for and then sweeping.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskPlug;
+
+int tracks[] = {9, 1, 11, 3, 12, 5};
+
+void test_setup(int argc, char *argv[])
+{
+    diskPlug = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int reader(char *arg)
+{
+    char buffer[512];
+    int status;
+    int result = DiskRead(buffer, 0, tracks[atoi(arg)], 0, 1, &status);
+    assert(result == 0 && status == 0);
+    Terminate(0);
+    return 0;
+}
+
+int start4(char *arg)
+{
+    int pid, status;
+    char args[6][2];
+    DiskStatistics before, after;
+
+    DiskStats(0, &before);
+    for (int i = 0; i < 6; i++)
+    {
+        sprintf(args[i], "%d", i);
+        Spawn("reader", reader, args[i], USLOSS_MIN_STACK, 4, &pid);
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        Wait(&pid, &status);
+    }
+    DiskStats(0, &after);
+
+    USLOSS_Console("start4(): served %d requests\n", after.requests - before.requests);
+    USLOSS_Console("start4(): the head moved fewer than 20 tracks: %d\n",
+                   after.seekDistance - before.seekDistance < 20);
+
+    Terminate(36);
+    return 0;
+}
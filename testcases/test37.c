@@ -0,0 +1,52 @@
+/* DISKTEST
+ * Seek calibration. The drivers time seeks across their disks when they
+ * start, which must leave the heads at track 0, keep the seeks out of the
+ * statistics, and leave the disks working.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskSeekCalibrate;
+
+void test_setup(int argc, char *argv[])
+{
+    diskSeekCalibrate = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start4(char *arg)
+{
+    int status;
+    char buffer[512], check[512];
+    DiskStatistics stats;
+
+    for (int unit = 0; unit < 2; unit++)
+    {
+        DiskStats(unit, &stats);
+        USLOSS_Console("start4(): disk %d has made %d seeks\n", unit, stats.seeks);
+
+        sprintf(buffer, "calibrated disk %d", unit);
+        DiskWrite(buffer, unit, 5, 3, 1, &status);
+        assert(status == 0);
+        DiskRead(check, unit, 5, 3, 1, &status);
+        assert(status == 0);
+        USLOSS_Console("start4(): read back \"%s\"\n", check);
+
+        DiskStats(unit, &stats);
+        USLOSS_Console("start4(): disk %d has made %d seeks, over %d tracks\n", unit,
+                       stats.seeks, stats.seekDistance);
+    }
+
+    Terminate(37);
+    return 0;
+}
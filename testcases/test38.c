@@ -0,0 +1,52 @@
+/* DISKTEST
+ * Cache warm start. test_setup lists tracks 4 and 9 of disk 0 as hot at the
+ * last shutdown, so the driver reads them into the cache while it is idle.
+ * Reads from them then need no disk request, while a read from track 5 does.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern char *diskCacheWarmFile;
+
+void test_setup(int argc, char *argv[])
+{
+    diskCacheWarmFile = "cachewarm";
+    FILE *file = fopen(diskCacheWarmFile, "w");
+    fprintf(file, "0 9 3\n0 4 10\n");
+    fclose(file);
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start4(char *arg)
+{
+    int status;
+    char buffer[512];
+    DiskStatistics before, after;
+
+    // Give the driver time to warm the cache
+    Sleep(1);
+
+    int tracks[] = {4, 9, 5};
+    for (int i = 0; i < 3; i++)
+    {
+        DiskStats(0, &before);
+        DiskRead(buffer, 0, tracks[i], 2, 1, &status);
+        assert(status == 0);
+        DiskStats(0, &after);
+        USLOSS_Console("start4(): reading track %d took %d disk requests\n", tracks[i],
+                       after.requests - before.requests);
+    }
+
+    Terminate(38);
+    return 0;
+}
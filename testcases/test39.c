@@ -0,0 +1,87 @@
+/* DISKTEST
+ * Track relocation on disk 1. After writing every track, the test reads two
+ * tracks far apart over and over. The relocator moves one of them next to the
+ * other, after which going back and forth between them takes little head
+ * movement, and every track still holds what was written to it. The calls
+ * that name physical sectors must refuse the disk.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskRelocate[];
+extern int diskRelocateInterval;
+
+void test_setup(int argc, char *argv[])
+{
+    diskRelocate[1] = 1;
+    diskRelocateInterval = 16;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start4(char *arg)
+{
+    int status, sectorSize, trackSize, tracks;
+    char buffer[512], check[512];
+    DiskStatistics before, after;
+
+    DiskSize(1, &sectorSize, &trackSize, &tracks);
+    USLOSS_Console("start4(): disk 1 has %d tracks\n", tracks);
+
+    for (int track = 0; track < tracks; track++)
+    {
+        memset(buffer, 0, sizeof(buffer));
+        sprintf(buffer, "track %d", track);
+        DiskWrite(buffer, 1, track, 0, 1, &status);
+        assert(status == 0);
+    }
+
+    // Teach the relocator, then let it work
+    for (int i = 0; i < 80; i++)
+    {
+        DiskRead(buffer, 1, i % 2 == 0 ? 2 : 25, 1, 1, &status);
+        assert(status == 0);
+    }
+    Sleep(1);
+
+    DiskStats(1, &before);
+    for (int i = 0; i < 20; i++)
+    {
+        DiskRead(buffer, 1, i % 2 == 0 ? 2 : 25, 1, 1, &status);
+        assert(status == 0);
+    }
+    DiskStats(1, &after);
+    USLOSS_Console("start4(): 20 reads moved the head fewer than 60 tracks: %d\n",
+                   after.seekDistance - before.seekDistance < 60);
+
+    int intact = 1;
+    for (int track = 0; track < tracks; track++)
+    {
+        sprintf(check, "track %d", track);
+        DiskRead(buffer, 1, track, 0, 1, &status);
+        intact = intact && status == 0 && strcmp(buffer, check) == 0;
+    }
+    USLOSS_Console("start4(): every track holds what was written to it: %d\n", intact);
+
+    int result = DiskFill(1, 0, 0, 4, 'x', &status);
+    USLOSS_Console("start4(): DiskFill returned %d\n", result);
+    result = DiskCopy(0, 0, 0, 1, 0, 0, 4, &status);
+    USLOSS_Console("start4(): DiskCopy returned %d\n", result);
+    DiskBatchRequest request = {USLOSS_DISK_WRITE, buffer, 1, 0, 0, 1, DISK_IOCLASS_DEFAULT, 0};
+    DiskSubmitBatch(&request, 1);
+    USLOSS_Console("start4(): a batch write got status %d\n", request.status);
+    result = DiskRead(buffer, DISK_RAID0_UNIT, 0, 0, 1, &status);
+    USLOSS_Console("start4(): reading from the striped unit returned %d\n", result);
+
+    Terminate(39);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/* DISKTEST
+ * Fill tracks 3 to 7 of disk 1 with 'z', then use DiskPwrite to write a
+ * string across a sector boundary and a 9000 byte run that starts part way
+ * into a sector. DiskPread must return the new bytes with the 'z's around
+ * them kept, and a range that runs off the end of the disk must be refused.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+#define TRACK_BYTES (USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE)
+#define RUN 9000
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char run[RUN];
+static char readBack[RUN + 2];
+static char sector[USLOSS_DISK_SECTOR_SIZE];
+
+int start4(char *arg)
+{
+    int result, status;
+
+    result = DiskFill(1, 3, 0, 80, 'z', &status);
+    assert(result == 0 && status == 0);
+
+    // Five bytes ending two bytes into sector 1 of track 3
+    int offset = 3 * TRACK_BYTES + 2 * USLOSS_DISK_SECTOR_SIZE - 3;
+    result = DiskPwrite("hello", 1, offset, 5, &status);
+    USLOSS_Console("start4(): DiskPwrite across a sector boundary returned %d, status %d\n",
+                   result, status);
+    char small[10];
+    result = DiskPread(small, 1, offset - 2, 9, &status);
+    small[9] = '\0';
+    USLOSS_Console("start4(): DiskPread returned %d, status %d: '%s'\n", result, status, small);
+
+    // A run over more than one kernel chunk, starting 100 bytes into track 6
+    for (int i = 0; i < RUN; i++)
+    {
+        run[i] = 'a' + i % 26;
+    }
+    offset = 6 * TRACK_BYTES + 100;
+    result = DiskPwrite(run, 1, offset, RUN, &status);
+    assert(result == 0 && status == 0);
+    result = DiskPread(readBack, 1, offset - 1, RUN + 2, &status);
+    assert(result == 0 && status == 0);
+    int matching = readBack[0] == 'z' && readBack[RUN + 1] == 'z' &&
+                   memcmp(readBack + 1, run, RUN) == 0;
+    USLOSS_Console("start4(): %d byte run read back %s\n", RUN,
+                   matching ? "intact" : "wrong");
+
+    // The whole sectors around the run keep the rest of their bytes
+    DiskRead(sector, 1, 6, 0, 1, &status);
+    int kept = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        kept += sector[i] == 'z';
+    }
+    USLOSS_Console("start4(): %d of 100 bytes before the run kept\n", kept);
+
+    result = DiskPread(small, 1, 32 * TRACK_BYTES - 4, 8, &status);
+    USLOSS_Console("start4(): reading past the end of disk 1 returned %d\n", result);
+    result = DiskPwrite(small, 1, -1, 4, &status);
+    USLOSS_Console("start4(): writing at offset -1 returned %d\n", result);
+
+    Terminate(0);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/* DISKTEST
+ * DiskAdvise on disk 0, with diskReadAhead set. Tracks 4 and 5 advised as
+ * willneed are read into the cache while the disk is idle, and dropping track 4
+ * with dontneed makes it need the disk again. Reading tracks 1 and 2 in order
+ * reads track 3 ahead; reading through tracks 8 to 11, advised as sequential,
+ * reads two tracks ahead; and nothing is read ahead in tracks 12 to 15,
+ * advised as random.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+extern int diskReadAhead;
+
+void test_setup(int argc, char *argv[])
+{
+    diskReadAhead = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static void readTrack(int track)
+{
+    int status;
+    char buffer[512];
+    DiskStatistics before, after;
+
+    DiskStats(0, &before);
+    DiskRead(buffer, 0, track, 3, 1, &status);
+    assert(status == 0);
+    DiskStats(0, &after);
+    USLOSS_Console("start4(): reading track %d took %d disk requests\n", track,
+                   after.requests - before.requests);
+}
+
+int start4(char *arg)
+{
+    int result = DiskAdvise(0, 4, 2, DISK_ADVISE_WILLNEED);
+    USLOSS_Console("start4(): willneed for tracks 4 to 5 returned %d\n", result);
+    Sleep(1);
+    readTrack(4);
+    readTrack(5);
+
+    result = DiskAdvise(0, 4, 1, DISK_ADVISE_DONTNEED);
+    USLOSS_Console("start4(): dontneed for track 4 returned %d\n", result);
+    readTrack(4);
+    readTrack(5);
+
+    readTrack(1);
+    readTrack(2);
+    Sleep(1);
+    readTrack(3);
+
+    DiskAdvise(0, 8, 4, DISK_ADVISE_SEQUENTIAL);
+    readTrack(8);
+    Sleep(1);
+    readTrack(9);
+    readTrack(10);
+
+    DiskAdvise(0, 12, 4, DISK_ADVISE_RANDOM);
+    readTrack(12);
+    readTrack(13);
+    Sleep(1);
+    readTrack(14);
+
+    result = DiskAdvise(0, 15, 3, DISK_ADVISE_WILLNEED);
+    USLOSS_Console("start4(): willneed past the end of disk 0 returned %d\n", result);
+    result = DiskAdvise(0, 0, 1, 9);
+    USLOSS_Console("start4(): an unknown hint returned %d\n", result);
+
+    Terminate(41);
+    return 0;
+}
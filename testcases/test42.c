@@ -0,0 +1,100 @@
+/* DISKTEST
+ * Write barriers. A batch of writes to tracks 12, 2, 10 and 4 of disk 0 is
+ * served in one sweep from track 0. With a barrier after the first two, the
+ * driver serves tracks 2 and 12 before it goes back for 4 and 10, so the head
+ * moves further. DiskBarrier itself only takes a physical unit.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char buffers[4][512];
+
+static void addWrite(DiskBatchRequest *entry, int i, int track)
+{
+    sprintf(buffers[i], "write %d to track %d", i, track);
+    entry->op = USLOSS_DISK_WRITE;
+    entry->buffer = buffers[i];
+    entry->unit = 0;
+    entry->track = track;
+    entry->first = 0;
+    entry->sectors = 1;
+    entry->ioClass = DISK_IOCLASS_DEFAULT;
+}
+
+static void addBarrier(DiskBatchRequest *entry, int unit)
+{
+    memset(entry, 0, sizeof(DiskBatchRequest));
+    entry->op = DISK_BATCH_BARRIER;
+    entry->unit = unit;
+    entry->ioClass = DISK_IOCLASS_DEFAULT;
+}
+
+// Moves the head to track 0, then submits the batch and returns how far the
+// head moved serving it
+static int headTravel(DiskBatchRequest *requests, int numRequests)
+{
+    char buffer[512];
+    int status;
+    DiskStatistics before, after;
+
+    DiskRead(buffer, 0, 0, 0, 1, &status);
+    DiskStats(0, &before);
+    int result = DiskSubmitBatch(requests, numRequests);
+    assert(result == 0);
+    DiskStats(0, &after);
+    return after.seekDistance - before.seekDistance;
+}
+
+int start4(char *arg)
+{
+    DiskBatchRequest requests[6];
+
+    addWrite(&requests[0], 0, 12);
+    addWrite(&requests[1], 1, 2);
+    addWrite(&requests[2], 2, 10);
+    addWrite(&requests[3], 3, 4);
+    USLOSS_Console("start4(): without a barrier the head moved %d tracks\n",
+                   headTravel(requests, 4));
+
+    addWrite(&requests[0], 0, 12);
+    addWrite(&requests[1], 1, 2);
+    addBarrier(&requests[2], 0);
+    addWrite(&requests[3], 2, 10);
+    addWrite(&requests[4], 3, 4);
+    addBarrier(&requests[5], 7);
+    USLOSS_Console("start4(): with a barrier the head moved %d tracks\n",
+                   headTravel(requests, 6));
+    for (int i = 0; i < 6; i++)
+    {
+        USLOSS_Console("start4(): entry %d status %d\n", i, requests[i].status);
+    }
+
+    // Nothing after a barrier on an idle disk has to wait for it
+    int result = DiskBarrier(0);
+    USLOSS_Console("start4(): DiskBarrier(0) returned %d\n", result);
+    char buffer[512];
+    int status;
+    DiskRead(buffer, 0, 12, 0, 1, &status);
+    USLOSS_Console("start4(): track 12 holds '%s'\n", buffer);
+
+    result = DiskBarrier(DISK_RAID1_UNIT);
+    USLOSS_Console("start4(): DiskBarrier on the mirrored unit returned %d\n", result);
+
+    Terminate(42);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* DISKTEST
+ * Write three sectors through the RAID 1 unit and check that both physical
+ * disks hold them. Then leave the head of disk 0 at track 14 and the head of
+ * disk 1 at track 1: a read of track 2 of the mirror goes to disk 1, and a
+ * read of track 13 to disk 0, whose heads are nearer.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char sectors[3 * 512];
+static char copy[3 * 512];
+
+// Reads a sector of the mirror and reports which disk served it
+static void mirrorRead(int track)
+{
+    int status;
+    DiskStatistics before[2], after[2];
+
+    DiskStats(0, &before[0]);
+    DiskStats(1, &before[1]);
+    int result = DiskRead(copy, DISK_RAID1_UNIT, track, 0, 1, &status);
+    assert(result == 0 && status == 0);
+    DiskStats(0, &after[0]);
+    DiskStats(1, &after[1]);
+    USLOSS_Console("start4(): reading track %d of the mirror took %d requests of disk 0 and %d of disk 1\n",
+                   track, after[0].requests - before[0].requests,
+                   after[1].requests - before[1].requests);
+}
+
+int start4(char *arg)
+{
+    int result, status;
+    int sectorSize, trackSize, diskSize;
+
+    result = DiskSize(DISK_RAID1_UNIT, &sectorSize, &trackSize, &diskSize);
+    assert(result == 0);
+    USLOSS_Console("start4(): RAID 1 unit has %d tracks\n", diskSize);
+
+    for (int i = 0; i < 3; i++)
+    {
+        sprintf(&sectors[i * 512], "mirrored sector %d", i);
+    }
+    for (int track = 2; track <= 13; track += 11)
+    {
+        result = DiskWrite(sectors, DISK_RAID1_UNIT, track, 0, 3, &status);
+        assert(result == 0 && status == 0);
+    }
+
+    for (int unit = 0; unit < 2; unit++)
+    {
+        result = DiskRead(copy, unit, 2, 0, 3, &status);
+        assert(result == 0 && status == 0);
+        USLOSS_Console("start4(): disk %d holds the mirrored sectors: %d\n", unit,
+                       memcmp(copy, sectors, sizeof(sectors)) == 0);
+    }
+
+    // Move the heads apart
+    DiskRead(copy, 0, 14, 0, 1, &status);
+    DiskRead(copy, 1, 1, 0, 1, &status);
+    mirrorRead(2);
+    mirrorRead(13);
+    USLOSS_Console("start4(): read back: %s\n", copy);
+
+    result = DiskRead(copy, DISK_RAID1_UNIT, diskSize, 0, 1, &status);
+    USLOSS_Console("start4(): reading past the end returned %d\n", result);
+
+    Terminate(43);
+    return 0;
+}
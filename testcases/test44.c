@@ -0,0 +1,88 @@
+/* DISKTEST
+ * Fair share scheduling. A writer submits a batch of 32 writes of 15 sectors
+ * each to disk 1, one per track, and a reader then asks for a single sector
+ * on the last track. The elevator alone would serve nearly the whole batch
+ * first; with diskFairShare set the reader is served once the writer has
+ * used up a budget of sectors.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+#define WRITES  32
+#define SECTORS 15
+
+extern int diskFairShare;
+extern int diskFairShareBudget;
+
+void test_setup(int argc, char *argv[])
+{
+    diskFairShare = 1;
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char data[WRITES * SECTORS * 512];
+static DiskBatchRequest batch[WRITES];
+
+int writer(char *arg)
+{
+    for (int i = 0; i < WRITES; i++)
+    {
+        DiskBatchRequest request = {USLOSS_DISK_WRITE, &data[i * SECTORS * 512], 1, i, 0,
+                                    SECTORS, DISK_IOCLASS_DEFAULT, 0};
+        batch[i] = request;
+    }
+    int result = DiskSubmitBatch(batch, WRITES);
+    assert(result == 0);
+    int failed = 0;
+    for (int i = 0; i < WRITES; i++)
+    {
+        failed += batch[i].status != 0;
+    }
+    USLOSS_Console("writer(): %d writes failed\n", failed);
+    Terminate(0);
+    return 0;
+}
+
+int reader(char *arg)
+{
+    char buffer[512];
+    int status;
+    DiskStatistics before, after;
+
+    DiskStats(1, &before);
+    int result = DiskRead(buffer, 1, WRITES - 1, SECTORS, 1, &status);
+    assert(result == 0 && status == 0);
+    DiskStats(1, &after);
+
+    // Sectors the writer moved while the reader waited
+    int waited = after.sectors - before.sectors - 1;
+    USLOSS_Console("reader(): served within one budget of the writer's sectors: %d\n",
+                   waited <= diskFairShareBudget + 2 * SECTORS);
+    USLOSS_Console("reader(): the writer was still busy: %d\n", waited < WRITES * SECTORS);
+    Terminate(0);
+    return 0;
+}
+
+int start4(char *arg)
+{
+    int pid, status;
+
+    // Both run ahead of start4, so the batch is queued before the read
+    Spawn("writer", writer, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("reader", reader, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+
+    Terminate(44);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/* DISKTEST
+ * Log-structured disk 1 after a run that stopped without a clean shutdown.
+ * test_setup leaves the disk as such a run would: the checkpoint is still
+ * marked stale, and the sectors hold what the old log put there. The driver
+ * must report the lost map and erase the unit instead of reading the old
+ * sectors through an out of date map.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+// The checkpoint of a 32 track unit: 30 segments, 23 logical tracks, and the
+// stale mark from phase4log.h
+#define SEGMENTS        30
+#define LOGICAL_TRACKS  23
+#define STALE_MAGIC     0x4c4f473f
+
+extern int diskLogStructured[];
+
+void test_setup(int argc, char *argv[])
+{
+    diskLogStructured[1] = 1;
+
+    FILE *disk = fopen("disk1", "r+b");
+    assert(disk != NULL);
+    char sector[512] = "left over from the last run";
+    fwrite(sector, 1, sizeof(sector), disk);
+    int header[3] = {STALE_MAGIC, LOGICAL_TRACKS, SEGMENTS};
+    fseek(disk, SEGMENTS * 16 * 512, SEEK_SET);
+    fwrite(header, sizeof(int), 3, disk);
+    fclose(disk);
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char buffer[512];
+
+int start4(char *arg)
+{
+    int result, status;
+
+    result = DiskRead(buffer, 1, 0, 0, 1, &status);
+    assert(result == 0 && status == 0);
+    int zeros = 1;
+    for (int i = 0; i < 512; i++)
+    {
+        zeros = zeros && buffer[i] == 0;
+    }
+    USLOSS_Console("start4(): the first sector reads as zeros: %d\n", zeros);
+
+    strcpy(buffer, "written after the erase");
+    result = DiskWrite(buffer, 1, 0, 0, 1, &status);
+    assert(result == 0 && status == 0);
+    memset(buffer, 0, sizeof(buffer));
+    result = DiskRead(buffer, 1, 0, 0, 1, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("start4(): read back: %s\n", buffer);
+
+    Terminate(45);
+    return 0;
+}
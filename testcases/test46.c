@@ -0,0 +1,82 @@
+/* DISKTEST
+ * I/O priority classes. A batch of writes keeps disk 0 busy while two IDLE
+ * readers, two BE readers and then an RT reader queue a read each. The RT
+ * read is served first, ahead of the BE reads queued before it, and the IDLE
+ * reads only once nothing else is waiting.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <string.h>
+
+#define WRITES 6
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static char data[WRITES][15 * 512];
+static char *classNames[] = {"an RT", "a BE", "an IDLE"};
+
+int filler(char *arg)
+{
+    DiskBatchRequest batch[WRITES];
+    for (int i = 0; i < WRITES; i++)
+    {
+        DiskBatchRequest request = {USLOSS_DISK_WRITE, data[i], 0, 2 * i, 0, 15,
+                                    DISK_IOCLASS_BE, 0};
+        batch[i] = request;
+    }
+    int result = DiskSubmitBatch(batch, WRITES);
+    assert(result == 0);
+    Terminate(0);
+    return 0;
+}
+
+int reader(char *arg)
+{
+    int ioClass = atoi(arg);
+    char buffer[512];
+    int status;
+
+    int result = DiskSetIOClass(ioClass);
+    assert(result == 0);
+    result = DiskRead(buffer, 0, 13, 0, 1, &status);
+    assert(result == 0 && status == 0);
+    USLOSS_Console("reader(): %s read was served\n", classNames[ioClass]);
+    Terminate(0);
+    return 0;
+}
+
+int start4(char *arg)
+{
+    int pid, status;
+    char *classes[] = {"2", "2", "1", "1", "0"};
+
+    USLOSS_Console("start4(): setting an unknown class returned %d\n", DiskSetIOClass(7));
+
+    // Each process runs ahead of start4 and queues its work before the
+    // next one is spawned
+    Spawn("filler", filler, NULL, USLOSS_MIN_STACK, 2, &pid);
+    for (int i = 0; i < 5; i++)
+    {
+        Spawn("reader", reader, classes[i], USLOSS_MIN_STACK, 2, &pid);
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        Wait(&pid, &status);
+    }
+
+    Terminate(46);
+    return 0;
+}
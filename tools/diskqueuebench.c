@@ -0,0 +1,203 @@
+/*
+ *  File: diskqueuebench.c
+ *  Purpose: Times the disk queue code in phase4diskqueue.c on the host, outside
+ *  of USLOSS. For each queue depth it fills the queue with random requests and
+ *  drains it again, then holds the queue at that depth while alternately
+ *  dequeueing and inserting, and reports the cost of each in ns/op.
+ *
+ *  Usage: diskqueuebench [operations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <usloss.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase4disk.h"
+
+// Default number of operations timed at each depth
+#define BENCH_OPERATIONS        2000000
+
+// Number of tracks requests are spread across
+#define BENCH_TRACKS            512
+
+// Number of processes requests are spread across
+#define BENCH_PROCS             16
+
+extern DiskStatistics DiskUnitStats[];
+extern diskRequestPtr DiskDriverQueue[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern diskRequestPtr NextDiskRequest[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskActivePid[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskBudgetLeft[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+
+static int Depths[] = {1, 4, 16, 64, 256};
+#define NUM_DEPTHS ((int) (sizeof(Depths) / sizeof(Depths[0])))
+
+static process Procs[BENCH_PROCS];
+static diskRequest *Requests;
+
+// Keeps the compiler from discarding the compareRequests loop
+volatile int Sink;
+
+/*
+ *  Returns the current time in nanoseconds
+ */
+static long long nanoseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ *  Gives a request a random position on the disk and a random owner
+ */
+static void randomRequest(diskRequestPtr request)
+{
+    memset(request, 0, sizeof(diskRequest));
+    request->op = rand() % 2 ? USLOSS_DISK_READ : USLOSS_DISK_WRITE;
+    request->unit = 0;
+    request->startTrack = rand() % BENCH_TRACKS;
+    request->startSector = rand() % USLOSS_DISK_TRACK_SIZE;
+    request->numSectors = 1 + rand() % 4;
+    request->ioClass = DISK_IOCLASS_BE;
+    request->proc = &Procs[rand() % BENCH_PROCS];
+}
+
+/*
+ *  Empties the queues of unit 0
+ */
+static void resetQueue()
+{
+    for (int i = 0; i < DISK_IOCLASSES; i++)
+    {
+        DiskDriverQueue[0][i] = NULL;
+        NextDiskRequest[0][i] = NULL;
+        DiskActivePid[0][i] = EMPTY;
+        DiskBudgetLeft[0][i] = 0;
+    }
+    memset(&DiskUnitStats[0], 0, sizeof(DiskStatistics));
+}
+
+/*
+ *  Times the queue at the given depth and prints one line of results
+ */
+static void benchDepth(int depth, int operations)
+{
+    resetQueue();
+    for (int i = 0; i < depth * 2; i++)
+    {
+        randomRequest(&Requests[i]);
+    }
+
+    // Fill the queue to depth and drain it until enough operations are done
+    int rounds = operations / depth > 0 ? operations / depth : 1;
+    long long insertTime = 0;
+    long long dequeueTime = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        long long start = nanoseconds();
+        for (int i = 0; i < depth; i++)
+        {
+            insertDiskRequest(&Requests[i]);
+        }
+        long long middle = nanoseconds();
+        for (int i = 0; i < depth; i++)
+        {
+            dequeueDiskRequest(0);
+        }
+        long long end = nanoseconds();
+        insertTime += middle - start;
+        dequeueTime += end - middle;
+    }
+
+    // Hold the queue at depth, replacing each request as it is taken
+    resetQueue();
+    for (int i = 0; i < depth; i++)
+    {
+        insertDiskRequest(&Requests[i]);
+    }
+    int spare = depth;
+    long long start = nanoseconds();
+    for (int i = 0; i < operations; i++)
+    {
+        diskRequestPtr taken = dequeueDiskRequest(0);
+        diskRequestPtr next = &Requests[spare];
+        next->nextDiskQueueRequest = NULL;
+        insertDiskRequest(next);
+        spare = taken - Requests;
+    }
+    long long steadyTime = nanoseconds() - start;
+
+    long fillOps = (long) rounds * depth;
+    printf("%-8d %12.1f %12.1f %14.1f\n", depth,
+           (double) insertTime / fillOps, (double) dequeueTime / fillOps,
+           (double) steadyTime / operations);
+}
+
+/*
+ *  Times compareRequests on its own
+ */
+static void benchCompare(int operations)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        randomRequest(&Requests[i]);
+    }
+    int sum = 0;
+    long long start = nanoseconds();
+    for (int i = 0; i < operations; i++)
+    {
+        sum += compareRequests(&Requests[i & 255], &Requests[(i * 7 + 3) & 255]);
+    }
+    long long time = nanoseconds() - start;
+    Sink = sum;
+    printf("compareRequests: %.2f ns/op\n", (double) time / operations);
+}
+
+int main(int argc, char *argv[])
+{
+    int operations = BENCH_OPERATIONS;
+    if (argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [operations]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2)
+    {
+        operations = atoi(argv[1]);
+        if (operations < 1)
+        {
+            fprintf(stderr, "%s: operations must be positive\n", argv[0]);
+            return 1;
+        }
+    }
+
+    srand(452);
+    for (int i = 0; i < BENCH_PROCS; i++)
+    {
+        Procs[i].pid = i + 1;
+    }
+    Requests = malloc(2 * 256 * sizeof(diskRequest));
+
+    printf("%d operations per depth, %d tracks, %d processes\n\n",
+           operations, BENCH_TRACKS, BENCH_PROCS);
+    benchCompare(operations);
+
+    for (int fair = FALSE; fair <= TRUE; fair++)
+    {
+        diskFairShare = fair;
+        printf("\n%s (ns/op)\n", fair ? "fair share" : "elevator");
+        printf("%-8s %12s %12s %14s\n", "depth", "insert", "dequeue", "steady pair");
+        for (int i = 0; i < NUM_DEPTHS; i++)
+        {
+            benchDepth(Depths[i], operations);
+        }
+    }
+
+    free(Requests);
+    return 0;
+}
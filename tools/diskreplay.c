@@ -0,0 +1,318 @@
+/*
+ *  File: diskreplay.c
+ *  Purpose: Replays a disk request trace recorded by the disk drivers through
+ *  the queue code in phase4diskqueue.c, using a simple model of seek and
+ *  transfer cost, and reports the seek distance and latency of each scheduling
+ *  policy. Requests arrive at the times they were queued in the trace.
+ *
+ *  Usage: diskreplay tracefile [seekBase seekPerTrack transferPerSector]
+ *  All costs are in microseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <usloss.h>
+
+#include "devices.h"
+#include "phase1.h"
+#include "phase4disk.h"
+#include "disktrace.h"
+
+// Default seek and transfer costs, in microseconds
+#define SEEK_BASE               2000
+#define SEEK_PER_TRACK          100
+#define TRANSFER_PER_SECTOR     500
+
+// Scheduling policies that can be replayed
+#define POLICY_FIFO             0
+#define POLICY_ELEVATOR         1
+#define POLICY_FAIR_SHARE       2
+#define POLICIES                3
+
+extern int HostClock;
+extern DiskStatistics DiskUnitStats[];
+extern diskRequestPtr DiskDriverQueue[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern diskRequestPtr NextDiskRequest[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskActivePid[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+extern int DiskBudgetLeft[USLOSS_DISK_UNITS][DISK_IOCLASSES];
+
+static char *PolicyNames[POLICIES] = {"fifo", "elevator", "fair share"};
+
+static int seekBase = SEEK_BASE;
+static int seekPerTrack = SEEK_PER_TRACK;
+static int transferPerSector = TRANSFER_PER_SECTOR;
+
+// The trace, and the requests and processes used to replay it
+static diskTraceRecord *Records;
+static diskRequest *Requests;
+static process Procs[MAXPROC];
+static int NumRecords;
+
+// Results of replaying one policy
+typedef struct replayResult
+{
+    long seeks;
+    long seekDistance;
+    int *latencies;
+    int numLatencies;
+} replayResult;
+
+/*
+ *  The modeled cost of moving the head the given number of tracks
+ */
+static int modelSeekCost(int distance)
+{
+    return distance == 0 ? 0 : seekBase + seekPerTrack * distance;
+}
+
+/*
+ *  Models performing a request with the head starting at *head. Moves the head,
+ *  adds the seeks to result and returns the time the request takes.
+ */
+static int serviceRequest(diskRequestPtr request, int *head, replayResult *result)
+{
+    int cost = 0;
+    int lastSector = request->startSector + (request->numSectors > 0 ? request->numSectors - 1 : 0);
+    int lastTrack = request->startTrack + lastSector / USLOSS_DISK_TRACK_SIZE;
+    for (int track = request->startTrack; track <= lastTrack; track++)
+    {
+        int distance = abs(track - *head);
+        if (distance != 0)
+        {
+            result->seeks++;
+            result->seekDistance += distance;
+        }
+        cost += modelSeekCost(distance);
+        *head = track;
+    }
+    return cost + transferPerSector * request->numSectors;
+}
+
+/*
+ *  Empties the queues of a unit so a new policy starts from scratch
+ */
+static void resetUnit(int unit)
+{
+    for (int i = 0; i < DISK_IOCLASSES; i++)
+    {
+        DiskDriverQueue[unit][i] = NULL;
+        NextDiskRequest[unit][i] = NULL;
+        DiskActivePid[unit][i] = EMPTY;
+        DiskBudgetLeft[unit][i] = 0;
+    }
+    memset(&DiskUnitStats[unit], 0, sizeof(DiskStatistics));
+}
+
+/*
+ *  Replays the records for one unit under a policy, adding to result
+ */
+static void replayUnit(int policy, int unit, replayResult *result)
+{
+    resetUnit(unit);
+    diskFairShare = policy == POLICY_FAIR_SHARE;
+
+    int head = 0;
+    int now = 0;
+    int next = 0;
+    int queued = 0;
+    int oldest = 0;
+    for (;;)
+    {
+        // Skip records for other units
+        while (next < NumRecords && Records[next].unit != unit)
+        {
+            next++;
+        }
+
+        // Let the disk sit idle until the next arrival if nothing is queued
+        if (queued == 0)
+        {
+            if (next == NumRecords)
+            {
+                break;
+            }
+            if (Records[next].queueTime > now)
+            {
+                now = Records[next].queueTime;
+            }
+        }
+
+        // Queue everything that has arrived by now
+        while (next < NumRecords && Records[next].queueTime <= now)
+        {
+            if (Records[next].unit == unit)
+            {
+                HostClock = Records[next].queueTime;
+                if (policy != POLICY_FIFO)
+                {
+                    insertDiskRequest(&Requests[next]);
+                }
+                queued++;
+            }
+            next++;
+        }
+
+        // Pick the request to serve
+        diskRequestPtr request;
+        HostClock = now;
+        if (policy == POLICY_FIFO)
+        {
+            // Requests are served in the order they arrived
+            while (Records[oldest].unit != unit)
+            {
+                oldest++;
+            }
+            request = &Requests[oldest++];
+        }
+        else
+        {
+            request = dequeueDiskRequest(unit);
+        }
+        queued--;
+
+        now += serviceRequest(request, &head, result);
+        result->latencies[result->numLatencies++] = now - request->queueTime;
+    }
+}
+
+/*
+ *  Comparison function used to sort latencies
+ */
+static int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ *  Returns the pth percentile of the sorted values
+ */
+static int percentile(int *sorted, int count, int p)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    int index = (int) (((long) count * p + 99) / 100) - 1;
+    return sorted[index < 0 ? 0 : index];
+}
+
+/*
+ *  Comparison function used to sort the trace by arrival time
+ */
+static int compareRecords(const void *a, const void *b)
+{
+    const diskTraceRecord *x = (const diskTraceRecord *) a;
+    const diskTraceRecord *y = (const diskTraceRecord *) b;
+    return (x->queueTime > y->queueTime) - (x->queueTime < y->queueTime);
+}
+
+/*
+ *  Reads the whole trace file into Records. Returns -1 on failure.
+ */
+static int readTrace(char *fileName)
+{
+    FILE *trace = fopen(fileName, "rb");
+    if (trace == NULL)
+    {
+        fprintf(stderr, "diskreplay: cannot open %s\n", fileName);
+        return -1;
+    }
+
+    int capacity = 1024;
+    Records = malloc(capacity * sizeof(diskTraceRecord));
+    NumRecords = 0;
+    while (fread(&Records[NumRecords], sizeof(diskTraceRecord), 1, trace) == 1)
+    {
+        NumRecords++;
+        if (NumRecords == capacity)
+        {
+            capacity *= 2;
+            Records = realloc(Records, capacity * sizeof(diskTraceRecord));
+        }
+    }
+    fclose(trace);
+
+    // Drivers write records when requests finish, so put them in arrival order
+    qsort(Records, NumRecords, sizeof(diskTraceRecord), compareRecords);
+    return 0;
+}
+
+/*
+ *  Resets the replay requests to match the trace
+ */
+static void buildRequests()
+{
+    for (int i = 0; i < NumRecords; i++)
+    {
+        diskTraceRecord *record = &Records[i];
+        diskRequestPtr request = &Requests[i];
+        processPtr proc = &Procs[record->pid % MAXPROC];
+        proc->pid = record->pid;
+
+        memset(request, 0, sizeof(diskRequest));
+        request->op = record->op;
+        request->numSectors = record->numSectors;
+        request->startTrack = record->track;
+        request->startSector = record->sector;
+        request->unit = record->unit;
+        request->ioClass = record->ioClass;
+        request->queueTime = record->queueTime;
+        request->proc = proc;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2 && argc != 5)
+    {
+        fprintf(stderr, "Usage: %s tracefile [seekBase seekPerTrack transferPerSector]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 5)
+    {
+        seekBase = atoi(argv[2]);
+        seekPerTrack = atoi(argv[3]);
+        transferPerSector = atoi(argv[4]);
+    }
+    if (readTrace(argv[1]) == -1)
+    {
+        return 1;
+    }
+    Requests = malloc((NumRecords > 0 ? NumRecords : 1) * sizeof(diskRequest));
+
+    printf("%d requests; seek cost %d + %d/track us, transfer %d us/sector\n\n",
+           NumRecords, seekBase, seekPerTrack, transferPerSector);
+    printf("%-12s %8s %14s %10s %10s %10s %10s\n", "policy", "seeks", "seek distance",
+           "p50 (us)", "p90 (us)", "p99 (us)", "max (us)");
+
+    for (int policy = 0; policy < POLICIES; policy++)
+    {
+        replayResult result;
+        result.seeks = 0;
+        result.seekDistance = 0;
+        result.numLatencies = 0;
+        result.latencies = malloc((NumRecords > 0 ? NumRecords : 1) * sizeof(int));
+
+        buildRequests();
+        for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++)
+        {
+            replayUnit(policy, unit, &result);
+        }
+
+        qsort(result.latencies, result.numLatencies, sizeof(int), compareInts);
+        printf("%-12s %8ld %14ld %10d %10d %10d %10d\n", PolicyNames[policy],
+               result.seeks, result.seekDistance,
+               percentile(result.latencies, result.numLatencies, 50),
+               percentile(result.latencies, result.numLatencies, 90),
+               percentile(result.latencies, result.numLatencies, 99),
+               percentile(result.latencies, result.numLatencies, 100));
+        free(result.latencies);
+    }
+
+    free(Requests);
+    free(Records);
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ *  File: hoststubs.c
+ *  Purpose: This file stands in for the kernel functions and globals that
+ *  phase4diskqueue.c uses, so the disk queue can be built and run as an
+ *  ordinary host program. There is only one thread, so the mutexes do nothing,
+ *  and the clock is whatever the host program sets HostClock to.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <usloss.h>
+
+#include "devices.h"
+
+// Globals normally defined by phase4.c and phase4disk.c
+int debugflag4 = 0;
+int diskMutex[USLOSS_DISK_UNITS];
+DiskStatistics DiskUnitStats[USLOSS_DISK_UNITS];
+
+// The current time in microseconds, as returned by gettimeofdayReal
+int HostClock = 0;
+
+void USLOSS_Console(char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+int gettimeofdayReal(int *time)
+{
+    *time = HostClock;
+    return 0;
+}
+
+void getMutex(int id)
+{
+}
+
+void returnMutex(int id)
+{
+}
+
+int semvReal(int semaphore)
+{
+    return 0;
+}